@@ -0,0 +1,270 @@
+#include "ball_store.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BALL_KERNELS_X86 1
+#endif
+
+#define MIN_BALL_CAPACITY 16
+
+void ReserveBalls(BallStore* store, int capacity) {
+    if (capacity <= store->capacity) return;
+
+    int newCapacity = (store->capacity > 0) ? store->capacity : MIN_BALL_CAPACITY;
+    while (newCapacity < capacity) newCapacity *= 2;
+
+    store->x = realloc(store->x, newCapacity * sizeof(float));
+    store->y = realloc(store->y, newCapacity * sizeof(float));
+    store->prevX = realloc(store->prevX, newCapacity * sizeof(float));
+    store->prevY = realloc(store->prevY, newCapacity * sizeof(float));
+    store->vx = realloc(store->vx, newCapacity * sizeof(float));
+    store->vy = realloc(store->vy, newCapacity * sizeof(float));
+    store->radius = realloc(store->radius, newCapacity * sizeof(float));
+    store->active = realloc(store->active, newCapacity * sizeof(uint8_t));
+    store->trails = realloc(store->trails, newCapacity * sizeof(BallTrail));
+    ReserveEntities(&store->pool, newCapacity);
+    store->capacity = newCapacity;
+}
+
+int AddBall(BallStore* store, Vector2 position, Vector2 speed, float radius) {
+    ReserveBalls(store, store->count + 1);
+    SpawnEntity(&store->pool);
+
+    int i = store->count++;
+    store->x[i] = position.x;
+    store->y[i] = position.y;
+    store->prevX[i] = position.x;
+    store->prevY[i] = position.y;
+    store->vx[i] = speed.x;
+    store->vy[i] = speed.y;
+    store->radius[i] = radius;
+    store->active[i] = 1;
+
+    store->trails[i].head = 0;
+    store->trails[i].count = 0;
+    return i;
+}
+
+EntityHandle BallHandle(const BallStore* store, int index) {
+    return EntityHandleAt(&store->pool, index);
+}
+
+int FindBall(const BallStore* store, EntityHandle handle) {
+    return FindEntity(&store->pool, handle);
+}
+
+void ClearBalls(BallStore* store) {
+    ClearEntities(&store->pool);
+    store->count = 0;
+}
+
+void CopyBallStore(BallStore* dst, const BallStore* src) {
+    ReserveBalls(dst, src->count);
+
+    size_t size = src->count * sizeof(float);
+    memcpy(dst->x, src->x, size);
+    memcpy(dst->y, src->y, size);
+    memcpy(dst->prevX, src->prevX, size);
+    memcpy(dst->prevY, src->prevY, size);
+    memcpy(dst->vx, src->vx, size);
+    memcpy(dst->vy, src->vy, size);
+    memcpy(dst->radius, src->radius, size);
+    memcpy(dst->active, src->active, src->count * sizeof(uint8_t));
+    memcpy(dst->trails, src->trails, src->count * sizeof(BallTrail));
+    CopyEntityPool(&dst->pool, &src->pool);
+    dst->count = src->count;
+}
+
+void FreeBallStore(BallStore* store) {
+    free(store->x);
+    free(store->y);
+    free(store->prevX);
+    free(store->prevY);
+    free(store->vx);
+    free(store->vy);
+    free(store->radius);
+    free(store->active);
+    free(store->trails);
+    FreeEntityPool(&store->pool);
+    memset(store, 0, sizeof(*store));
+}
+
+static int integrateScalar(BallStore* s, int start, float dt, float width, float height) {
+    int lost = 0;
+    for (int i = start; i < s->count; i++) {
+        float r = s->radius[i];
+        s->prevX[i] = s->x[i];
+        s->prevY[i] = s->y[i];
+        s->x[i] += s->vx[i] * dt;
+        s->y[i] += s->vy[i] * dt;
+
+        if (s->x[i] >= width - r || s->x[i] <= r) s->vx[i] *= -1;
+        if (s->y[i] <= r) s->vy[i] *= -1;
+        if (s->y[i] >= height + r) {
+            s->active[i] = 0;
+            lost++;
+        }
+    }
+    return lost;
+}
+
+#ifdef BALL_KERNELS_X86
+static int integrateSSE(BallStore* s, float dt, float width, float height) {
+    __m128 vdt = _mm_set1_ps(dt);
+    __m128 vw = _mm_set1_ps(width);
+    __m128 vh = _mm_set1_ps(height);
+    __m128 sign = _mm_set1_ps(-0.0f);
+    int lost = 0;
+    int i = 0;
+
+    for (; i + 4 <= s->count; i += 4) {
+        __m128 x = _mm_loadu_ps(s->x + i);
+        __m128 y = _mm_loadu_ps(s->y + i);
+        __m128 vx = _mm_loadu_ps(s->vx + i);
+        __m128 vy = _mm_loadu_ps(s->vy + i);
+        __m128 r = _mm_loadu_ps(s->radius + i);
+
+        _mm_storeu_ps(s->prevX + i, x);
+        _mm_storeu_ps(s->prevY + i, y);
+        x = _mm_add_ps(x, _mm_mul_ps(vx, vdt));
+        y = _mm_add_ps(y, _mm_mul_ps(vy, vdt));
+
+        __m128 hitX = _mm_or_ps(_mm_cmpge_ps(x, _mm_sub_ps(vw, r)), _mm_cmple_ps(x, r));
+        __m128 hitY = _mm_cmple_ps(y, r);
+        vx = _mm_xor_ps(vx, _mm_and_ps(hitX, sign));
+        vy = _mm_xor_ps(vy, _mm_and_ps(hitY, sign));
+
+        _mm_storeu_ps(s->x + i, x);
+        _mm_storeu_ps(s->y + i, y);
+        _mm_storeu_ps(s->vx + i, vx);
+        _mm_storeu_ps(s->vy + i, vy);
+
+        int out = _mm_movemask_ps(_mm_cmpge_ps(y, _mm_add_ps(vh, r)));
+        while (out) {
+            s->active[i + __builtin_ctz(out)] = 0;
+            out &= out - 1;
+            lost++;
+        }
+    }
+    return lost + integrateScalar(s, i, dt, width, height);
+}
+
+__attribute__((target("avx")))
+static int integrateAVX(BallStore* s, float dt, float width, float height) {
+    __m256 vdt = _mm256_set1_ps(dt);
+    __m256 vw = _mm256_set1_ps(width);
+    __m256 vh = _mm256_set1_ps(height);
+    __m256 sign = _mm256_set1_ps(-0.0f);
+    int lost = 0;
+    int i = 0;
+
+    for (; i + 8 <= s->count; i += 8) {
+        __m256 x = _mm256_loadu_ps(s->x + i);
+        __m256 y = _mm256_loadu_ps(s->y + i);
+        __m256 vx = _mm256_loadu_ps(s->vx + i);
+        __m256 vy = _mm256_loadu_ps(s->vy + i);
+        __m256 r = _mm256_loadu_ps(s->radius + i);
+
+        _mm256_storeu_ps(s->prevX + i, x);
+        _mm256_storeu_ps(s->prevY + i, y);
+        x = _mm256_add_ps(x, _mm256_mul_ps(vx, vdt));
+        y = _mm256_add_ps(y, _mm256_mul_ps(vy, vdt));
+
+        __m256 hitX = _mm256_or_ps(_mm256_cmp_ps(x, _mm256_sub_ps(vw, r), _CMP_GE_OQ),
+                                   _mm256_cmp_ps(x, r, _CMP_LE_OQ));
+        __m256 hitY = _mm256_cmp_ps(y, r, _CMP_LE_OQ);
+        vx = _mm256_xor_ps(vx, _mm256_and_ps(hitX, sign));
+        vy = _mm256_xor_ps(vy, _mm256_and_ps(hitY, sign));
+
+        _mm256_storeu_ps(s->x + i, x);
+        _mm256_storeu_ps(s->y + i, y);
+        _mm256_storeu_ps(s->vx + i, vx);
+        _mm256_storeu_ps(s->vy + i, vy);
+
+        int out = _mm256_movemask_ps(_mm256_cmp_ps(y, _mm256_add_ps(vh, r), _CMP_GE_OQ));
+        while (out) {
+            s->active[i + __builtin_ctz(out)] = 0;
+            out &= out - 1;
+            lost++;
+        }
+    }
+    // GCC does not emit vzeroupper for target("avx") functions in a non-AVX
+    // translation unit; without it every following SSE instruction pays the
+    // AVX-SSE transition penalty.
+    _mm256_zeroupper();
+    return lost + integrateScalar(s, i, dt, width, height);
+}
+#endif
+
+static SimdKernel kernel = SIMD_KERNEL_SCALAR;
+static pthread_once_t kernelOnce = PTHREAD_ONCE_INIT;
+
+static void detectKernel(void) {
+#ifdef BALL_KERNELS_X86
+    if (getenv("RETRO_GAMES_SCALAR") != NULL) return;
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx")) kernel = SIMD_KERNEL_AVX;
+    else if (__builtin_cpu_supports("sse2")) kernel = SIMD_KERNEL_SSE;
+#endif
+}
+
+// The kernel set the balls and particles integrate with. RETRO_GAMES_SCALAR
+// forces the scalar loops, for comparison. Detected once, safely from any
+// thread, since batch games integrate on the work pool's workers.
+SimdKernel SelectSimdKernel(void) {
+    pthread_once(&kernelOnce, detectKernel);
+    return kernel;
+}
+
+int IntegrateBalls(BallStore* store, float dt, float width, float height) {
+    switch (SelectSimdKernel()) {
+#ifdef BALL_KERNELS_X86
+        case SIMD_KERNEL_AVX:
+            return integrateAVX(store, dt, width, height);
+        case SIMD_KERNEL_SSE:
+            return integrateSSE(store, dt, width, height);
+#endif
+        default:
+            return integrateScalar(store, 0, dt, width, height);
+    }
+}
+
+static void moveBall(BallStore* s, int to, int from) {
+    s->x[to] = s->x[from];
+    s->y[to] = s->y[from];
+    s->prevX[to] = s->prevX[from];
+    s->prevY[to] = s->prevY[from];
+    s->vx[to] = s->vx[from];
+    s->vy[to] = s->vy[from];
+    s->radius[to] = s->radius[from];
+    s->active[to] = s->active[from];
+    s->trails[to] = s->trails[from];
+}
+
+// Swap-remove keeps compaction proportional to the number of dead balls
+// rather than shifting every survivor down.
+int CompactBalls(BallStore* s) {
+    int removed = 0;
+    for (int i = 0; i < s->count; ) {
+        if (s->active[i]) {
+            i++;
+            continue;
+        }
+        int last = DespawnEntity(&s->pool, i);
+        s->count = last;
+        if (i != last) moveBall(s, i, last);
+        removed++;
+    }
+    return removed;
+}
+
+const char* BallKernelName(void) {
+    switch (SelectSimdKernel()) {
+        case SIMD_KERNEL_AVX: return "avx";
+        case SIMD_KERNEL_SSE: return "sse2";
+        default: return "scalar";
+    }
+}
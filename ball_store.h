@@ -0,0 +1,54 @@
+#ifndef BALL_STORE_H
+#define BALL_STORE_H
+
+#include "raylib.h"
+#include "entity_pool.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BALL_TRAIL_LENGTH 16
+
+// Ring of recent positions. Each sample only records the trail tick it was
+// taken on; fade and shrink are derived from its age when drawing.
+typedef struct {
+    Vector2 position[BALL_TRAIL_LENGTH];
+    uint16_t tick[BALL_TRAIL_LENGTH];
+    uint8_t head;
+    uint8_t count;
+} BallTrail;
+
+// Structure-of-arrays ball storage. Live balls are kept dense in [0, count);
+// the integration kernel clears active[] for balls that left the screen and
+// CompactBalls() swaps them out afterwards. pool tracks handles only and
+// moves in step with the arrays, so a handle keeps finding its ball across
+// compactions.
+typedef struct {
+    float* x;
+    float* y;
+    float* prevX;
+    float* prevY;
+    float* vx;
+    float* vy;
+    float* radius;
+    uint8_t* active;
+    BallTrail* trails;
+    EntityPool pool;
+    int count;
+    int capacity;
+} BallStore;
+
+void ReserveBalls(BallStore* store, int capacity);
+int AddBall(BallStore* store, Vector2 position, Vector2 speed, float radius);
+EntityHandle BallHandle(const BallStore* store, int index);
+int FindBall(const BallStore* store, EntityHandle handle);
+void ClearBalls(BallStore* store);
+void CopyBallStore(BallStore* dst, const BallStore* src);
+void FreeBallStore(BallStore* store);
+typedef enum { SIMD_KERNEL_SCALAR = 0, SIMD_KERNEL_SSE, SIMD_KERNEL_AVX } SimdKernel;
+
+SimdKernel SelectSimdKernel(void);
+int IntegrateBalls(BallStore* store, float dt, float width, float height);
+int CompactBalls(BallStore* store);
+const char* BallKernelName(void);
+
+#endif
@@ -0,0 +1,691 @@
+#include "block_crusher.h"
+#include "ball_store.h"
+#include "fast_forward.h"
+#include "input_recording.h"
+#include "glow_batch.h"
+#include "save_state.h"
+#include "particles.h"
+#include "snake.h"
+#include "tetris.h"
+#include "game_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_MIN_SECONDS 0.25
+#define DEFAULT_THRESHOLD 10.0
+#define SPRITE_BALLS 1000
+#define SCENARIO_CHUNK 256
+#define STATE_BALLS 16
+#define REWIND_SNAPSHOTS 1200
+#define BENCH_PARTICLES 100000
+#define TETRIS_WARMUP_PIECES 200
+#define REPLAY_TICKS 200000
+#define REWIND_BUDGET (64u << 20)
+#define BENCH_SEED 1
+
+typedef struct {
+    char name[64];
+    double nsPerOp;
+    double ticksPerSec;
+    long long ops;
+} BenchResult;
+
+typedef struct {
+    BenchResult* results;
+    int count;
+    int capacity;
+    double minSeconds;
+    const char* filter;
+} BenchRun;
+
+// Runs iterations ops and returns the seconds they took, excluding any
+// per-op setup the benchmark does not want to count.
+typedef double (*BenchBody)(void* state, long long iterations);
+
+static volatile int sink;
+
+static bool selected(const BenchRun* run, const char* name) {
+    return run->filter == NULL || strstr(name, run->filter) != NULL;
+}
+
+// Returns the slot for result number count, doubling the list when it is
+// full, so adding scenarios never runs out of room.
+static BenchResult* growResults(BenchResult** results, int* capacity, int count) {
+    if (count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        *results = realloc(*results, *capacity * sizeof(BenchResult));
+    }
+    return &(*results)[count];
+}
+
+static BenchResult* addResult(BenchRun* run, const char* name, double nsPerOp, long long ops) {
+    BenchResult* result = growResults(&run->results, &run->capacity, run->count++);
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->nsPerOp = nsPerOp;
+    result->ticksPerSec = 0.0;
+    result->ops = ops;
+    return result;
+}
+
+// Doubles the iteration count until one run takes at least minSeconds.
+static void measure(BenchRun* run, const char* name, BenchBody body, void* state) {
+    long long iterations = 1;
+    double elapsed;
+    for (;;) {
+        elapsed = body(state, iterations);
+        if (elapsed >= run->minSeconds || iterations >= (1LL << 40)) break;
+        iterations *= 2;
+    }
+    addResult(run, name, elapsed * 1e9 / iterations, iterations);
+    fprintf(stderr, "%-40s %12.1f ns/op\n", name, elapsed * 1e9 / iterations);
+}
+
+static void initGame(BlockCrusherGame* game, int rows, int cols, int balls) {
+    memset(game, 0, sizeof(*game));
+    SetBlockCrusherSeed(game, BENCH_SEED);
+    SetBlockCrusherLayout(game, rows, cols);
+    SetBlockCrusherBalls(game, balls, balls);
+    InitBlockCrusher(game);
+}
+
+// Rows x cols giving roughly the named block count at the built-in layout.
+typedef struct {
+    int blocks;
+    int rows;
+    int cols;
+} BlockScale;
+
+static const BlockScale blockScales[] = {
+    {50, 5, 10},
+    {10000, 100, 100},
+    {100000, 316, 320},
+};
+
+static const int ballScales[] = {1, 16, 1000};
+
+#define COUNT_OF(a) ((int)(sizeof(a) / sizeof((a)[0])))
+
+static double benchCircleRec(void* state, long long iterations) {
+    const BlockField* field = state;
+    Vector2 center = {BLOCK_CRUSHER_WIDTH / 2.0f, 100.0f};
+    int hits = 0;
+    int index = 0;
+
+    double start = MonotonicSeconds();
+    for (long long i = 0; i < iterations; i++) {
+        hits += CheckCollisionCircleRec(center, 8.0f, GetBlockRect(field, index));
+        if (++index == field->count) index = 0;
+    }
+    double elapsed = MonotonicSeconds() - start;
+    sink = hits;
+    return elapsed;
+}
+
+static double benchUpdateTrail(void* state, long long iterations) {
+    BallTrail* trail = state;
+    double start = MonotonicSeconds();
+    for (long long i = 0; i < iterations; i++) {
+        UpdateBT(trail, (Vector2){(float)i, (float)i}, (uint32_t)i);
+    }
+    double elapsed = MonotonicSeconds() - start;
+    sink = trail->head;
+    return elapsed;
+}
+
+typedef struct {
+    BlockCrusherGame game;
+    int balls;
+} DoubleState;
+
+// Each op doubles `balls` balls; trimming back to that count is not timed.
+static double benchDoubleBalls(void* state, long long iterations) {
+    DoubleState* s = state;
+    BallStore* store = &s->game.balls;
+    double elapsed = 0.0;
+
+    for (long long i = 0; i < iterations; i++) {
+        for (int b = s->balls; b < store->count; b++) {
+            store->active[b] = 0;
+        }
+        CompactBalls(store);
+
+        double start = MonotonicSeconds();
+        DoubleBalls(&s->game);
+        elapsed += MonotonicSeconds() - start;
+    }
+    return elapsed;
+}
+
+typedef struct {
+    BallStore store;
+    GlowBatch batch;
+} SpriteState;
+
+// One op is one ball with a full trail going through AddBallSprites, the CPU
+// half of the trail draw; submitting the batch needs a GL context.
+static double benchBallSprites(void* state, long long iterations) {
+    SpriteState* s = state;
+    QualitySettings quality = GetQualitySettings(0);
+    int index = 0;
+
+    BeginGlowBatch(&s->batch);
+    double start = MonotonicSeconds();
+    for (long long i = 0; i < iterations; i++) {
+        AddBallSprites(&s->batch, &s->store, index, BALL_TRAIL_LENGTH, 0.5f, &quality);
+        if (++index == s->store.count) {
+            index = 0;
+            BeginGlowBatch(&s->batch);
+        }
+    }
+    double elapsed = MonotonicSeconds() - start;
+    sink = s->batch.count;
+    return elapsed;
+}
+
+typedef struct {
+    BlockCrusherGame game;
+    StateBuffer snapshot;
+    RewindBuffer rewind;
+} StateBench;
+
+static double benchSaveState(void* state, long long iterations) {
+    StateBench* s = state;
+    double start = MonotonicSeconds();
+    for (long long i = 0; i < iterations; i++) {
+        SaveBlockCrusherState(&s->game, &s->snapshot);
+    }
+    double elapsed = MonotonicSeconds() - start;
+    sink = (int)s->snapshot.size;
+    return elapsed;
+}
+
+static double benchLoadState(void* state, long long iterations) {
+    StateBench* s = state;
+    int loaded = 0;
+    double start = MonotonicSeconds();
+    for (long long i = 0; i < iterations; i++) {
+        loaded += LoadBlockCrusherState(&s->game, &s->snapshot);
+    }
+    double elapsed = MonotonicSeconds() - start;
+    sink = loaded;
+    return elapsed;
+}
+
+// One op is the PushRewind after a tick; the tick itself is not timed.
+static double benchRewindPush(void* state, long long iterations) {
+    StateBench* s = state;
+    double elapsed = 0.0;
+
+    for (long long i = 0; i < iterations; i++) {
+        StepBlockCrusher(&s->game, AutopilotBlockCrusher(&s->game));
+
+        double start = MonotonicSeconds();
+        PushRewind(&s->rewind, &s->game);
+        elapsed += MonotonicSeconds() - start;
+    }
+    sink = s->rewind.count;
+    return elapsed;
+}
+
+static void runStateBenchmarks(BenchRun* run) {
+    static const char* kinds[] = {"save_state", "load_state", "rewind_push"};
+    static const BenchBody bodies[] = {benchSaveState, benchLoadState, benchRewindPush};
+    char name[64];
+
+    for (int k = 0; k < COUNT_OF(kinds); k++) {
+        for (int b = 0; b < COUNT_OF(blockScales); b++) {
+            snprintf(name, sizeof(name), "%s/blocks_%d", kinds[k], blockScales[b].blocks);
+            if (!selected(run, name)) continue;
+
+            StateBench* state = calloc(1, sizeof(StateBench));
+            initGame(&state->game, blockScales[b].rows, blockScales[b].cols, STATE_BALLS);
+            InitRewind(&state->rewind, REWIND_SNAPSHOTS, REWIND_BUDGET);
+            for (int i = 0; i < SCENARIO_CHUNK; i++) {
+                StepBlockCrusher(&state->game, AutopilotBlockCrusher(&state->game));
+            }
+            SaveBlockCrusherState(&state->game, &state->snapshot);
+            measure(run, name, bodies[k], state);
+
+            FreeRewind(&state->rewind);
+            FreeStateBuffer(&state->snapshot);
+            CloseBlockCrusher(&state->game);
+            free(state);
+        }
+    }
+}
+
+typedef struct {
+    ParticleSystem particles;
+    GlowBatch batch;
+} ParticleState;
+
+static void refillParticles(ParticleSystem* particles) {
+    ParticleBurst burst = {{BLOCK_CRUSHER_WIDTH / 2.0f, BLOCK_CRUSHER_HEIGHT / 2.0f}, WHITE, BURST_BLOCK_DESTROYED};
+    while (particles->count < BENCH_PARTICLES) EmitParticleBurst(particles, &burst);
+}
+
+// One op is one frame's UpdateParticles over 100k particles; topping the
+// pool back up as they expire is not timed.
+static double benchUpdateParticles(void* state, long long iterations) {
+    ParticleState* s = state;
+    double elapsed = 0.0;
+
+    for (long long i = 0; i < iterations; i++) {
+        refillParticles(&s->particles);
+        double start = MonotonicSeconds();
+        UpdateParticles(&s->particles, 1.0f / 60.0f);
+        elapsed += MonotonicSeconds() - start;
+    }
+    sink = s->particles.count;
+    return elapsed;
+}
+
+// One op is one frame's worth of sprites for 100k particles.
+static double benchParticleSprites(void* state, long long iterations) {
+    ParticleState* s = state;
+    refillParticles(&s->particles);
+
+    double start = MonotonicSeconds();
+    for (long long i = 0; i < iterations; i++) {
+        BeginGlowBatch(&s->batch);
+        AddParticleSprites(&s->batch, &s->particles);
+    }
+    double elapsed = MonotonicSeconds() - start;
+    sink = s->batch.count;
+    return elapsed;
+}
+
+typedef struct {
+    TetrisGame game;
+    TetrisPlacement placements[TETRIS_PIECE_COUNT][TETRIS_MAX_PLACEMENTS];
+    int counts[TETRIS_PIECE_COUNT];
+} TetrisState;
+
+// One op is one GenerateTetrisPlacements call, cycling through the pieces.
+static double benchTetrisPlacements(void* state, long long iterations) {
+    TetrisState* s = state;
+    TetrisPlacement placements[TETRIS_MAX_PLACEMENTS];
+    int total = 0;
+
+    double start = MonotonicSeconds();
+    for (long long i = 0; i < iterations; i++) {
+        total += GenerateTetrisPlacements(&s->game.board, (int)(i % TETRIS_PIECE_COUNT), placements);
+    }
+    double elapsed = MonotonicSeconds() - start;
+    sink = total;
+    return elapsed;
+}
+
+// One op is one search position: copy the board, lock a placement, clear
+// lines and evaluate, as AutopilotTetris does per placement.
+static double benchTetrisPositions(void* state, long long iterations) {
+    TetrisState* s = state;
+    float total = 0.0f;
+    int piece = 0;
+    int index = 0;
+
+    double start = MonotonicSeconds();
+    for (long long i = 0; i < iterations; i++) {
+        TetrisBoard board = s->game.board;
+        uint32_t fullRows = LockTetrisPiece(&board, piece, s->placements[piece][index]);
+        ClearTetrisLines(&board, fullRows);
+        total += EvaluateTetrisBoard(&board, __builtin_popcount(fullRows));
+        if (++index == s->counts[piece]) {
+            index = 0;
+            piece = (piece + 1) % TETRIS_PIECE_COUNT;
+        }
+    }
+    double elapsed = MonotonicSeconds() - start;
+    sink = (int)total;
+    return elapsed;
+}
+
+static void runMicrobenchmarks(BenchRun* run) {
+    char name[64];
+
+    for (int b = 0; b < COUNT_OF(blockScales); b++) {
+        snprintf(name, sizeof(name), "circle_rec/blocks_%d", blockScales[b].blocks);
+        if (!selected(run, name)) continue;
+
+        BlockCrusherGame* game = calloc(1, sizeof(BlockCrusherGame));
+        initGame(game, blockScales[b].rows, blockScales[b].cols, 1);
+        measure(run, name, benchCircleRec, &game->field);
+        CloseBlockCrusher(game);
+        free(game);
+    }
+
+    if (selected(run, "update_trail")) {
+        BallTrail trail = {0};
+        measure(run, "update_trail", benchUpdateTrail, &trail);
+    }
+
+    for (int b = 0; b < COUNT_OF(ballScales); b++) {
+        snprintf(name, sizeof(name), "double_balls/balls_%d", ballScales[b]);
+        if (!selected(run, name)) continue;
+
+        DoubleState* state = calloc(1, sizeof(DoubleState));
+        state->balls = ballScales[b];
+        initGame(&state->game, 5, 10, ballScales[b]);
+        SetBlockCrusherBalls(&state->game, 0, ballScales[b] * 2);
+        measure(run, name, benchDoubleBalls, state);
+        CloseBlockCrusher(&state->game);
+        free(state);
+    }
+
+    if (selected(run, "ball_sprites")) {
+        SpriteState state = {0};
+        for (int i = 0; i < SPRITE_BALLS; i++) {
+            int b = AddBall(&state.store, (Vector2){i % BLOCK_CRUSHER_WIDTH, i % BLOCK_CRUSHER_HEIGHT},
+                            (Vector2){5, 5}, 8.0f);
+            for (int t = 0; t < BALL_TRAIL_LENGTH; t++) {
+                UpdateBT(&state.store.trails[b], (Vector2){t, t}, t);
+            }
+        }
+        measure(run, "ball_sprites", benchBallSprites, &state);
+        FreeBallStore(&state.store);
+        free(state.batch.sprites);
+    }
+
+    const char* particleNames[] = {"particles/update_100000", "particles/sprites_100000"};
+    const BenchBody particleBodies[] = {benchUpdateParticles, benchParticleSprites};
+    for (int k = 0; k < COUNT_OF(particleNames); k++) {
+        if (!selected(run, particleNames[k])) continue;
+
+        ParticleState* state = calloc(1, sizeof(ParticleState));
+        InitParticles(&state->particles, MAX_PARTICLES);
+        measure(run, particleNames[k], particleBodies[k], state);
+        FreeParticles(&state->particles);
+        free(state->batch.sprites);
+        free(state);
+    }
+
+    // Both Tetris benchmarks run on a mid-game board the autopilot built.
+    const char* tetrisNames[] = {"tetris/placements", "tetris/positions"};
+    const BenchBody tetrisBodies[] = {benchTetrisPlacements, benchTetrisPositions};
+    for (int k = 0; k < COUNT_OF(tetrisNames); k++) {
+        if (!selected(run, tetrisNames[k])) continue;
+
+        TetrisState* state = calloc(1, sizeof(TetrisState));
+        SetTetrisSeed(&state->game, BENCH_SEED);
+        InitTetris(&state->game);
+        for (int i = 0; i < TETRIS_WARMUP_PIECES; i++) {
+            TetrisPlacement best;
+            AutopilotTetris(&state->game, &best);
+            PlaceTetrisPiece(&state->game, best);
+        }
+        for (int piece = 0; piece < TETRIS_PIECE_COUNT; piece++) {
+            state->counts[piece] = GenerateTetrisPlacements(&state->game.board, piece, state->placements[piece]);
+        }
+        measure(run, tetrisNames[k], tetrisBodies[k], state);
+        free(state);
+    }
+}
+
+// Whole-game autopilot runs; one op is one simulation tick.
+static void runScenarios(BenchRun* run) {
+    char name[64];
+
+    for (int a = 0; a < COUNT_OF(ballScales); a++) {
+        for (int b = 0; b < COUNT_OF(blockScales); b++) {
+            snprintf(name, sizeof(name), "scenario/balls_%d/blocks_%d", ballScales[a], blockScales[b].blocks);
+            if (!selected(run, name)) continue;
+
+            BlockCrusherGame* game = calloc(1, sizeof(BlockCrusherGame));
+            initGame(game, blockScales[b].rows, blockScales[b].cols, ballScales[a]);
+
+            long long ticks = 0;
+            double start = MonotonicSeconds();
+            double elapsed;
+            do {
+                for (int i = 0; i < SCENARIO_CHUNK; i++) {
+                    StepBlockCrusher(game, AutopilotBlockCrusher(game));
+                }
+                ticks += SCENARIO_CHUNK;
+                elapsed = MonotonicSeconds() - start;
+            } while (elapsed < run->minSeconds);
+
+            BenchResult* result = addResult(run, name, elapsed * 1e9 / ticks, ticks);
+            result->ticksPerSec = ticks / elapsed;
+            fprintf(stderr, "%-40s %12.1f ns/op %12.0f ticks/sec\n", name, result->nsPerOp, result->ticksPerSec);
+
+            CloseBlockCrusher(game);
+            free(game);
+        }
+    }
+
+    // An autopilot session on the default level, replayed tick by tick and
+    // through the event-driven engine; one op is one tick.
+    static const char* replayNames[] = {"scenario/replay/step", "scenario/replay/fast_forward"};
+    if (selected(run, replayNames[0]) || selected(run, replayNames[1])) {
+        BlockCrusherGame* game = calloc(1, sizeof(BlockCrusherGame));
+        InputRecording recording = {0};
+        initGame(game, 0, 0, 1);
+        SetBlockCrusherRecording(game, &recording);
+        for (int i = 0; i < REPLAY_TICKS; i++) {
+            StepBlockCrusher(game, AutopilotBlockCrusher(game));
+        }
+        SetBlockCrusherRecording(game, NULL);
+
+        for (int k = 0; k < COUNT_OF(replayNames); k++) {
+            if (!selected(run, replayNames[k])) continue;
+
+            FastForward engine = {0};
+            long long ticks = 0;
+            double start = MonotonicSeconds();
+            double elapsed;
+            do {
+                CloseBlockCrusher(game);
+                initGame(game, 0, 0, 1);
+                FreeFastForward(&engine);
+                for (int r = 0; r < recording.runCount; r++) {
+                    BlockCrusherInput input = UnpackBlockCrusherInput(recording.runs[r].input);
+                    if (k == 0) {
+                        for (uint32_t i = 0; i < recording.runs[r].length; i++) StepBlockCrusher(game, input);
+                    } else {
+                        AdvanceBlockCrusher(&engine, game, input, game->tick + recording.runs[r].length);
+                    }
+                }
+                ticks += REPLAY_TICKS;
+                elapsed = MonotonicSeconds() - start;
+            } while (elapsed < run->minSeconds);
+
+            BenchResult* result = addResult(run, replayNames[k], elapsed * 1e9 / ticks, ticks);
+            result->ticksPerSec = ticks / elapsed;
+            fprintf(stderr, "%-40s %12.1f ns/op %12.0f ticks/sec\n", replayNames[k], result->nsPerOp, result->ticksPerSec);
+            FreeFastForward(&engine);
+        }
+
+        FreeInputRecording(&recording);
+        CloseBlockCrusher(game);
+        free(game);
+    }
+
+    // Snake autopilot on the default board and on the largest board with a
+    // snake covering half of it.
+    static const struct { const char* name; int size; int length; } snakeScales[] = {
+        {"scenario/snake/board_40x30", 0, 0},
+        {"scenario/snake/board_4096/length_8388608", SNAKE_MAX_BOARD, SNAKE_MAX_BOARD * SNAKE_MAX_BOARD / 2},
+    };
+    for (int s = 0; s < COUNT_OF(snakeScales); s++) {
+        if (!selected(run, snakeScales[s].name)) continue;
+
+        SnakeGame* game = calloc(1, sizeof(SnakeGame));
+        SetSnakeBoard(game, snakeScales[s].size, snakeScales[s].size);
+        SetSnakeStartLength(game, snakeScales[s].length);
+        SetSnakeSeed(game, BENCH_SEED);
+        InitSnake(game);
+
+        long long ticks = 0;
+        double start = MonotonicSeconds();
+        double elapsed;
+        do {
+            for (int i = 0; i < SCENARIO_CHUNK; i++) {
+                StepSnake(game, AutopilotSnake(game));
+            }
+            ticks += SCENARIO_CHUNK;
+            elapsed = MonotonicSeconds() - start;
+        } while (elapsed < run->minSeconds);
+
+        BenchResult* result = addResult(run, snakeScales[s].name, elapsed * 1e9 / ticks, ticks);
+        result->ticksPerSec = ticks / elapsed;
+        fprintf(stderr, "%-40s %12.1f ns/op %12.0f ticks/sec\n", snakeScales[s].name, result->nsPerOp, result->ticksPerSec);
+
+        CloseSnake(game);
+        free(game);
+    }
+
+    // Tetris autopilot; one op is one piece searched and placed.
+    if (selected(run, "scenario/tetris")) {
+        TetrisGame* game = calloc(1, sizeof(TetrisGame));
+        SetTetrisSeed(game, BENCH_SEED);
+        InitTetris(game);
+
+        long long pieces = 0;
+        double start = MonotonicSeconds();
+        double elapsed;
+        do {
+            for (int i = 0; i < SCENARIO_CHUNK; i++) {
+                if (game->gameOver) InitTetris(game);
+                TetrisPlacement best;
+                AutopilotTetris(game, &best);
+                PlaceTetrisPiece(game, best);
+            }
+            pieces += SCENARIO_CHUNK;
+            elapsed = MonotonicSeconds() - start;
+        } while (elapsed < run->minSeconds);
+
+        BenchResult* result = addResult(run, "scenario/tetris", elapsed * 1e9 / pieces, pieces);
+        result->ticksPerSec = pieces / elapsed;
+        fprintf(stderr, "%-40s %12.1f ns/op %12.0f ticks/sec\n", "scenario/tetris", result->nsPerOp, result->ticksPerSec);
+
+        CloseTetris(game);
+        free(game);
+    }
+}
+
+static void writeJSON(FILE* file, const BenchRun* run) {
+    fprintf(file, "{\n  \"kernel\": \"%s\",\n  \"results\": [\n", BallKernelName());
+    for (int i = 0; i < run->count; i++) {
+        const BenchResult* r = &run->results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ticks_per_sec\": %.1f, \"ops\": %lld}%s\n",
+                r->name, r->nsPerOp, r->ticksPerSec, r->ops, i + 1 < run->count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+// Reads back the one-result-per-line JSON that writeJSON produces; it is not
+// a general JSON parser.
+static int loadBaseline(const char* path, BenchResult** results) {
+    FILE* file = fopen(path, "r");
+    if (!file) return -1;
+
+    int count = 0;
+    int capacity = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        BenchResult* r = growResults(results, &capacity, count);
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"ns_per_op\": %lf, \"ticks_per_sec\": %lf, \"ops\": %lld",
+                   r->name, &r->nsPerOp, &r->ticksPerSec, &r->ops) == 4) {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+// Flags every benchmark whose ns/op grew by more than threshold percent.
+// Returns the number of regressions.
+static int compareBaseline(const BenchRun* run, const BenchResult* baseline, int baselineCount, double threshold) {
+    int regressions = 0;
+    fprintf(stderr, "\n%-40s %12s %12s %8s\n", "benchmark", "baseline", "current", "change");
+
+    for (int i = 0; i < run->count; i++) {
+        const BenchResult* r = &run->results[i];
+        const BenchResult* base = NULL;
+        for (int j = 0; j < baselineCount; j++) {
+            if (strcmp(baseline[j].name, r->name) == 0) base = &baseline[j];
+        }
+        if (!base || base->nsPerOp <= 0.0) {
+            fprintf(stderr, "%-40s %12s %12.1f %8s\n", r->name, "-", r->nsPerOp, "new");
+            continue;
+        }
+
+        double change = (r->nsPerOp - base->nsPerOp) / base->nsPerOp * 100.0;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        fprintf(stderr, "%-40s %12.1f %12.1f %+7.1f%%%s\n", r->name, base->nsPerOp, r->nsPerOp, change,
+                regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    BenchRun* run = calloc(1, sizeof(BenchRun));
+    run->minSeconds = DEFAULT_MIN_SECONDS;
+    const char* jsonPath = NULL;
+    const char* comparePath = NULL;
+    double threshold = DEFAULT_THRESHOLD;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            comparePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            run->filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            run->minSeconds = atof(argv[++i]);
+        }
+        else {
+            bool help = strcmp(argv[i], "--help") == 0;
+            if (!help) fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            fprintf(stderr, "Usage: %s [--json FILE] [--compare BASELINE] [--threshold PCT]\n"
+                            "       [--filter SUBSTRING] [--min-time SECONDS]\n", argv[0]);
+            return help ? 0 : 2;
+        }
+    }
+
+    BenchResult* baseline = NULL;
+    int baselineCount = 0;
+    if (comparePath) {
+        baselineCount = loadBaseline(comparePath, &baseline);
+        if (baselineCount < 0) {
+            fprintf(stderr, "Could not read baseline %s\n", comparePath);
+            return 2;
+        }
+    }
+
+    runMicrobenchmarks(run);
+    runStateBenchmarks(run);
+    runScenarios(run);
+
+    if (jsonPath) {
+        FILE* file = fopen(jsonPath, "w");
+        if (!file) {
+            fprintf(stderr, "Could not write %s\n", jsonPath);
+            return 2;
+        }
+        writeJSON(file, run);
+        fclose(file);
+    } else {
+        writeJSON(stdout, run);
+    }
+
+    int regressions = 0;
+    if (comparePath) {
+        regressions = compareBaseline(run, baseline, baselineCount, threshold);
+        fprintf(stderr, "%d regression(s) above %.1f%%\n", regressions, threshold);
+    }
+
+    free(baseline);
+    free(run->results);
+    free(run);
+    return regressions > 0 ? 1 : 0;
+}
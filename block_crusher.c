@@ -1,437 +1,991 @@
 #include "game_manager.h"
 #include "block_crusher.h"
+#include "collision.h"
+#include "input_recording.h"
+#include "level.h"
+#include "profiler.h"
+#include "save_state.h"
+#include "game_util.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
-#include <time.h>
 
-#define BASE_WIDTH 800
-#define BASE_HEIGHT 600
-#define BALL_TRAIL_LENGTH 16
 #define MAX_BALLS 16
-#define MAX_POWERUPS 10
 #define POWERUP_DROP_CHANCE 20
+#define BASE_TICK_RATE 60
+#define MAX_FRAME_TIME 0.25f
+#define DEFAULT_ROWS 5
+#define DEFAULT_COLS 10
+#define MAX_SWEEP_HITS 8
+#define MAX_LAYER_PATCHES 256
+#define MAX_PENDING_BURSTS 4096
+#define DEFAULT_BALL_SPEED 5.0f
+#define DEFAULT_BALL_RADIUS 8.0f
+#define DEFAULT_PADDLE_WIDTH 120.0f
+#define DEFAULT_PADDLE_SPEED 8.0f
 
-static BlockCrusherGame game;
+static Vector2 lerpV(Vector2 a, Vector2 b, float t) {
+    return (Vector2){a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t};
+}
+
+static uint32_t nextRandom(BlockCrusherGame* game) {
+    return (uint32_t)(SplitMix64(&game->rngState) >> 32);
+}
+
+static int randomInt(BlockCrusherGame* game, int range) {
+    return (int)(((uint64_t)nextRandom(game) * (uint32_t)range) >> 32);
+}
+
+void SetBlockCrusherSeed(BlockCrusherGame* game, uint64_t seed) {
+    game->rngState = seed;
+}
+
+void SetBlockCrusherLevels(BlockCrusherGame* game, const LevelSet* levels) {
+    game->levels = levels;
+    game->levelIndex = 0;
+}
+
+void SetBlockCrusherRecording(BlockCrusherGame* game, InputRecording* target) {
+    game->recording = target;
+}
 
-typedef struct {
-    Vector2 position;
-    Vector2 speed;
-    bool active;
-    float radius;
-} PowerUp;
+// Interactive games keep a rewind history of every tick they run.
+void SetBlockCrusherRewind(BlockCrusherGame* game, RewindBuffer* rewind) {
+    game->rewind = rewind;
+}
+
+void SetBlockCrusherTickRate(BlockCrusherGame* game, int rate) {
+    if (rate > 0) game->tickRate = rate;
+}
 
-static PowerUp powerups[MAX_POWERUPS];
-static Ball balls[MAX_BALLS];
-static int activeBallCount = 1;
+void SetBlockCrusherLayout(BlockCrusherGame* game, int rows, int cols) {
+    if (rows > 0) game->layoutRows = rows;
+    if (cols > 0) game->layoutCols = cols;
+}
+
+void SetBlockCrusherBalls(BlockCrusherGame* game, int startBalls, int maxBalls) {
+    if (maxBalls > 0) game->maxBallCount = maxBalls;
+    if (startBalls > 0) game->startBallCount = startBalls;
+}
 
-static float resize(float value, int baseDimension, int currentDimension) {
-    return value * (currentDimension / (float)baseDimension);
+// Settings left at zero (a freshly zeroed context) take their defaults here.
+static void applyDefaults(BlockCrusherGame* game) {
+    if (game->tickRate <= 0) game->tickRate = BASE_TICK_RATE;
+    if (game->layoutRows <= 0) game->layoutRows = DEFAULT_ROWS;
+    if (game->layoutCols <= 0) game->layoutCols = DEFAULT_COLS;
+    if (game->maxBallCount <= 0) game->maxBallCount = MAX_BALLS;
+    if (game->startBallCount <= 0) game->startBallCount = 1;
+    if (game->startBallCount > game->maxBallCount) game->maxBallCount = game->startBallCount;
 }
 
-void InitBlockCrusher(int screenWidth, int screenHeight) {
-    balls[0].position = (Vector2){screenWidth/2, screenHeight/2};
-    balls[0].speed = (Vector2){resize(5.0f, BASE_WIDTH, screenWidth), 
-                               resize(5.0f, BASE_HEIGHT, screenHeight)};
-    balls[0].radius = resize(8.0f, BASE_WIDTH, screenWidth);
-    balls[0].active = true;
-    balls[0].trailIndex = 0;
+static void spawnBalls(BlockCrusherGame* game, int targetBallCount) {
+    if (targetBallCount > game->maxBallCount) targetBallCount = game->maxBallCount;
     
-    for (int i = 0; i < BALL_TRAIL_LENGTH; i++) {
-        balls[0].trail[i] = balls[0].position;
-        balls[0].trailAlpha[i] = 0.0f;
-        balls[0].trailSize[i] = balls[0].radius;
-    }
+    int currentActiveBalls = game->balls.count;
+    if (currentActiveBalls == 0 || targetBallCount <= currentActiveBalls) return;
     
-    for (int i = 1; i < MAX_BALLS; i++) {
-        balls[i].active = false;
-    }
-    activeBallCount = 1;
+    ReserveBalls(&game->balls, targetBallCount);
     
-    for (int i = 0; i < MAX_POWERUPS; i++) {
-        powerups[i].active = false;
+    for (int i = currentActiveBalls; i < targetBallCount; i++) {
+        int sourceIndex = i % currentActiveBalls;
+        
+        float angle = (randomInt(game, 120) - 60) * (3.14159f / 180.0f);
+        float cos_a = cosf(angle);
+        float sin_a = sinf(angle);
+        
+        Vector2 speed = {
+            game->balls.vx[sourceIndex] * cos_a - game->balls.vy[sourceIndex] * sin_a,
+            game->balls.vx[sourceIndex] * sin_a + game->balls.vy[sourceIndex] * cos_a
+        };
+        int added = AddBall(&game->balls, (Vector2){game->balls.x[sourceIndex], game->balls.y[sourceIndex]}, 
+                            speed, game->balls.radius[sourceIndex]);
+        game->balls.prevX[added] = game->balls.prevX[sourceIndex];
+        game->balls.prevY[added] = game->balls.prevY[sourceIndex];
     }
     
-    float pd_width = resize(120.0f, BASE_WIDTH, screenWidth);
-    float pd_height = resize(12.0f, BASE_HEIGHT, screenHeight);
-    game.paddle.rect = (Rectangle){screenWidth/2 - pd_width/2, 
-                                  screenHeight - resize(40.0f, BASE_HEIGHT, screenHeight), 
-                                  pd_width, pd_height};
-    game.paddle.speed = (Vector2){resize(8.0f, BASE_WIDTH, screenWidth), 0.0f};
-    game.paddle.active = true;
-    
-    int rows = 5;
-    int cols = 10;
-    game.blocksCount = rows * cols;
-    
-    if (game.blocks != NULL) {
-        free(game.blocks);
-    }
-    
-    game.blocks = (Block*)malloc(game.blocksCount * sizeof(Block));
-    
-    float blockWidth = resize(70.0f, BASE_WIDTH, screenWidth);
-    float blockHeight = resize(20.0f, BASE_HEIGHT, screenHeight);
-    float blockSX = resize(8.0f, BASE_WIDTH, screenWidth);
-    float blockSY = resize(8.0f, BASE_HEIGHT, screenHeight);
-    float blockTM = resize(70.0f, BASE_HEIGHT, screenHeight);
-    
-    for (int i = 0; i < rows; i++) {
-        for (int j = 0; j < cols; j++) {
-            int index = i * cols + j;
-            game.blocks[index].rect = (Rectangle){
-                j * (blockWidth + blockSX) + blockSX, 
-                i * (blockHeight + blockSY) + blockTM, 
-                blockWidth, 
-                blockHeight
-            };
-            game.blocks[index].active = true;
-        }
+    for (int i = 0; i < currentActiveBalls; i++) {
+        game->balls.trails[i].head = 0;
+        game->balls.trails[i].count = 0;
     }
+}
 
-    game.score = 0;
-    game.lives = 3;
-    game.gameOver = false;
-    game.paused = false;
+// The built-in rows x cols layout, shrunk to fit when it would not.
+static void builtinLayout(const BlockCrusherGame* game, Rectangle* first, float* spacingX, float* spacingY) {
+    int rows = game->layoutRows;
+    int cols = game->layoutCols;
+    
+    float blockWidth = 70.0f;
+    float blockHeight = 20.0f;
+    float blockSX = 8.0f;
+    float blockSY = 8.0f;
+    float blockTM = 70.0f;
+    
+    float fitX = BLOCK_CRUSHER_WIDTH / (cols * (blockWidth + blockSX) + blockSX);
+    float fitY = (BLOCK_CRUSHER_HEIGHT / 2.0f) / (rows * (blockHeight + blockSY));
+    if (fitX < 1.0f) {
+        blockWidth *= fitX;
+        blockSX *= fitX;
+    }
+    if (fitY < 1.0f) {
+        blockHeight *= fitY;
+        blockSY *= fitY;
+    }
     
-    srand(time(NULL));
+    *first = (Rectangle){blockSX, blockTM, blockWidth, blockHeight};
+    *spacingX = blockSX;
+    *spacingY = blockSY;
 }
 
-void SpawnPowerUp(float x, float y, int screenWidth, int screenHeight) {
-    for (int i = 0; i < MAX_POWERUPS; i++) {
-        if (!powerups[i].active) {
-            powerups[i].position = (Vector2){x, y};
-            powerups[i].speed = (Vector2){0, resize(3.0f, BASE_HEIGHT, screenHeight)};
-            powerups[i].radius = resize(8.0f, BASE_WIDTH, screenWidth);
-            powerups[i].active = true;
-            break;
+// Contexts start zeroed, so the pool learns its item size on first use.
+static void clearPowerUps(BlockCrusherGame* game) {
+    game->powerups.itemSize = sizeof(PowerUp);
+    ClearEntities(&game->powerups);
+}
+
+static void useDefaultLevelSettings(BlockCrusherGame* game) {
+    game->ballSpeed = DEFAULT_BALL_SPEED;
+    game->ballRadius = DEFAULT_BALL_RADIUS;
+    game->paddleWidth = DEFAULT_PADDLE_WIDTH;
+    game->paddleSpeed = DEFAULT_PADDLE_SPEED;
+    game->levelStartBalls = 0;
+}
+
+// Opens the current campaign level, if any, and takes its ball and paddle
+// parameters. The caller builds the field from it and closes it.
+static bool openCurrentLevel(BlockCrusherGame* game, LevelFile* level) {
+    useDefaultLevelSettings(game);
+    
+    if (!game->levels || game->levels->count == 0) return false;
+    
+    game->levelIndex %= game->levels->count;
+    const char* path = game->levels->paths[game->levelIndex];
+    if (!OpenLevel(level, path)) {
+        TraceLog(LOG_WARNING, "Could not load level %s", path);
+        return false;
+    }
+    
+    const LevelHeader* header = level->header;
+    if (header->ballSpeed > 0) game->ballSpeed = header->ballSpeed;
+    if (header->ballRadius > 0) game->ballRadius = header->ballRadius;
+    if (header->paddleWidth > 0) game->paddleWidth = header->paddleWidth;
+    if (header->paddleSpeed > 0) game->paddleSpeed = header->paddleSpeed;
+    game->levelStartBalls = (int)header->startBalls;
+    return true;
+}
+
+// Builds the field for the current level (or the built-in layout) and takes
+// the level's ball and paddle settings, leaving the rest of the game as is.
+void LoadBlockCrusherLevel(BlockCrusherGame* game) {
+    LevelFile level;
+    bool built = false;
+    if (openCurrentLevel(game, &level)) {
+        built = BuildLevelField(&level, &game->field);
+        CloseLevel(&level);
+        if (!built) {
+            TraceLog(LOG_WARNING, "Could not load level %s", game->levels->paths[game->levelIndex]);
+            useDefaultLevelSettings(game);
         }
     }
+    if (!built) {
+        Rectangle first;
+        float spacingX, spacingY;
+        builtinLayout(game, &first, &spacingX, &spacingY);
+        InitBlockBoard(&game->field, game->layoutRows, game->layoutCols, first, spacingX, spacingY);
+    }
+    game->renderer.blockLayerStale = true;
+    game->renderer.destroyedCount = 0;
 }
 
-void DoubleBalls(int screenWidth, int screenHeight) {
-    int targetBallCount = activeBallCount * 2;
-    if (targetBallCount > MAX_BALLS) targetBallCount = MAX_BALLS;
+// Loads the current level and puts the paddle and the level's balls at
+// their starting places, with no powerups in flight. Score and lives carry
+// over, so this is also how a cleared level moves on to the next.
+static void startLevel(BlockCrusherGame* game) {
+    LoadBlockCrusherLevel(game);
+    
+    ClearBalls(&game->balls);
+    AddBall(&game->balls, (Vector2){BLOCK_CRUSHER_WIDTH/2, BLOCK_CRUSHER_HEIGHT/2},
+            (Vector2){game->ballSpeed, game->ballSpeed},
+            game->ballRadius);
+    
+    clearPowerUps(game);
+    
+    float pd_width = game->paddleWidth;
+    float pd_height = 12.0f;
+    game->paddle.rect = (Rectangle){BLOCK_CRUSHER_WIDTH/2 - pd_width/2, 
+                                  BLOCK_CRUSHER_HEIGHT - 40.0f, 
+                                  pd_width, pd_height};
+    game->paddle.prevX = game->paddle.rect.x;
+    game->paddle.speed = (Vector2){game->paddleSpeed, 0.0f};
+    game->paddle.active = true;
     
-    Ball activeBalls[MAX_BALLS];
-    int currentActiveBalls = 0;
+    spawnBalls(game, game->levelStartBalls > 0 ? game->levelStartBalls : game->startBallCount);
+}
+
+void InitBlockCrusher(BlockCrusherGame* game) {
+    applyDefaults(game);
+    startLevel(game);
     
-    for (int i = 0; i < MAX_BALLS; i++) {
-        if (balls[i].active) {
-            activeBalls[currentActiveBalls] = balls[i];
-            currentActiveBalls++;
-        }
+    game->pendingCommands = (BlockCrusherInput){0};
+
+    game->score = 0;
+    game->lives = 3;
+    game->gameOver = false;
+    game->paused = false;
+    game->tickScale = BASE_TICK_RATE / (float)game->tickRate;
+    game->trailClock = 0.0f;
+    game->trailTick = 0;
+    game->renderAlpha = 1.0f;
+}
+
+// Writes the built-in layout for the current --rows/--cols as a grid level
+// in base units, as a starting point for hand-made levels.
+bool ExportBlockCrusherLevel(const BlockCrusherGame* game, const char* path) {
+    BlockCrusherGame defaults = *game;
+    applyDefaults(&defaults);
+    
+    Rectangle first;
+    float spacingX, spacingY;
+    builtinLayout(&defaults, &first, &spacingX, &spacingY);
+    
+    LevelHeader header = {0};
+    header.layout = LEVEL_GRID;
+    header.rows = defaults.layoutRows;
+    header.cols = defaults.layoutCols;
+    header.originX = first.x;
+    header.originY = first.y;
+    header.blockWidth = first.width;
+    header.blockHeight = first.height;
+    header.spacingX = spacingX;
+    header.spacingY = spacingY;
+    
+    size_t count = (size_t)header.rows * header.cols;
+    uint8_t* cells = malloc(count * 2);
+    memset(cells, BLOCK_NORMAL, count);
+    memset(cells + count, 1, count);
+    bool ok = SaveLevel(path, &header, cells, count * 2);
+    free(cells);
+    return ok;
+}
+
+EntityHandle SpawnPowerUp(BlockCrusherGame* game, float x, float y) {
+    EntityHandle handle = SpawnEntity(&game->powerups);
+    PowerUp* powerup = EntityAt(&game->powerups, game->powerups.count - 1);
+    powerup->position = (Vector2){x, y};
+    powerup->prevPosition = powerup->position;
+    powerup->speed = (Vector2){0, 3.0f};
+    powerup->radius = 8.0f;
+    return handle;
+}
+
+void DoubleBalls(BlockCrusherGame* game) {
+    spawnBalls(game, game->balls.count * 2);
+}
+
+BlockCrusherInput ReadBlockCrusherInput(void) {
+    BlockCrusherInput input;
+    input.left = IsKeyDown(KEY_LEFT);
+    input.right = IsKeyDown(KEY_RIGHT);
+    input.pause = IsKeyPressed(KEY_P);
+    input.restart = IsKeyPressed(KEY_R);
+    return input;
+}
+
+BlockCrusherInput AutopilotBlockCrusher(const BlockCrusherGame* game) {
+    BlockCrusherInput input = {0};
+    
+    if (game->gameOver) {
+        input.restart = true;
+        return input;
     }
     
-    activeBallCount = 0;
-    for (int i = 0; i < MAX_BALLS; i++) {
-        balls[i].active = false;
+    int target = -1;
+    for (int i = 0; i < game->balls.count; i++) {
+        if (target < 0 || game->balls.y[i] > game->balls.y[target]) target = i;
     }
     
-    int ballsToAdd = (targetBallCount < currentActiveBalls * 2) ? targetBallCount : currentActiveBalls * 2;
+    float paddleCenter = game->paddle.rect.x + game->paddle.rect.width / 2;
+    float targetX = (target >= 0) ? game->balls.x[target] : BLOCK_CRUSHER_WIDTH / 2.0f;
+    float deadZone = 8.0f;
     
-    for (int i = 0; i < ballsToAdd && i < MAX_BALLS; i++) {
-        int sourceIndex = i % currentActiveBalls;
-        balls[i] = activeBalls[sourceIndex];
-        
-        if (i >= currentActiveBalls) {
-            float angle = (rand() % 120 - 60) * (3.14159f / 180.0f);
-            float cos_a = cosf(angle);
-            float sin_a = sinf(angle);
-            
-            float newSpeedX = balls[i].speed.x * cos_a - balls[i].speed.y * sin_a;
-            float newSpeedY = balls[i].speed.x * sin_a + balls[i].speed.y * cos_a;
-            
-            balls[i].speed.x = newSpeedX;
-            balls[i].speed.y = newSpeedY;
-        }
-        
-        balls[i].trailIndex = 0;
-        for (int k = 0; k < BALL_TRAIL_LENGTH; k++) {
-            balls[i].trail[k] = balls[i].position;
-            balls[i].trailAlpha[k] = 0.0f;
-            balls[i].trailSize[k] = balls[i].radius;
-        }
-        
-        balls[i].active = true;
-        activeBallCount++;
+    input.left = targetX < paddleCenter - deadZone;
+    input.right = targetX > paddleCenter + deadZone;
+    return input;
+}
+
+// FNV-1a over the simulation state only: trails, interpolation and the
+// block layer are presentation and may differ between a live run and a replay.
+uint64_t HashBlockCrusherState(const BlockCrusherGame* game) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    int flags = (game->gameOver ? 1 : 0) | (game->paused ? 2 : 0);
+
+    hash = HashBytes(hash, &game->score, sizeof(game->score));
+    hash = HashBytes(hash, &game->lives, sizeof(game->lives));
+    hash = HashBytes(hash, &flags, sizeof(flags));
+    hash = HashBytes(hash, &game->rngState, sizeof(game->rngState));
+    hash = HashBytes(hash, &game->paddle.rect, sizeof(game->paddle.rect));
+
+    hash = HashBytes(hash, &game->balls.count, sizeof(game->balls.count));
+    hash = HashBytes(hash, game->balls.x, game->balls.count * sizeof(float));
+    hash = HashBytes(hash, game->balls.y, game->balls.count * sizeof(float));
+    hash = HashBytes(hash, game->balls.vx, game->balls.count * sizeof(float));
+    hash = HashBytes(hash, game->balls.vy, game->balls.count * sizeof(float));
+
+    hash = HashBytes(hash, &game->field.alive, sizeof(game->field.alive));
+    for (int i = 0; i < game->field.count; i++) {
+        uint8_t active = IsBlockActive(&game->field, i);
+        hash = HashBytes(hash, &active, 1);
+    }
+    if (game->field.hasAttributes) {
+        hash = HashBytes(hash, game->field.hp, game->field.count);
     }
+
+    hash = HashBytes(hash, &game->powerups.count, sizeof(game->powerups.count));
+    for (int i = 0; i < game->powerups.count; i++) {
+        const PowerUp* powerup = EntityAt(&game->powerups, i);
+        hash = HashBytes(hash, &powerup->position, sizeof(powerup->position));
+    }
+    return hash;
 }
 
-void UpdateBlockCrusher(int screenWidth, int screenHeight, struct GameManager* manager) {
-    if (IsKeyPressed(KEY_P)) game.paused = !game.paused;
-    if (IsKeyPressed(KEY_R)) InitBlockCrusher(screenWidth, screenHeight);
+// Copies src's simulation state into dst, reusing dst's buffers. The block
+// field is left to the caller, since it is by far the largest part and
+// usually cheaper to sync block by block; dst's renderer, recording and
+// rewind history are never touched.
+void CopyBlockCrusherState(BlockCrusherGame* dst, const BlockCrusherGame* src) {
+    BlockField field = dst->field;
+    BallStore balls = dst->balls;
+    EntityPool powerups = dst->powerups;
+    BlockCrusherRenderer renderer = dst->renderer;
+    struct InputRecording* recording = dst->recording;
+    RewindBuffer* rewind = dst->rewind;
+    
+    *dst = *src;
+    dst->field = field;
+    dst->balls = balls;
+    dst->powerups = powerups;
+    dst->renderer = renderer;
+    dst->recording = recording;
+    dst->rewind = rewind;
+    
+    CopyBallStore(&dst->balls, &src->balls);
+    CopyEntityPool(&dst->powerups, &src->powerups);
+}
+
+void UpdateBlockCrusher(BlockCrusherGame* game, struct GameManager* manager) {
     if (IsKeyPressed(KEY_M)) {
         manager->currentGame = GAME_MAIN_MENU;
         return;
     }
     
-    if (game.gameOver || game.paused) return;
-    
-    float baseSpeedX = resize(5.0f, BASE_WIDTH, screenWidth);
-    float baseSpeedY = resize(5.0f, BASE_HEIGHT, screenHeight);
-    float pd_speed = resize(8.0f, BASE_WIDTH, screenWidth);
-    
-    if (IsKeyDown(KEY_LEFT) && game.paddle.rect.x > 0) {
-        game.paddle.rect.x -= pd_speed;
+    // Pause and restart are handed to the next tick rather than applied
+    // here, so every state change happens inside StepBlockCrusher and a
+    // recording of per-tick input is enough to reproduce the session.
+    PROFILE_BEGIN(PROFILE_INPUT);
+    BlockCrusherInput input = ReadBlockCrusherInput();
+    PROFILE_END(PROFILE_INPUT);
+    game->pendingCommands.pause |= input.pause;
+    game->pendingCommands.restart |= input.restart;
+    
+    float tickTime = 1.0f / game->tickRate;
+    float frameTime = manager->frameTime;
+    if (frameTime > MAX_FRAME_TIME) frameTime = MAX_FRAME_TIME;
+    
+    game->accumulator += frameTime;
+    while (game->accumulator >= tickTime) {
+        input.pause = game->pendingCommands.pause;
+        input.restart = game->pendingCommands.restart;
+        game->pendingCommands = (BlockCrusherInput){0};
+        
+        StepBlockCrusher(game, input);
+        if (game->rewind) PushRewind(game->rewind, game);
+        game->accumulator -= tickTime;
     }
-    if (IsKeyDown(KEY_RIGHT) && game.paddle.rect.x < screenWidth - game.paddle.rect.width) {
-        game.paddle.rect.x += pd_speed;
+    game->renderAlpha = (game->gameOver || game->paused) ? 1.0f : game->accumulator / tickTime;
+}
+
+void ApplyBlockCrusherCommands(BlockCrusherGame* game, BlockCrusherInput input) {
+    if (input.pause) game->paused = !game->paused;
+    if (input.restart) {
+        game->levelIndex = 0;
+        InitBlockCrusher(game);
     }
-    
-    for (int ballIdx = 0; ballIdx < MAX_BALLS; ballIdx++) {
-        if (!balls[ballIdx].active) continue;
+}
+
+static Color blockColor(const BlockField* field, int index) {
+    if (!field->hasAttributes) return WHITE;
+    
+    int hp = field->hp[index];
+    switch (field->types[index]) {
+        case BLOCK_HARD:
+            return (hp > 2) ? DARKGRAY : (hp == 2) ? GRAY : WHITE;
+        case BLOCK_POWERUP:
+            return SKYBLUE;
+        default:
+            return WHITE;
+    }
+}
+
+// Hits a block: damaged blocks just get redrawn, destroyed ones score and
+// may drop a powerup (always, for BLOCK_POWERUP).
+static void destroyBlock(BlockCrusherGame* game, int index) {
+    Rectangle rect = GetBlockRect(&game->field, index);
+    int type = GetBlockType(&game->field, index);
+    Color color = blockColor(&game->field, index);
+    bool destroyed = HitBlock(&game->field, index);
+    
+    float centerX = rect.x + rect.width / 2;
+    float centerY = rect.y + rect.height / 2;
+    MarkBlockChanged(&game->renderer, index);
+    QueueParticleBurst(&game->renderer, (ParticleBurst){{centerX, centerY}, color,
+                                                        destroyed ? BURST_BLOCK_DESTROYED : BURST_BLOCK_HIT});
+    if (!destroyed) return;
+    game->score += 10;
+    
+    bool drop = randomInt(game, 100) < POWERUP_DROP_CHANCE;
+    if (drop || type == BLOCK_POWERUP) {
+        SpawnPowerUp(game, centerX, centerY);
+    }
+}
+
+// Re-runs one ball's tick from its previous position with swept collision,
+// handling up to MAX_SWEEP_HITS paddle/block contacts in time order. Only
+// called for balls whose swept bounds touch the paddle or a live block.
+// Returns true when the last block went and the level was reinitialised.
+static bool resolveBallSweep(BlockCrusherGame* game, int ballIdx, int candidateCount) {
+    float dt = game->tickScale;
+    float radius = game->balls.radius[ballIdx];
+    float baseSpeedX = game->ballSpeed;
+    Vector2 position = {game->balls.prevX[ballIdx], game->balls.prevY[ballIdx]};
+    Vector2 speed = {game->balls.vx[ballIdx], game->balls.vy[ballIdx]};
+    
+    // Undo the integration kernel's wall response; it is reapplied below at
+    // the resolved position.
+    if (game->balls.x[ballIdx] >= BLOCK_CRUSHER_WIDTH - radius || game->balls.x[ballIdx] <= radius) speed.x *= -1;
+    if (game->balls.y[ballIdx] <= radius) speed.y *= -1;
+    
+    float remaining = 1.0f;
+    for (int hits = 0; hits < MAX_SWEEP_HITS && remaining > 0.0f; hits++) {
+        Vector2 delta = {speed.x * dt * remaining, speed.y * dt * remaining};
         
-        UpdateBT(&balls[ballIdx]);
+        if (hits > 0) {
+            Rectangle bounds = {fminf(position.x, position.x + delta.x) - radius, 
+                                fminf(position.y, position.y + delta.y) - radius,
+                                fabsf(delta.x) + radius * 2, fabsf(delta.y) + radius * 2};
+            candidateCount = QueryAllBlocks(&game->field, bounds, &game->candidates, &game->candidateCapacity);
+        }
         
-        balls[ballIdx].position.x += balls[ballIdx].speed.x;
-        balls[ballIdx].position.y += balls[ballIdx].speed.y;
+        SweepHit best = {2.0f, {0.0f, 0.0f}};
+        SweepHit hit;
+        int hitBlock = -1;
+        bool hitPaddle = SweepCircleRect(position, delta, radius, game->paddle.rect, &hit);
+        if (hitPaddle) best = hit;
         
-        if (balls[ballIdx].position.x >= screenWidth - balls[ballIdx].radius || 
-            balls[ballIdx].position.x <= balls[ballIdx].radius) {
-            balls[ballIdx].speed.x *= -1;
+        for (int c = 0; c < candidateCount; c++) {
+            int i = game->candidates[c];
+            if (!IsBlockActive(&game->field, i)) continue;
+            if (!SweepCircleRect(position, delta, radius, GetBlockRect(&game->field, i), &hit)) continue;
+            if (hit.time < best.time || (hit.time == best.time && hitBlock >= 0 && i < hitBlock)) {
+                best = hit;
+                hitBlock = i;
+                hitPaddle = false;
+            }
         }
-        if (balls[ballIdx].position.y <= balls[ballIdx].radius) {
-            balls[ballIdx].speed.y *= -1;
+        
+        if (best.time > 1.0f) {
+            position.x += delta.x;
+            position.y += delta.y;
+            remaining = 0.0f;
+            break;
         }
         
-        if (balls[ballIdx].position.y >= screenHeight + balls[ballIdx].radius) {
-            balls[ballIdx].active = false;
-            activeBallCount--;
+        position.x += delta.x * best.time;
+        position.y += delta.y * best.time;
+        remaining *= 1.0f - best.time;
+        
+        if (hitPaddle && best.normal.y < 0.0f) {
+            QueueParticleBurst(&game->renderer, (ParticleBurst){{position.x, game->paddle.rect.y}, LIGHTGRAY, BURST_PADDLE});
+            speed.y = -fabsf(speed.y);
+            float hitPosition = (position.x - game->paddle.rect.x) / game->paddle.rect.width;
+            speed.x = (hitPosition - 0.5f) * baseSpeedX * 2;
+        } else {
+            speed = ReflectVector(speed, best.normal);
+        }
+        
+        if (hitBlock >= 0) {
+            destroyBlock(game, hitBlock);
             
-            if (activeBallCount <= 0) {
-                game.lives--;
-                if (game.lives <= 0) {
-                    game.gameOver = true;
-                } else {
-                    ResetBall(screenWidth, screenHeight);
-                }
+            if (game->field.alive == 0) {
+                game->levelIndex++;
+                startLevel(game);
+                game->score += 100;
+                return true;
             }
         }
+    }
+    
+    if (remaining > 0.0f) {
+        position.x += speed.x * dt * remaining;
+        position.y += speed.y * dt * remaining;
+    }
+    
+    if (position.x >= BLOCK_CRUSHER_WIDTH - radius || position.x <= radius) speed.x *= -1;
+    if (position.y <= radius) speed.y *= -1;
+    
+    game->balls.x[ballIdx] = position.x;
+    game->balls.y[ballIdx] = position.y;
+    game->balls.vx[ballIdx] = speed.x;
+    game->balls.vy[ballIdx] = speed.y;
+    game->balls.active[ballIdx] = position.y < BLOCK_CRUSHER_HEIGHT + radius;
+    return false;
+}
+
+void StepBlockCrusher(BlockCrusherGame* game, BlockCrusherInput input) {
+    game->tick++;
+    if (game->recording) RecordInput(game->recording, input);
+    ApplyBlockCrusherCommands(game, input);
+    
+    if (game->gameOver || game->paused) return;
+    
+    PROFILE_BEGIN(PROFILE_PADDLE);
+    float dt = game->tickScale;
+    float pd_speed = game->paddle.speed.x * dt;
+    
+    game->paddle.prevX = game->paddle.rect.x;
+    
+    bool sampleTrail = false;
+    game->trailClock += dt;
+    if (game->trailClock >= 1.0f) {
+        game->trailClock -= 1.0f;
+        sampleTrail = true;
+    }
+    
+    if (input.left && game->paddle.rect.x > 0) {
+        game->paddle.rect.x -= pd_speed;
+    }
+    if (input.right && game->paddle.rect.x < BLOCK_CRUSHER_WIDTH - game->paddle.rect.width) {
+        game->paddle.rect.x += pd_speed;
+    }
+    PROFILE_END(PROFILE_PADDLE);
+    
+    PROFILE_BEGIN(PROFILE_BALLS);
+    int lostBalls = IntegrateBalls(&game->balls, dt, BLOCK_CRUSHER_WIDTH, BLOCK_CRUSHER_HEIGHT);
+    PROFILE_END(PROFILE_BALLS);
+    
+    PROFILE_BEGIN(PROFILE_COLLISION);
+    for (int ballIdx = 0; ballIdx < game->balls.count; ballIdx++) {
+        Vector2 start = {game->balls.prevX[ballIdx], game->balls.prevY[ballIdx]};
+        float radius = game->balls.radius[ballIdx];
         
-        if (CheckCollisionCircleRec(balls[ballIdx].position, balls[ballIdx].radius, game.paddle.rect)) {
-            balls[ballIdx].speed.y *= -1;
-            
-            float hitPosition = (balls[ballIdx].position.x - game.paddle.rect.x) / game.paddle.rect.width;
-            balls[ballIdx].speed.x = (hitPosition - 0.5f) * baseSpeedX * 2;
+        if (sampleTrail && game->balls.active[ballIdx]) {
+            UpdateBT(&game->balls.trails[ballIdx], start, game->trailTick);
         }
         
-        for (int i = 0; i < game.blocksCount; i++) {
-            if (game.blocks[i].active && 
-                CheckCollisionCircleRec(balls[ballIdx].position, balls[ballIdx].radius, game.blocks[i].rect)) {
-                
-                game.blocks[i].active = false;
-                balls[ballIdx].speed.y *= -1;
-                game.score += 10;
-                
-                if (rand() % 100 < POWERUP_DROP_CHANCE) {
-                    float centerX = game.blocks[i].rect.x + game.blocks[i].rect.width / 2;
-                    float centerY = game.blocks[i].rect.y + game.blocks[i].rect.height / 2;
-                    SpawnPowerUp(centerX, centerY, screenWidth, screenHeight);
-                }
-                
-                bool all_gone = true;
-                for (int j = 0; j < game.blocksCount; j++) {
-                    if (game.blocks[j].active) {
-                        all_gone = false;
-                        break;
-                    }
-                }
-                
-                if (all_gone) {
-                    for (int k = 0; k < MAX_BALLS; k++) {
-                        if (balls[k].active) {
-                            balls[k].speed.x *= 1.1f;
-                            balls[k].speed.y *= 1.1f;
-                        }
-                    }
-                    InitBlockCrusher(screenWidth, screenHeight);
-                    game.score += 100;
-                }
-                
-                break;
-            }
+        Rectangle sweepBounds = {fminf(start.x, game->balls.x[ballIdx]) - radius, fminf(start.y, game->balls.y[ballIdx]) - radius,
+                                 fabsf(game->balls.x[ballIdx] - start.x) + radius * 2,
+                                 fabsf(game->balls.y[ballIdx] - start.y) + radius * 2};
+        int candidateCount = QueryAllBlocks(&game->field, sweepBounds, &game->candidates, &game->candidateCapacity);
+        
+        if (candidateCount == 0 && !CheckCollisionRecs(sweepBounds, game->paddle.rect)) continue;
+        
+        bool wasActive = game->balls.active[ballIdx];
+        if (resolveBallSweep(game, ballIdx, candidateCount)) {
+            lostBalls = 0;
+            continue;
         }
+        lostBalls += wasActive - game->balls.active[ballIdx];
     }
     
-    for (int i = 0; i < MAX_POWERUPS; i++) {
-        if (!powerups[i].active) continue;
-        
-        powerups[i].position.y += powerups[i].speed.y;
+    if (sampleTrail) game->trailTick++;
+    
+    if (lostBalls > 0 && CompactBalls(&game->balls) > 0 && game->balls.count == 0) {
+        game->lives--;
+        if (game->lives <= 0) {
+            game->gameOver = true;
+        } else {
+            ResetBall(game);
+        }
+    }
+    PROFILE_END(PROFILE_COLLISION);
+    
+    PROFILE_BEGIN(PROFILE_POWERUPS);
+    // Despawning swaps the last powerup into slot i, so i only advances past
+    // survivors.
+    for (int i = 0; i < game->powerups.count; ) {
+        PowerUp* powerup = EntityAt(&game->powerups, i);
+        powerup->prevPosition = powerup->position;
+        powerup->position.y += powerup->speed.y * dt;
         
-        if (CheckCollisionCircleRec(powerups[i].position, powerups[i].radius, game.paddle.rect)) {
-            powerups[i].active = false;
-            DoubleBalls(screenWidth, screenHeight);
-            game.score += 50;
+        bool caught = CheckCollisionCircleRec(powerup->position, powerup->radius, game->paddle.rect);
+        bool fell = powerup->position.y > BLOCK_CRUSHER_HEIGHT + powerup->radius;
+        if (!caught && !fell) {
+            i++;
+            continue;
         }
         
-        if (powerups[i].position.y > screenHeight + powerups[i].radius) {
-            powerups[i].active = false;
+        if (caught) QueueParticleBurst(&game->renderer, (ParticleBurst){powerup->position, SKYBLUE, BURST_POWERUP});
+        DespawnEntity(&game->powerups, i);
+        if (caught) {
+            DoubleBalls(game);
+            game->score += 50;
         }
     }
+    PROFILE_END(PROFILE_POWERUPS);
 }
 
-void DrawBlockCrusher(int screenWidth, int screenHeight) {
-    BeginDrawing();
-    ClearBackground(BLACK);
+static void drawBlock(const BlockField* field, int index, int segments) {
+    Rectangle rect = GetBlockRect(field, index);
+    DrawRectangleRounded(rect, 0.3f, segments, blockColor(field, index));
+    DrawRectangleRoundedLines(rect, 0.3f, segments, LIGHTGRAY);
+}
+
+// Blocks are drawn once into blockLayer. Later frames only erase the areas of
+// blocks hit since the last frame and redraw whatever live neighbours
+// reach into them; the whole layer is rebuilt on level init.
+static void updateBlockLayer(BlockCrusherRenderer* renderer, const BlockField* field) {
+    if (renderer->blockLayer.id == 0) {
+        renderer->blockLayer = LoadRenderTexture(BLOCK_CRUSHER_WIDTH, BLOCK_CRUSHER_HEIGHT);
+        renderer->blockLayerStale = true;
+    }
+    if (renderer->destroyedCount > MAX_LAYER_PATCHES) renderer->blockLayerStale = true;
+    if (!renderer->blockLayerStale && renderer->destroyedCount == 0) return;
     
-    for (int i = 0; i < game.blocksCount; i++) {
-        if (game.blocks[i].active) {
-            DrawRectangleRounded(game.blocks[i].rect, 0.3f, 8, WHITE);
-            DrawRectangleRoundedLines(game.blocks[i].rect, 0.3f, 8, LIGHTGRAY);
+    int segments = GetQualitySettings(renderer->qualityLevel).cornerSegments;
+    BeginTextureMode(renderer->blockLayer);
+    
+    if (renderer->blockLayerStale) {
+        ClearBackground(BLANK);
+        for (int i = 0; i < field->count; i++) {
+            if (IsBlockActive(field, i)) drawBlock(field, i, segments);
+        }
+    } else {
+        for (int d = 0; d < renderer->destroyedCount; d++) {
+            Rectangle rect = GetBlockRect(field, renderer->destroyedBlocks[d]);
+            int x0 = (int)floorf(rect.x) - 1;
+            int y0 = (int)floorf(rect.y) - 1;
+            int x1 = (int)ceilf(rect.x + rect.width) + 1;
+            int y1 = (int)ceilf(rect.y + rect.height) + 1;
+            Rectangle patch = {x0, y0, x1 - x0, y1 - y0};
+            
+            BeginScissorMode(x0, y0, x1 - x0, y1 - y0);
+            ClearBackground(BLANK);
+            int count = QueryAllBlocks(field, patch, &renderer->neighbours, &renderer->neighbourCapacity);
+            for (int n = 0; n < count; n++) {
+                drawBlock(field, renderer->neighbours[n], segments);
+            }
+            EndScissorMode();
         }
     }
     
-    DrawRectangleRounded(game.paddle.rect, 0.5f, 8, LIGHTGRAY);
+    EndTextureMode();
+    renderer->blockLayerStale = false;
+    renderer->destroyedCount = 0;
+}
+
+// Queues a block for redrawing; ignored while a full redraw is pending.
+void MarkBlockChanged(BlockCrusherRenderer* renderer, int index) {
+    if (renderer->blockLayerStale) return;
+    if (renderer->destroyedCount == renderer->destroyedCapacity) {
+        renderer->destroyedCapacity = renderer->destroyedCapacity ? renderer->destroyedCapacity * 2 : 64;
+        renderer->destroyedBlocks = realloc(renderer->destroyedBlocks, renderer->destroyedCapacity * sizeof(int));
+    }
+    renderer->destroyedBlocks[renderer->destroyedCount++] = index;
+}
+
+// Patching the block layer at a new corner segment count would mix both, so
+// a change of segments redraws it whole.
+void SetBlockCrusherQuality(BlockCrusherRenderer* renderer, int level) {
+    if (level == renderer->qualityLevel) return;
+    if (GetQualitySettings(level).cornerSegments != GetQualitySettings(renderer->qualityLevel).cornerSegments) {
+        renderer->blockLayerStale = true;
+    }
+    renderer->qualityLevel = level;
+    renderer->stillFrame = false;
+}
+
+// Ignored until something draws the bursts; see BlockCrusherRenderer.
+void QueueParticleBurst(BlockCrusherRenderer* renderer, ParticleBurst burst) {
+    if (!renderer->collectBursts || renderer->burstCount == MAX_PENDING_BURSTS) return;
+    if (renderer->burstCount == renderer->burstCapacity) {
+        renderer->burstCapacity = renderer->burstCapacity ? renderer->burstCapacity * 2 : 64;
+        renderer->bursts = realloc(renderer->bursts, renderer->burstCapacity * sizeof(ParticleBurst));
+    }
+    renderer->bursts[renderer->burstCount++] = burst;
+}
+
+// Turns queued bursts into particles and advances them by frameTime; they
+// hold still while the game is paused.
+static void updateParticles(BlockCrusherRenderer* renderer, const BlockCrusherGame* game, float frameTime) {
+    ParticleSystem* particles = &renderer->particles;
+    if (particles->capacity == 0) InitParticles(particles, MAX_PARTICLES);
+    
+    for (int i = 0; i < renderer->burstCount; i++) {
+        EmitParticleBurst(particles, &renderer->bursts[i]);
+    }
+    renderer->burstCount = 0;
     
-    for (int i = 0; i < MAX_BALLS; i++) {
-        if (balls[i].active) {
-            DrawBallWithTrail(&balls[i]);
-        }
+    if (frameTime > MAX_FRAME_TIME) frameTime = MAX_FRAME_TIME;
+    if (!game->paused) UpdateParticles(particles, frameTime);
+}
+
+// Particles keep moving after the game ends, so a finished game only holds
+// still once they are gone; a paused game's particles are frozen with it.
+static bool isStill(const BlockCrusherGame* game) {
+    return game->paused || (game->gameOver && game->renderer.particles.count == 0);
+}
+
+void DrawBlockCrusher(BlockCrusherGame* game, float frameTime, int windowWidth, int windowHeight) {
+    BlockCrusherRenderer* renderer = &game->renderer;
+    // A loaded save state or rewind leaves the game paused or over but
+    // different, and always marks the block layer stale.
+    if (renderer->stillFrame && isStill(game) && !renderer->blockLayerStale) {
+        PROFILE_BEGIN(PROFILE_BLIT);
+        DrawPresentation(&renderer->presentation, windowWidth, windowHeight);
+        PROFILE_END(PROFILE_BLIT);
+        return;
+    }
+    DrawBlockCrusherState(renderer, game, game->renderAlpha, frameTime, windowWidth, windowHeight);
+    renderer->stillFrame = isStill(game);
+}
+
+// Draws game with renderer's resources rather than its own, so game can be a
+// snapshot whose simulation runs on another thread. frameTime is how far
+// the particles move, since raylib's GetFrameTime includes any time spent
+// waiting on an idle screen.
+void DrawBlockCrusherState(BlockCrusherRenderer* renderer, const BlockCrusherGame* game, float alpha,
+                           float frameTime, int windowWidth, int windowHeight) {
+    QualitySettings quality = GetQualitySettings(renderer->qualityLevel);
+    
+    PROFILE_BEGIN(PROFILE_BLOCK_LAYER);
+    updateBlockLayer(renderer, &game->field);
+    
+    BeginScaledPresentation(&renderer->presentation, BLOCK_CRUSHER_WIDTH, BLOCK_CRUSHER_HEIGHT, quality.renderScale);
+    ClearBackground(BLACK);
+    
+    DrawTextureRec(renderer->blockLayer.texture, 
+                   (Rectangle){0, 0, renderer->blockLayer.texture.width, -renderer->blockLayer.texture.height}, 
+                   (Vector2){0, 0}, WHITE);
+    PROFILE_END(PROFILE_BLOCK_LAYER);
+    
+    // Particles share the balls' glow batch, under them, so the whole lot is
+    // still one batched draw.
+    PROFILE_BEGIN(PROFILE_PARTICLES);
+    renderer->collectBursts = true;
+    updateParticles(renderer, game, frameTime);
+    BeginGlowBatch(&renderer->glowBatch);
+    AddParticleSprites(&renderer->glowBatch, &renderer->particles);
+    PROFILE_END(PROFILE_PARTICLES);
+    
+    PROFILE_BEGIN(PROFILE_SPRITES);
+    if (!renderer->latePaddle || game->paused || game->gameOver) {
+        Rectangle paddleRect = game->paddle.rect;
+        paddleRect.x = game->paddle.prevX + (game->paddle.rect.x - game->paddle.prevX) * alpha;
+        DrawRectangleRounded(paddleRect, 0.5f, quality.cornerSegments, LIGHTGRAY);
     }
     
-    for (int i = 0; i < MAX_POWERUPS; i++) {
-        if (powerups[i].active) {
-            DrawCircleV(powerups[i].position, powerups[i].radius, BLUE);
-            DrawCircleV(powerups[i].position, powerups[i].radius * 1.2f, Fade(SKYBLUE, 0.5f));
-            DrawCircle(powerups[i].position.x - powerups[i].radius/3, 
-                      powerups[i].position.y - powerups[i].radius/3, 
-                      powerups[i].radius/4, Fade(WHITE, 0.8f));
-        }
+    ReserveGlowSprites(&renderer->glowBatch, game->balls.count * (quality.trailLength * 2 + 3));
+    for (int i = 0; i < game->balls.count; i++) {
+        AddBallSprites(&renderer->glowBatch, &game->balls, i, game->trailTick, alpha, &quality);
     }
+    DrawGlowBatch(&renderer->glowBatch);
+    
+    for (int i = 0; i < game->powerups.count; i++) {
+        const PowerUp* powerup = EntityAt(&game->powerups, i);
+        Vector2 position = lerpV(powerup->prevPosition, powerup->position, alpha);
+        DrawCircleV(position, powerup->radius, BLUE);
+        if (!quality.glow) continue;
+        DrawCircleV(position, powerup->radius * 1.2f, Fade(SKYBLUE, 0.5f));
+        DrawCircle(position.x - powerup->radius/3, 
+                  position.y - powerup->radius/3, 
+                  powerup->radius/4, Fade(WHITE, 0.8f));
+    }
+    PROFILE_END(PROFILE_SPRITES);
     
-    int fontSize = resize(20, BASE_HEIGHT, screenHeight);
-    int uiPadding = resize(10, BASE_HEIGHT, screenHeight);
+    PROFILE_BEGIN(PROFILE_HUD);
+    int fontSize = 20;
+    int uiPadding = 10;
     
-    const char* scoreText = TextFormat("SCORE: %04d", game.score);
+    const char* scoreText = TextFormat("SCORE: %04d", game->score);
     int scoretxt_width = MeasureText(scoreText, fontSize);
     DrawText(scoreText, uiPadding, uiPadding, fontSize, GREEN);
     
-    const char* livesText = TextFormat("LIVES: %d", game.lives);
+    const char* livesText = TextFormat("LIVES: %d", game->lives);
     int livestxt_width = MeasureText(livesText, fontSize);
-    DrawText(livesText, screenWidth - livestxt_width - uiPadding, uiPadding, fontSize, GREEN);
+    DrawText(livesText, BLOCK_CRUSHER_WIDTH - livestxt_width - uiPadding, uiPadding, fontSize, GREEN);
     
-    const char* ballsText = TextFormat("BALLS: %d", activeBallCount);
+    const char* ballsText = TextFormat("BALLS: %d", game->balls.count);
     int ballstxt_width = MeasureText(ballsText, fontSize);
-    DrawText(ballsText, screenWidth/2 - ballstxt_width/2, uiPadding, fontSize, YELLOW);
+    DrawText(ballsText, BLOCK_CRUSHER_WIDTH/2 - ballstxt_width/2, uiPadding, fontSize, YELLOW);
     
-    if (game.paused) {
-        DrawRectangle(0, 0, screenWidth, screenHeight, Fade(BLACK, 0.7f));
+    if (game->paused) {
+        DrawRectangle(0, 0, BLOCK_CRUSHER_WIDTH, BLOCK_CRUSHER_HEIGHT, Fade(BLACK, 0.7f));
         
-        int pause_fs = resize(40, BASE_HEIGHT, screenHeight);
+        int pause_fs = 40;
         const char* pauseText = "GAME PAUSED";
         int pausetxt_width = MeasureText(pauseText, pause_fs);
-        DrawText(pauseText, screenWidth/2 - pausetxt_width/2, 
-                screenHeight/2 - resize(60, BASE_HEIGHT, screenHeight), pause_fs, YELLOW);
+        DrawText(pauseText, BLOCK_CRUSHER_WIDTH/2 - pausetxt_width/2, 
+                BLOCK_CRUSHER_HEIGHT/2 - 60, pause_fs, YELLOW);
         
-        int ins_fs = resize(20, BASE_HEIGHT, screenHeight);
+        int ins_fs = 20;
         const char* instructionText = "Press P to continue";
         int instxt_width = MeasureText(instructionText, ins_fs);
-        DrawText(instructionText, screenWidth/2 - instxt_width/2, 
-                screenHeight/2 + resize(20, BASE_HEIGHT, screenHeight), ins_fs, WHITE);
+        DrawText(instructionText, BLOCK_CRUSHER_WIDTH/2 - instxt_width/2, 
+                BLOCK_CRUSHER_HEIGHT/2 + 20, ins_fs, WHITE);
     }
     
-    if (game.gameOver) {
-        DrawRectangle(0, 0, screenWidth, screenHeight, Fade(BLACK, 0.7f));
+    if (game->gameOver) {
+        DrawRectangle(0, 0, BLOCK_CRUSHER_WIDTH, BLOCK_CRUSHER_HEIGHT, Fade(BLACK, 0.7f));
         
-        int go_fs = resize(50, BASE_HEIGHT, screenHeight);
+        int go_fs = 50;
         const char* gameOverText = "GAME OVER";
         int gotxt_width = MeasureText(gameOverText, go_fs);
-        DrawText(gameOverText, screenWidth/2 - gotxt_width/2, 
-                screenHeight/2 - resize(80, BASE_HEIGHT, screenHeight), go_fs, RED);
+        DrawText(gameOverText, BLOCK_CRUSHER_WIDTH/2 - gotxt_width/2, 
+                BLOCK_CRUSHER_HEIGHT/2 - 80, go_fs, RED);
         
-        int score_fs = resize(30, BASE_HEIGHT, screenHeight);
-        const char* finalScoreText = TextFormat("FINAL SCORE: %04d", game.score);
+        int score_fs = 30;
+        const char* finalScoreText = TextFormat("FINAL SCORE: %04d", game->score);
         int finalscoretxt_width = MeasureText(finalScoreText, score_fs);
-        DrawText(finalScoreText, screenWidth/2 - finalscoretxt_width/2, 
-                screenHeight/2, score_fs, YELLOW);
+        DrawText(finalScoreText, BLOCK_CRUSHER_WIDTH/2 - finalscoretxt_width/2, 
+                BLOCK_CRUSHER_HEIGHT/2, score_fs, YELLOW);
         
-        int rst_fs = resize(20, BASE_HEIGHT, screenHeight);
+        int rst_fs = 20;
         const char* restartText = "Press R to restart";
         int rstxt_width = MeasureText(restartText, rst_fs);
-        DrawText(restartText, screenWidth/2 - rstxt_width/2, 
-                screenHeight/2 + resize(60, BASE_HEIGHT, screenHeight), rst_fs, WHITE);
+        DrawText(restartText, BLOCK_CRUSHER_WIDTH/2 - rstxt_width/2, 
+                BLOCK_CRUSHER_HEIGHT/2 + 60, rst_fs, WHITE);
     }
     
-    int ctrl_fs = resize(16, BASE_HEIGHT, screenHeight);
+    int ctrl_fs = 16;
     const char* controlsText = "CONTROLS: Arrow Keys = Move, P = Pause, R = Restart, M = Menu | Blue balls = Double your balls!";
     int ctrltxt_width = MeasureText(controlsText, ctrl_fs);
     
-    if (ctrltxt_width > screenWidth - uiPadding * 2) {
-        ctrl_fs = resize(14, BASE_HEIGHT, screenHeight);
+    if (ctrltxt_width > BLOCK_CRUSHER_WIDTH - uiPadding * 2) {
+        ctrl_fs = 14;
         ctrltxt_width = MeasureText(controlsText, ctrl_fs);
     }
     
-    DrawText(controlsText, screenWidth/2 - ctrltxt_width/2, 
-            screenHeight - ctrl_fs - uiPadding, ctrl_fs, GRAY);
+    DrawText(controlsText, BLOCK_CRUSHER_WIDTH/2 - ctrltxt_width/2, 
+            BLOCK_CRUSHER_HEIGHT - ctrl_fs - uiPadding, ctrl_fs, GRAY);
+    PROFILE_END(PROFILE_HUD);
     
-    EndDrawing();
+    PROFILE_BEGIN(PROFILE_BLIT);
+    EndPresentation(&renderer->presentation, windowWidth, windowHeight);
+    PROFILE_END(PROFILE_BLIT);
 }
 
-void CloseBlockCrusher(void) {
-    if (game.blocks != NULL) {
-        free(game.blocks);
-        game.blocks = NULL;
-    }
+// Draws the paddle over the finished frame, in window space, from input
+// latched after the frame was simulated: rather than trailing a tick behind
+// between its last two positions, it moves from its current position
+// towards where the next tick will put it given the keys held now. When the
+// next tick runs with the same keys the two agree, so a held key shows no
+// seam; only the picture is ahead, the simulation still ticks on its own
+// input.
+void DrawLatePaddle(const BlockCrusherRenderer* renderer, const BlockCrusherGame* game, BlockCrusherInput input,
+                    int windowWidth, int windowHeight) {
+    if (!renderer->latePaddle || game->paused || game->gameOver) return;
+    
+    Rectangle paddle = game->paddle.rect;
+    float step = game->paddle.speed.x * game->tickScale;
+    float next = paddle.x;
+    if (input.left && paddle.x > 0) next -= step;
+    if (input.right && paddle.x < BLOCK_CRUSHER_WIDTH - paddle.width) next += step;
+    paddle.x += (next - paddle.x) * game->renderAlpha;
+    
+    Rectangle box = LetterboxRect(BLOCK_CRUSHER_WIDTH, BLOCK_CRUSHER_HEIGHT, windowWidth, windowHeight);
+    float scale = box.width / BLOCK_CRUSHER_WIDTH;
+    Rectangle onScreen = {box.x + paddle.x * scale, box.y + paddle.y * scale, paddle.width * scale,
+                          paddle.height * scale};
+    DrawRectangleRounded(onScreen, 0.5f, GetQualitySettings(renderer->qualityLevel).cornerSegments, LIGHTGRAY);
 }
 
-void ResetBall(int screenWidth, int screenHeight) {
-    balls[0].position = (Vector2){screenWidth/2, screenHeight/2};
-    balls[0].speed = (Vector2){resize(5.0f, BASE_WIDTH, screenWidth), 
-                               resize(5.0f, BASE_HEIGHT, screenHeight)};
-    balls[0].active = true;
-    
-    for (int i = 0; i < BALL_TRAIL_LENGTH; i++) {
-        balls[0].trail[i] = balls[0].position;
-        balls[0].trailAlpha[i] = 0.0f;
-        balls[0].trailSize[i] = balls[0].radius;
+void CloseBlockCrusher(BlockCrusherGame* game) {
+    FreeBlockField(&game->field);
+    FreeBallStore(&game->balls);
+    FreeEntityPool(&game->powerups);
+    free(game->candidates);
+    game->candidates = NULL;
+    game->candidateCapacity = 0;
+    
+    UnloadBlockCrusherRenderer(&game->renderer);
+}
+
+void UnloadBlockCrusherRenderer(BlockCrusherRenderer* renderer) {
+    if (renderer->blockLayer.id != 0) {
+        UnloadRenderTexture(renderer->blockLayer);
+        renderer->blockLayer = (RenderTexture2D){0};
     }
-    balls[0].trailIndex = 0;
+    UnloadGlowBatch(&renderer->glowBatch);
+    UnloadPresentation(&renderer->presentation);
+    free(renderer->destroyedBlocks);
+    renderer->destroyedBlocks = NULL;
+    renderer->destroyedCount = 0;
+    renderer->destroyedCapacity = 0;
+    free(renderer->neighbours);
+    renderer->neighbours = NULL;
+    renderer->neighbourCapacity = 0;
+    renderer->blockLayerStale = true;
+    free(renderer->bursts);
+    renderer->bursts = NULL;
+    renderer->burstCount = 0;
+    renderer->burstCapacity = 0;
+    renderer->collectBursts = false;
+    FreeParticles(&renderer->particles);
+}
+
+void ResetBall(BlockCrusherGame* game) {
+    float radius = (game->balls.count > 0) ? game->balls.radius[0] : game->ballRadius;
     
-    for (int i = 1; i < MAX_BALLS; i++) {
-        balls[i].active = false;
-    }
-    activeBallCount = 1;
+    ClearBalls(&game->balls);
+    AddBall(&game->balls, (Vector2){BLOCK_CRUSHER_WIDTH/2, BLOCK_CRUSHER_HEIGHT/2},
+            (Vector2){game->ballSpeed, game->ballSpeed},
+            radius);
     
-    for (int i = 0; i < MAX_POWERUPS; i++) {
-        powerups[i].active = false;
-    }
+    clearPowerUps(game);
 }
 
-void UpdateBT(Ball *ball) {
-    ball->trail[ball->trailIndex] = ball->position;
-    ball->trailAlpha[ball->trailIndex] = 1.0f;
-    ball->trailSize[ball->trailIndex] = ball->radius;
-    ball->trailIndex = (ball->trailIndex + 1) % BALL_TRAIL_LENGTH;
-    
-    for (int i = 0; i < BALL_TRAIL_LENGTH; i++) {
-        if (ball->trailAlpha[i] > 0.0f) {
-            ball->trailAlpha[i] -= 1.0f / BALL_TRAIL_LENGTH;
-            ball->trailSize[i] -= ball->radius / BALL_TRAIL_LENGTH;
-            
-            if (ball->trailAlpha[i] < 0.0f) ball->trailAlpha[i] = 0.0f;
-            if (ball->trailSize[i] < 1.0f) ball->trailSize[i] = 1.0f;
-        }
-    }
+void UpdateBT(BallTrail *trail, Vector2 position, uint32_t trailTick) {
+    trail->position[trail->head] = position;
+    trail->tick[trail->head] = (uint16_t)trailTick;
+    trail->head = (trail->head + 1) % BALL_TRAIL_LENGTH;
+    if (trail->count < BALL_TRAIL_LENGTH) trail->count++;
 }
 
-void DrawBallWithTrail(Ball *ball) {
-    for (int i = 0; i < BALL_TRAIL_LENGTH; i++) {
-        int index = (ball->trailIndex + i) % BALL_TRAIL_LENGTH;
+static Color fadeColor(Color color, float alpha) {
+    return (Color){color.r, color.g, color.b, (unsigned char)(color.a * alpha)};
+}
+
+// Draws the newest quality->trailLength trail samples, faded over that
+// length rather than the full trail.
+void AddBallSprites(GlowBatch *batch, const BallStore *store, int index, uint32_t trailTick, float alpha,
+                    const QualitySettings *quality) {
+    const BallTrail* trail = &store->trails[index];
+    float radius = store->radius[index];
+    Vector2 position = lerpV((Vector2){store->prevX[index], store->prevY[index]},
+                             (Vector2){store->x[index], store->y[index]}, alpha);
+    int length = quality->trailLength;
+    int samples = trail->count < length ? trail->count : length;
+    
+    for (int i = samples; i > 0; i--) {
+        int k = (trail->head - i + BALL_TRAIL_LENGTH) % BALL_TRAIL_LENGTH;
+        int age = (uint16_t)((uint16_t)trailTick - trail->tick[k]);
         
-        if (ball->trailAlpha[index] > 0.0f) {
-            float easedAlpha = ball->trailAlpha[index] * ball->trailAlpha[index];
-            Color trailColor = Fade(WHITE, easedAlpha * 0.7f);
-            DrawCircleV(ball->trail[index], ball->trailSize[index], trailColor);
-            
-            if (ball->trailAlpha[index] > 0.3f) {
-                DrawCircleV(ball->trail[index], ball->trailSize[index] * 1.2f, 
-                           Fade((Color){200, 200, 255, 255}, easedAlpha * 0.3f));
-            }
+        float trailAlpha = 1.0f - age / (float)length;
+        if (trailAlpha <= 0.0f) continue;
+        
+        float trailSize = radius - age * radius / length;
+        if (trailSize < 1.0f) trailSize = 1.0f;
+        
+        float easedAlpha = trailAlpha * trailAlpha;
+        AddGlowSprite(batch, trail->position[k], trailSize, fadeColor(WHITE, easedAlpha * 0.7f));
+        
+        if (quality->trailHalo && trailAlpha > 0.3f) {
+            AddGlowSprite(batch, trail->position[k], trailSize * 1.2f, 
+                          fadeColor((Color){200, 200, 255, 255}, easedAlpha * 0.3f));
         }
     }
     
-    DrawCircleV(ball->position, ball->radius, WHITE);
-    DrawCircleV(ball->position, ball->radius * 1.1f, Fade(WHITE, 0.3f));
-    DrawCircle(ball->position.x - ball->radius/3, ball->position.y - ball->radius/3, 
-               ball->radius/4, Fade(WHITE, 0.8f));
-}
\ No newline at end of file
+    AddGlowSprite(batch, position, radius, WHITE);
+    if (!quality->glow) return;
+    AddGlowSprite(batch, position, radius * 1.1f, fadeColor(WHITE, 0.3f));
+    AddGlowSprite(batch, (Vector2){position.x - radius/3, position.y - radius/3}, 
+                  radius/4, fadeColor(WHITE, 0.8f));
+}
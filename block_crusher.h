@@ -2,49 +2,153 @@
 #define BLOCK_CRUSHER_H
 
 #include "raylib.h"
+#include "block_field.h"
+#include "ball_store.h"
+#include "entity_pool.h"
+#include "glow_batch.h"
+#include "particles.h"
+#include "presentation.h"
+#include "quality.h"
 #include <stdbool.h>
 
-typedef struct {
-    Vector2 position;
-    Vector2 speed;
-    float radius;
-    bool active;
-    Vector2 trail[16];
-    float trailAlpha[16];
-    float trailSize[16];
-    int trailIndex;
-} Ball;
+// Block Crusher always simulates and draws in this logical space; the
+// window only changes how the finished frame is scaled.
+#define BLOCK_CRUSHER_WIDTH 800
+#define BLOCK_CRUSHER_HEIGHT 600
 
 typedef struct {
     Rectangle rect;
+    float prevX;
     Vector2 speed;
     bool active;
 } Paddle;
 
 typedef struct {
-    Rectangle rect;
-    bool active;
-} Block;
+    Vector2 position;
+    Vector2 prevPosition;
+    Vector2 speed;
+    float radius;
+} PowerUp;
+
+typedef struct {
+    bool left;
+    bool right;
+    bool pause;
+    bool restart;
+} BlockCrusherInput;
+
+struct InputRecording;
+struct LevelSet;
+struct RewindBuffer;
+
+// Draw-side resources. Blocks are drawn once into blockLayer; later frames
+// only patch the blocks listed in destroyedBlocks, and blockLayerStale forces
+// a full redraw. Ticks queue particle bursts in bursts once collectBursts is
+// set by a first draw (or a simulation thread), so headless runs skip them.
+// qualityLevel picks the QualitySettings to draw with; 0 is full quality.
+// latePaddle leaves the moving paddle to DrawLatePaddle. stillFrame is set
+// while the presentation target holds a paused or finished game's last
+// frame, which only input can change; DrawBlockCrusher then blits it again
+// instead of redrawing.
+typedef struct {
+    RenderTexture2D blockLayer;
+    bool blockLayerStale;
+    int* destroyedBlocks;
+    int destroyedCount;
+    int destroyedCapacity;
+    int* neighbours;        // scratch for redrawing around destroyed blocks
+    int neighbourCapacity;
+    ParticleBurst* bursts;
+    int burstCount;
+    int burstCapacity;
+    bool collectBursts;
+    ParticleSystem particles;
+    GlowBatch glowBatch;
+    Presentation presentation;
+    int qualityLevel;
+    bool latePaddle;
+    bool stillFrame;
+} BlockCrusherRenderer;
 
+// Everything one Block Crusher game owns. A zeroed context plus the Set*
+// calls is a valid starting point; contexts share nothing, so separate games
+// can be stepped on separate threads.
 typedef struct {
-    Ball ball;
     Paddle paddle;
-    Block* blocks;
-    int blocksCount;
+    BlockField field;
+    BallStore balls;
+    EntityPool powerups;    // of PowerUp, dense and unbounded
+    int* candidates;        // scratch for the blocks under a ball's sweep
+    int candidateCapacity;
     int score;
     int lives;
     bool gameOver;
     bool paused;
+    int tickRate;
+    float tickScale;
+    float trailClock;
+    uint32_t trailTick;
+    uint64_t rngState;
+    uint64_t tick;          // StepBlockCrusher calls so far; not hashed or saved
+    
+    int layoutRows;
+    int layoutCols;
+    int startBallCount;
+    int maxBallCount;
+    
+    const struct LevelSet* levels;
+    int levelIndex;
+    int levelStartBalls;
+    float ballSpeed;
+    float ballRadius;
+    float paddleWidth;
+    float paddleSpeed;
+    
+    float accumulator;
+    float renderAlpha;
+    BlockCrusherInput pendingCommands;
+    struct InputRecording* recording;
+    struct RewindBuffer* rewind;
+    
+    BlockCrusherRenderer renderer;
 } BlockCrusherGame;
 
 struct GameManager;
+struct InputRecording;
+struct LevelSet;
 
-void InitBlockCrusher(int screenWidth, int screenHeight);
-void UpdateBlockCrusher(int screenWidth, int screenHeight, struct GameManager* manager);
-void DrawBlockCrusher(int screenWidth, int screenHeight);
-void CloseBlockCrusher(void);
-void ResetBall(int screenWidth, int screenHeight);
-void UpdateBT(Ball *ball);
-void DrawBallWithTrail(Ball *ball);
+void SetBlockCrusherTickRate(BlockCrusherGame* game, int tickRate);
+void SetBlockCrusherLayout(BlockCrusherGame* game, int rows, int cols);
+void SetBlockCrusherBalls(BlockCrusherGame* game, int startBalls, int maxBalls);
+void SetBlockCrusherSeed(BlockCrusherGame* game, uint64_t seed);
+void SetBlockCrusherRecording(BlockCrusherGame* game, struct InputRecording* recording);
+void SetBlockCrusherRewind(BlockCrusherGame* game, struct RewindBuffer* rewind);
+void SetBlockCrusherLevels(BlockCrusherGame* game, const struct LevelSet* levels);
+bool ExportBlockCrusherLevel(const BlockCrusherGame* game, const char* path);
+uint64_t HashBlockCrusherState(const BlockCrusherGame* game);
+void InitBlockCrusher(BlockCrusherGame* game);
+void LoadBlockCrusherLevel(BlockCrusherGame* game);
+void UpdateBlockCrusher(BlockCrusherGame* game, struct GameManager* manager);
+void ApplyBlockCrusherCommands(BlockCrusherGame* game, BlockCrusherInput input);
+void StepBlockCrusher(BlockCrusherGame* game, BlockCrusherInput input);
+BlockCrusherInput ReadBlockCrusherInput(void);
+BlockCrusherInput AutopilotBlockCrusher(const BlockCrusherGame* game);
+void CopyBlockCrusherState(BlockCrusherGame* dst, const BlockCrusherGame* src);
+void DrawBlockCrusher(BlockCrusherGame* game, float frameTime, int windowWidth, int windowHeight);
+void DrawBlockCrusherState(BlockCrusherRenderer* renderer, const BlockCrusherGame* game, float alpha,
+                           float frameTime, int windowWidth, int windowHeight);
+void DrawLatePaddle(const BlockCrusherRenderer* renderer, const BlockCrusherGame* game, BlockCrusherInput input,
+                    int windowWidth, int windowHeight);
+void MarkBlockChanged(BlockCrusherRenderer* renderer, int index);
+void QueueParticleBurst(BlockCrusherRenderer* renderer, ParticleBurst burst);
+void SetBlockCrusherQuality(BlockCrusherRenderer* renderer, int level);
+void UnloadBlockCrusherRenderer(BlockCrusherRenderer* renderer);
+void CloseBlockCrusher(BlockCrusherGame* game);
+EntityHandle SpawnPowerUp(BlockCrusherGame* game, float x, float y);
+void ResetBall(BlockCrusherGame* game);
+void DoubleBalls(BlockCrusherGame* game);
+void UpdateBT(BallTrail *trail, Vector2 position, uint32_t trailTick);
+void AddBallSprites(GlowBatch *batch, const BallStore *store, int index, uint32_t trailTick, float alpha,
+                    const QualitySettings *quality);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "block_crusher_thread.h"
+#include "input_recording.h"
+#include "game_util.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SNAPSHOT_FRESH 4
+#define SNAPSHOT_INDEX 3
+#define MAX_SNAPSHOT_CHANGES 256
+#define MAX_LOG_ENTRIES (1 << 16)
+#define MAX_CATCH_UP 0.25
+
+static void sleepUntil(double time) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)time;
+    ts.tv_nsec = (long)((time - ts.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+// Moves the blocks the last tick hit from the game's own change list into
+// the log. A rebuilt field shows up as a stale block layer.
+static void collectBlockChanges(BlockCrusherThread* t) {
+    BlockCrusherRenderer* changes = &t->game->renderer;
+
+    if (changes->blockLayerStale) {
+        t->generation++;
+        t->logStart = t->serial;
+        t->logCount = 0;
+        changes->blockLayerStale = false;
+    } else if (changes->destroyedCount > 0) {
+        int needed = t->logCount + changes->destroyedCount;
+        if (needed > t->logCapacity) {
+            while (t->logCapacity < needed) t->logCapacity = t->logCapacity ? t->logCapacity * 2 : 256;
+            t->log = realloc(t->log, t->logCapacity * sizeof(int));
+        }
+        memcpy(t->log + t->logCount, changes->destroyedBlocks, changes->destroyedCount * sizeof(int));
+        t->logCount += changes->destroyedCount;
+        t->serial += changes->destroyedCount;
+    }
+    changes->destroyedCount = 0;
+}
+
+// Bursts that do not fit in the ring are dropped; they are only sparks.
+static void forwardBursts(BlockCrusherThread* t) {
+    BlockCrusherRenderer* queued = &t->game->renderer;
+    unsigned head = atomic_load_explicit(&t->burstHead, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&t->burstTail, memory_order_acquire);
+
+    for (int i = 0; i < queued->burstCount && head - tail < BURST_RING_SIZE; i++) {
+        t->bursts[head++ % BURST_RING_SIZE] = queued->bursts[i];
+    }
+    atomic_store_explicit(&t->burstHead, head, memory_order_release);
+    queued->burstCount = 0;
+}
+
+static void syncField(BlockCrusherThread* t, BlockCrusherSnapshot* s) {
+    BlockField* field = &s->state.field;
+
+    if (s->generation != t->generation || s->serial < t->logStart) {
+        CopyBlockField(field, &t->game->field);
+    } else {
+        for (uint64_t serial = s->serial; serial < t->serial; serial++) {
+            CopyBlockState(field, &t->game->field, t->log[serial - t->logStart]);
+        }
+    }
+    s->generation = t->generation;
+    s->serial = t->serial;
+}
+
+static void fillChanges(BlockCrusherThread* t, BlockCrusherSnapshot* s) {
+    uint64_t ackGeneration = atomic_load_explicit(&t->ackGeneration, memory_order_acquire);
+    uint64_t ackSerial = atomic_load_explicit(&t->ackSerial, memory_order_relaxed);
+
+    s->changedCount = 0;
+    s->changedFrom = UINT64_MAX;
+    if (ackGeneration != t->generation || ackSerial < t->logStart) return;
+    if (t->serial - ackSerial > MAX_SNAPSHOT_CHANGES) return;
+
+    int count = (int)(t->serial - ackSerial);
+    if (count > s->changedCapacity) {
+        s->changedCapacity = MAX_SNAPSHOT_CHANGES;
+        s->changed = realloc(s->changed, s->changedCapacity * sizeof(int));
+    }
+    memcpy(s->changed, t->log + (ackSerial - t->logStart), count * sizeof(int));
+    s->changedCount = count;
+    s->changedFrom = ackSerial;
+}
+
+// Drops log entries that every buffer and the renderer are already past.
+static void trimLog(BlockCrusherThread* t) {
+    uint64_t keep = t->serial;
+    for (int i = 0; i < SNAPSHOT_BUFFERS; i++) {
+        const BlockCrusherSnapshot* s = &t->snapshots[i];
+        if (s->generation == t->generation && s->serial < keep) keep = s->serial;
+    }
+    uint64_t ackGeneration = atomic_load_explicit(&t->ackGeneration, memory_order_acquire);
+    uint64_t ackSerial = atomic_load_explicit(&t->ackSerial, memory_order_relaxed);
+    if (ackGeneration == t->generation && ackSerial < keep) keep = ackSerial;
+
+    if (keep < t->logStart) keep = t->logStart;
+    if (t->serial - keep > MAX_LOG_ENTRIES) keep = t->serial;
+
+    int drop = (int)(keep - t->logStart);
+    if (drop == 0) return;
+    memmove(t->log, t->log + drop, (t->logCount - drop) * sizeof(int));
+    t->logCount -= drop;
+    t->logStart = keep;
+}
+
+static void publish(BlockCrusherThread* t, double tickTime) {
+    BlockCrusherSnapshot* s = &t->snapshots[t->back];
+    CopyBlockCrusherState(&s->state, t->game);
+    syncField(t, s);
+    fillChanges(t, s);
+    s->tickTime = tickTime;
+
+    int previous = atomic_exchange_explicit(&t->latest, t->back | SNAPSHOT_FRESH, memory_order_acq_rel);
+    t->back = previous & SNAPSHOT_INDEX;
+    trimLog(t);
+}
+
+static void* simulationMain(void* arg) {
+    BlockCrusherThread* t = arg;
+    double tickDuration = 1.0 / t->game->tickRate;
+    double next = MonotonicSeconds() + tickDuration;
+
+    while (atomic_load_explicit(&t->running, memory_order_relaxed)) {
+        double now = MonotonicSeconds();
+        if (now < next) {
+            sleepUntil(next);
+            continue;
+        }
+
+        // After a long stall, drop the backlog rather than racing through it.
+        double lateness = now - next;
+        if (lateness > MAX_CATCH_UP) next = now;
+        t->totalLateness += lateness;
+        if (lateness > t->maxLateness) t->maxLateness = lateness;
+
+        unsigned held = atomic_load_explicit(&t->heldInput, memory_order_relaxed);
+        unsigned pending = atomic_exchange_explicit(&t->pendingInput, 0, memory_order_relaxed);
+        StepBlockCrusher(t->game, UnpackBlockCrusherInput((uint8_t)(held | pending)));
+        t->tickCount++;
+
+        collectBlockChanges(t);
+        forwardBursts(t);
+        publish(t, next);
+        next += tickDuration;
+    }
+    return NULL;
+}
+
+void StartBlockCrusherThread(BlockCrusherThread* t, BlockCrusherGame* game) {
+    memset(t, 0, sizeof(*t));
+    t->game = game;
+    t->back = 0;
+    atomic_init(&t->latest, 1);
+    t->front = 2;
+    t->renderer.blockLayerStale = true;
+    t->renderer.collectBursts = true;
+    game->renderer.collectBursts = true;
+    game->renderer.burstCount = 0;
+    atomic_init(&t->burstHead, 0);
+    atomic_init(&t->burstTail, 0);
+    atomic_init(&t->running, true);
+
+    // The first snapshot is published here so the renderer always has one.
+    collectBlockChanges(t);
+    publish(t, MonotonicSeconds());
+
+    if (pthread_create(&t->thread, NULL, simulationMain, t) != 0) {
+        fprintf(stderr, "Could not start the simulation thread\n");
+        exit(1);
+    }
+}
+
+void StopBlockCrusherThread(BlockCrusherThread* t) {
+    atomic_store(&t->running, false);
+    pthread_join(t->thread, NULL);
+
+    for (int i = 0; i < SNAPSHOT_BUFFERS; i++) {
+        BlockCrusherSnapshot* s = &t->snapshots[i];
+        FreeBlockField(&s->state.field);
+        FreeBallStore(&s->state.balls);
+        FreeEntityPool(&s->state.powerups);
+        free(s->changed);
+    }
+    free(t->log);
+    UnloadBlockCrusherRenderer(&t->renderer);
+    t->game = NULL;
+}
+
+// Prints how many ticks the last run made and how late they started. Call
+// after StopBlockCrusherThread; the next start clears the counts.
+void PrintBlockCrusherThreadStats(const BlockCrusherThread* t) {
+    if (t->tickCount == 0) return;
+    printf("simulation thread: %ld ticks, tick lateness mean %.3f ms, max %.3f ms\n",
+           t->tickCount, t->totalLateness / t->tickCount * 1000.0, t->maxLateness * 1000.0);
+}
+
+// Called once per frame from the render thread. Held keys are sampled by
+// every tick; presses are kept until a tick consumes them.
+void SendBlockCrusherInput(BlockCrusherThread* t, BlockCrusherInput input) {
+    uint8_t bits = PackBlockCrusherInput(input);
+    atomic_store_explicit(&t->heldInput, bits & (INPUT_LEFT | INPUT_RIGHT), memory_order_relaxed);
+    atomic_fetch_or_explicit(&t->pendingInput, bits & (INPUT_PAUSE | INPUT_RESTART), memory_order_relaxed);
+}
+
+static void takeChanges(BlockCrusherThread* t, const BlockCrusherSnapshot* s) {
+    if (s->generation != t->drawnGeneration || s->changedFrom > t->drawnSerial) {
+        t->renderer.blockLayerStale = true;
+    } else {
+        for (uint64_t serial = t->drawnSerial; serial < s->serial; serial++) {
+            MarkBlockChanged(&t->renderer, s->changed[serial - s->changedFrom]);
+        }
+    }
+    t->drawnGeneration = s->generation;
+    t->drawnSerial = s->serial;
+
+    atomic_store_explicit(&t->ackSerial, s->serial, memory_order_relaxed);
+    atomic_store_explicit(&t->ackGeneration, s->generation, memory_order_release);
+}
+
+static void takeBursts(BlockCrusherThread* t) {
+    unsigned tail = atomic_load_explicit(&t->burstTail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&t->burstHead, memory_order_acquire);
+
+    for (; tail != head; tail++) {
+        QueueParticleBurst(&t->renderer, t->bursts[tail % BURST_RING_SIZE]);
+    }
+    atomic_store_explicit(&t->burstTail, tail, memory_order_release);
+}
+
+// Draws the newest published snapshot, interpolated by how far the clock
+// has moved past the tick it was taken on.
+void DrawBlockCrusherThread(BlockCrusherThread* t, float frameTime, int windowWidth, int windowHeight) {
+    takeBursts(t);
+    if (atomic_load_explicit(&t->latest, memory_order_acquire) & SNAPSHOT_FRESH) {
+        t->front = atomic_exchange_explicit(&t->latest, t->front, memory_order_acq_rel) & SNAPSHOT_INDEX;
+        takeChanges(t, &t->snapshots[t->front]);
+    }
+
+    const BlockCrusherSnapshot* s = &t->snapshots[t->front];
+    float alpha = 1.0f;
+    if (!s->state.gameOver && !s->state.paused) {
+        alpha = (float)((MonotonicSeconds() - s->tickTime) * s->state.tickRate);
+        if (alpha < 0.0f) alpha = 0.0f;
+        if (alpha > 1.0f) alpha = 1.0f;
+    }
+    DrawBlockCrusherState(&t->renderer, &s->state, alpha, frameTime, windowWidth, windowHeight);
+}
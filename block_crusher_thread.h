@@ -0,0 +1,81 @@
+#ifndef BLOCK_CRUSHER_THREAD_H
+#define BLOCK_CRUSHER_THREAD_H
+
+#include "block_crusher.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#define SNAPSHOT_BUFFERS 3
+#define BURST_RING_SIZE 1024
+
+// One published simulation state. Blocks changed since the renderer's last
+// acknowledged serial travel along so it can patch its block layer; a
+// renderer further behind than changedFrom redraws the layer instead.
+typedef struct {
+    BlockCrusherGame state;
+    double tickTime;
+    uint64_t generation;
+    uint64_t serial;
+    int* changed;
+    int changedCount;
+    int changedCapacity;
+    uint64_t changedFrom;
+} BlockCrusherSnapshot;
+
+// Runs a Block Crusher game on its own thread at its fixed tick rate and
+// hands snapshots to the render thread through a lock-free triple buffer:
+// the simulation fills `back`, swaps it with `latest` and never waits; the
+// renderer swaps `front` for `latest` whenever a newer one is there.
+//
+// Blocks change a few at a time, so each buffer's field is brought up to
+// date from a log of changed block indices instead of being copied whole.
+// `generation` counts field rebuilds (level starts) and `serial` counts
+// block changes within the whole run; a buffer or renderer that falls
+// outside the log just takes a full copy or redraw.
+typedef struct {
+    BlockCrusherGame* game;
+    pthread_t thread;
+    atomic_bool running;
+    atomic_uint heldInput;
+    atomic_uint pendingInput;
+
+    BlockCrusherSnapshot snapshots[SNAPSHOT_BUFFERS];
+    atomic_int latest;
+    int back;
+    int front;
+
+    // Particle bursts are events rather than state, so they skip the
+    // snapshots and go through a single-producer ring instead.
+    ParticleBurst bursts[BURST_RING_SIZE];
+    atomic_uint burstHead;
+    atomic_uint burstTail;
+
+    // Simulation thread only.
+    int* log;
+    int logCount;
+    int logCapacity;
+    uint64_t logStart;
+    uint64_t serial;
+    uint64_t generation;
+    long tickCount;
+    double totalLateness;
+    double maxLateness;
+
+    // Render thread only, apart from the acknowledgements.
+    BlockCrusherRenderer renderer;
+    uint64_t drawnGeneration;
+    uint64_t drawnSerial;
+    atomic_uint_fast64_t ackGeneration;
+    atomic_uint_fast64_t ackSerial;
+} BlockCrusherThread;
+
+// game must be initialised; it belongs to the simulation thread until
+// StopBlockCrusherThread returns.
+void StartBlockCrusherThread(BlockCrusherThread* thread, BlockCrusherGame* game);
+void StopBlockCrusherThread(BlockCrusherThread* thread);
+void PrintBlockCrusherThreadStats(const BlockCrusherThread* thread);
+void SendBlockCrusherInput(BlockCrusherThread* thread, BlockCrusherInput input);
+void DrawBlockCrusherThread(BlockCrusherThread* thread, float frameTime, int windowWidth, int windowHeight);
+
+#endif
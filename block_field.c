@@ -0,0 +1,362 @@
+#include "block_field.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_CELLS_PER_BLOCK 4
+
+static int clampi(int value, int low, int high) {
+    if (value < low) return low;
+    if (value > high) return high;
+    return value;
+}
+
+static void* growArray(void* data, int* capacity, int needed, size_t elementSize) {
+    if (needed <= *capacity) return data;
+    int newCapacity = (*capacity > 0) ? *capacity : 64;
+    while (newCapacity < needed) newCapacity *= 2;
+    *capacity = newCapacity;
+    return realloc(data, newCapacity * elementSize);
+}
+
+void InitBlockBoard(BlockField* field, int rows, int cols, Rectangle first, float spacingX, float spacingY) {
+    BlockBoard* board = &field->board;
+    board->rows = rows;
+    board->cols = cols;
+    board->originX = first.x;
+    board->originY = first.y;
+    board->blockWidth = first.width;
+    board->blockHeight = first.height;
+    board->pitchX = first.width + spacingX;
+    board->pitchY = first.height + spacingY;
+
+    int count = rows * cols;
+    int words = (count + 63) / 64;
+    board->bits = growArray(board->bits, &board->wordCapacity, words, sizeof(uint64_t));
+    memset(board->bits, 0xFF, words * sizeof(uint64_t));
+    if (count % 64 != 0) {
+        board->bits[words - 1] = (1ULL << (count % 64)) - 1;
+    }
+
+    field->useBoard = true;
+    field->hasAttributes = false;
+    field->count = count;
+    field->alive = count;
+}
+
+static void buildGrid(BlockGrid* grid, const Block* blocks, int count) {
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    float maxW = 1.0f, maxH = 1.0f;
+
+    for (int i = 0; i < count; i++) {
+        Rectangle r = blocks[i].rect;
+        if (r.x < minX) minX = r.x;
+        if (r.y < minY) minY = r.y;
+        if (r.x + r.width > maxX) maxX = r.x + r.width;
+        if (r.y + r.height > maxY) maxY = r.y + r.height;
+        if (r.width > maxW) maxW = r.width;
+        if (r.height > maxH) maxH = r.height;
+    }
+    if (count == 0) {
+        minX = minY = 0.0f;
+        maxX = maxY = 1.0f;
+    }
+
+    grid->originX = minX;
+    grid->originY = minY;
+    grid->cellWidth = maxW;
+    grid->cellHeight = maxH;
+    grid->cols = (int)((maxX - minX) / maxW) + 1;
+    grid->rows = (int)((maxY - minY) / maxH) + 1;
+
+    // Sparse layouts would otherwise get far more cells than blocks.
+    while ((long)grid->cols * grid->rows > (long)(count + 1) * MAX_CELLS_PER_BLOCK) {
+        grid->cellWidth *= 2.0f;
+        grid->cellHeight *= 2.0f;
+        grid->cols = (int)((maxX - minX) / grid->cellWidth) + 1;
+        grid->rows = (int)((maxY - minY) / grid->cellHeight) + 1;
+    }
+
+    int cells = grid->cols * grid->rows;
+    grid->cellStart = growArray(grid->cellStart, &grid->cellCapacity, cells + 1, sizeof(int));
+    grid->cellBlocks = growArray(grid->cellBlocks, &grid->blockCapacity, count > 0 ? count : 1, sizeof(int));
+    memset(grid->cellStart, 0, (cells + 1) * sizeof(int));
+
+    for (int i = 0; i < count; i++) {
+        int col = (int)((blocks[i].rect.x - minX) / grid->cellWidth);
+        int row = (int)((blocks[i].rect.y - minY) / grid->cellHeight);
+        grid->cellStart[row * grid->cols + col + 1]++;
+    }
+    for (int c = 0; c < cells; c++) {
+        grid->cellStart[c + 1] += grid->cellStart[c];
+    }
+
+    // cellStart[c] doubles as the write cursor, then gets shifted back.
+    for (int i = 0; i < count; i++) {
+        int col = (int)((blocks[i].rect.x - minX) / grid->cellWidth);
+        int row = (int)((blocks[i].rect.y - minY) / grid->cellHeight);
+        grid->cellBlocks[grid->cellStart[row * grid->cols + col]++] = i;
+    }
+    for (int c = cells; c > 0; c--) {
+        grid->cellStart[c] = grid->cellStart[c - 1];
+    }
+    grid->cellStart[0] = 0;
+}
+
+void InitBlockList(BlockField* field, const Block* blocks, int count) {
+    memcpy(BeginBlockList(field, count), blocks, count * sizeof(Block));
+    FinishBlockList(field);
+}
+
+// Sizes the block array for count blocks and returns it for the caller to
+// fill in place (e.g. straight from a level file); FinishBlockList() then
+// counts live blocks and builds the grid.
+Block* BeginBlockList(BlockField* field, int count) {
+    field->blocks = growArray(field->blocks, &field->blockCapacity, count > 0 ? count : 1, sizeof(Block));
+    field->useBoard = false;
+    field->hasAttributes = false;
+    field->count = count;
+    return field->blocks;
+}
+
+void FinishBlockList(BlockField* field) {
+    field->alive = 0;
+    for (int i = 0; i < field->count; i++) {
+        if (field->blocks[i].active) field->alive++;
+    }
+    buildGrid(&field->grid, field->blocks, field->count);
+}
+
+// Call after InitBlockBoard/BeginBlockList; the caller fills types[] and hp[].
+void ReserveBlockAttributes(BlockField* field) {
+    int needed = field->count > 0 ? field->count : 1;
+    if (needed > field->attributeCapacity) {
+        int capacity = field->attributeCapacity;
+        field->types = growArray(field->types, &capacity, needed, sizeof(uint8_t));
+        field->hp = realloc(field->hp, capacity * sizeof(uint8_t));
+        field->attributeCapacity = capacity;
+    }
+    field->hasAttributes = true;
+}
+
+void FreeBlockField(BlockField* field) {
+    free(field->blocks);
+    free(field->grid.cellStart);
+    free(field->grid.cellBlocks);
+    free(field->board.bits);
+    free(field->types);
+    free(field->hp);
+    memset(field, 0, sizeof(*field));
+}
+
+// Deep copy of src into dst, reusing dst's buffers.
+void CopyBlockField(BlockField* dst, const BlockField* src) {
+    dst->count = src->count;
+    dst->alive = src->alive;
+    dst->useBoard = src->useBoard;
+
+    if (src->useBoard) {
+        int words = (src->count + 63) / 64;
+        uint64_t* bits = growArray(dst->board.bits, &dst->board.wordCapacity, words > 0 ? words : 1, sizeof(uint64_t));
+        int wordCapacity = dst->board.wordCapacity;
+        dst->board = src->board;
+        dst->board.bits = bits;
+        dst->board.wordCapacity = wordCapacity;
+        memcpy(bits, src->board.bits, words * sizeof(uint64_t));
+    } else {
+        int needed = src->count > 0 ? src->count : 1;
+        dst->blocks = growArray(dst->blocks, &dst->blockCapacity, needed, sizeof(Block));
+        memcpy(dst->blocks, src->blocks, src->count * sizeof(Block));
+
+        BlockGrid grid = dst->grid;
+        int cells = src->grid.cols * src->grid.rows;
+        grid.cellStart = growArray(grid.cellStart, &grid.cellCapacity, cells + 1, sizeof(int));
+        grid.cellBlocks = growArray(grid.cellBlocks, &grid.blockCapacity, needed, sizeof(int));
+        memcpy(grid.cellStart, src->grid.cellStart, (cells + 1) * sizeof(int));
+        memcpy(grid.cellBlocks, src->grid.cellBlocks, src->count * sizeof(int));
+        dst->grid = src->grid;
+        dst->grid.cellStart = grid.cellStart;
+        dst->grid.cellBlocks = grid.cellBlocks;
+        dst->grid.cellCapacity = grid.cellCapacity;
+        dst->grid.blockCapacity = grid.blockCapacity;
+    }
+
+    dst->hasAttributes = false;
+    if (src->hasAttributes) {
+        ReserveBlockAttributes(dst);
+        memcpy(dst->types, src->types, src->count);
+        memcpy(dst->hp, src->hp, src->count);
+    }
+}
+
+static void setBlockActive(BlockField* field, int index, bool active) {
+    if (IsBlockActive(field, index) == active) return;
+
+    if (field->useBoard) {
+        field->board.bits[index >> 6] ^= 1ULL << (index & 63);
+    } else {
+        field->blocks[index].active = active;
+    }
+    field->alive += active ? 1 : -1;
+}
+
+// Brings one block of dst up to date with src; both must hold the same
+// layout, e.g. dst an earlier CopyBlockField of src.
+void CopyBlockState(BlockField* dst, const BlockField* src, int index) {
+    setBlockActive(dst, index, IsBlockActive(src, index));
+    if (src->hasAttributes) dst->hp[index] = src->hp[index];
+}
+
+// Active flags as (count + 63) / 64 words, one bit per block, so save states
+// store the same compact form for either layout.
+void GetBlockBits(const BlockField* field, uint64_t* bits) {
+    int words = (field->count + 63) / 64;
+    if (field->useBoard) {
+        memcpy(bits, field->board.bits, words * sizeof(uint64_t));
+        return;
+    }
+    memset(bits, 0, words * sizeof(uint64_t));
+    for (int i = 0; i < field->count; i++) {
+        if (field->blocks[i].active) bits[i >> 6] |= 1ULL << (i & 63);
+    }
+}
+
+// Bit count without relying on a popcount instruction being enabled, where
+// __builtin_popcountll becomes a library call per word.
+static int countBits(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+}
+
+// Inverse of GetBlockBits; bits past count are ignored and alive is
+// recounted.
+void SetBlockBits(BlockField* field, const uint64_t* bits) {
+    int words = (field->count + 63) / 64;
+    int alive = 0;
+    if (field->useBoard) {
+        memcpy(field->board.bits, bits, words * sizeof(uint64_t));
+        if (field->count % 64 != 0) field->board.bits[words - 1] &= (1ULL << (field->count % 64)) - 1;
+        for (int w = 0; w < words; w++) alive += countBits(field->board.bits[w]);
+    } else {
+        for (int i = 0; i < field->count; i++) {
+            bool active = (bits[i >> 6] >> (i & 63)) & 1;
+            field->blocks[i].active = active;
+            alive += active;
+        }
+    }
+    field->alive = alive;
+}
+
+void RemoveBlock(BlockField* field, int index) {
+    if (!IsBlockActive(field, index)) return;
+
+    if (field->useBoard) {
+        field->board.bits[index >> 6] &= ~(1ULL << (index & 63));
+    } else {
+        field->blocks[index].active = false;
+    }
+    field->alive--;
+}
+
+// Takes one hit point off a block and removes it when none are left.
+// Returns true if the block was destroyed.
+bool HitBlock(BlockField* field, int index) {
+    if (!IsBlockActive(field, index)) return false;
+    if (field->hasAttributes && field->hp[index] > 1) {
+        field->hp[index]--;
+        return false;
+    }
+    RemoveBlock(field, index);
+    return true;
+}
+
+static bool overlaps(Rectangle a, Rectangle b) {
+    return a.x <= b.x + b.width && a.x + a.width >= b.x &&
+           a.y <= b.y + b.height && a.y + a.height >= b.y;
+}
+
+static int queryBoard(const BlockBoard* board, Rectangle area, int* out, int maxOut) {
+    int col0 = (int)floorf((area.x - board->originX) / board->pitchX);
+    int col1 = (int)floorf((area.x + area.width - board->originX) / board->pitchX);
+    int row0 = (int)floorf((area.y - board->originY) / board->pitchY);
+    int row1 = (int)floorf((area.y + area.height - board->originY) / board->pitchY);
+
+    if (col1 < 0 || row1 < 0 || col0 >= board->cols || row0 >= board->rows) return 0;
+    col0 = clampi(col0, 0, board->cols - 1);
+    col1 = clampi(col1, 0, board->cols - 1);
+    row0 = clampi(row0, 0, board->rows - 1);
+    row1 = clampi(row1, 0, board->rows - 1);
+
+    int found = 0;
+    for (int row = row0; row <= row1; row++) {
+        int first = row * board->cols + col0;
+        int last = row * board->cols + col1;
+
+        for (int word = first >> 6; word <= (last >> 6); word++) {
+            uint64_t bits = board->bits[word];
+            if (word == (first >> 6)) bits &= ~0ULL << (first & 63);
+            if (word == (last >> 6) && (last & 63) != 63) bits &= (1ULL << ((last & 63) + 1)) - 1;
+
+            while (bits) {
+                int index = word * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+
+                int col = index - row * board->cols;
+                Rectangle rect = {board->originX + col * board->pitchX, board->originY + row * board->pitchY,
+                                  board->blockWidth, board->blockHeight};
+                if (!overlaps(rect, area)) continue;
+                if (found < maxOut) out[found] = index;
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+static int queryGrid(const BlockField* field, Rectangle area, int* out, int maxOut) {
+    const BlockGrid* grid = &field->grid;
+    int col0 = (int)floorf((area.x - grid->cellWidth - grid->originX) / grid->cellWidth);
+    int col1 = (int)floorf((area.x + area.width - grid->originX) / grid->cellWidth);
+    int row0 = (int)floorf((area.y - grid->cellHeight - grid->originY) / grid->cellHeight);
+    int row1 = (int)floorf((area.y + area.height - grid->originY) / grid->cellHeight);
+
+    if (col1 < 0 || row1 < 0 || col0 >= grid->cols || row0 >= grid->rows) return 0;
+    col0 = clampi(col0, 0, grid->cols - 1);
+    col1 = clampi(col1, 0, grid->cols - 1);
+    row0 = clampi(row0, 0, grid->rows - 1);
+    row1 = clampi(row1, 0, grid->rows - 1);
+
+    int found = 0;
+    for (int row = row0; row <= row1; row++) {
+        for (int col = col0; col <= col1; col++) {
+            int cell = row * grid->cols + col;
+            for (int k = grid->cellStart[cell]; k < grid->cellStart[cell + 1]; k++) {
+                int index = grid->cellBlocks[k];
+                if (!field->blocks[index].active || !overlaps(field->blocks[index].rect, area)) continue;
+                if (found < maxOut) out[found] = index;
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+// Returns how many live blocks overlap area, writing the first maxOut of
+// them to out.
+int QueryBlocks(const BlockField* field, Rectangle area, int* out, int maxOut) {
+    if (field->alive == 0) return 0;
+    if (field->useBoard) return queryBoard(&field->board, area, out, maxOut);
+    return queryGrid(field, area, out, maxOut);
+}
+
+// QueryBlocks into a caller-owned buffer that grows until every match fits.
+int QueryAllBlocks(const BlockField* field, Rectangle area, int** out, int* capacity) {
+    int found = QueryBlocks(field, area, *out, *capacity);
+    if (found > *capacity) {
+        *out = growArray(*out, capacity, found, sizeof(int));
+        found = QueryBlocks(field, area, *out, *capacity);
+    }
+    return found;
+}
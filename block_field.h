@@ -0,0 +1,96 @@
+#ifndef BLOCK_FIELD_H
+#define BLOCK_FIELD_H
+
+#include "raylib.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    Rectangle rect;
+    bool active;
+} Block;
+
+// Uniform grid over an arbitrary block list. Each block is stored once, in the
+// cell holding its top-left corner, so queries widen by one block size instead
+// of deduplicating.
+typedef struct {
+    int cols;
+    int rows;
+    float originX;
+    float originY;
+    float cellWidth;
+    float cellHeight;
+    int* cellStart;
+    int* cellBlocks;
+    int cellCapacity;
+    int blockCapacity;
+} BlockGrid;
+
+// Regular row/column layout: one bit per block, rects computed from the index.
+typedef struct {
+    int rows;
+    int cols;
+    float originX;
+    float originY;
+    float blockWidth;
+    float blockHeight;
+    float pitchX;
+    float pitchY;
+    uint64_t* bits;
+    int wordCapacity;
+} BlockBoard;
+
+// types/hp are optional per-block attributes indexed like the blocks; without
+// them every block is type 0 and breaks on the first hit.
+typedef struct {
+    Block* blocks;
+    int blockCapacity;
+    int count;
+    int alive;
+    bool useBoard;
+    BlockGrid grid;
+    BlockBoard board;
+    uint8_t* types;
+    uint8_t* hp;
+    int attributeCapacity;
+    bool hasAttributes;
+} BlockField;
+
+void InitBlockBoard(BlockField* field, int rows, int cols, Rectangle first, float spacingX, float spacingY);
+void InitBlockList(BlockField* field, const Block* blocks, int count);
+Block* BeginBlockList(BlockField* field, int count);
+void FinishBlockList(BlockField* field);
+void ReserveBlockAttributes(BlockField* field);
+void FreeBlockField(BlockField* field);
+void CopyBlockField(BlockField* dst, const BlockField* src);
+void CopyBlockState(BlockField* dst, const BlockField* src, int index);
+void GetBlockBits(const BlockField* field, uint64_t* bits);
+void SetBlockBits(BlockField* field, const uint64_t* bits);
+void RemoveBlock(BlockField* field, int index);
+bool HitBlock(BlockField* field, int index);
+int QueryBlocks(const BlockField* field, Rectangle area, int* out, int maxOut);
+int QueryAllBlocks(const BlockField* field, Rectangle area, int** out, int* capacity);
+
+static inline bool IsBlockActive(const BlockField* field, int index) {
+    if (field->useBoard) {
+        return (field->board.bits[index >> 6] >> (index & 63)) & 1;
+    }
+    return field->blocks[index].active;
+}
+
+static inline int GetBlockType(const BlockField* field, int index) {
+    return field->hasAttributes ? field->types[index] : 0;
+}
+
+static inline Rectangle GetBlockRect(const BlockField* field, int index) {
+    if (field->useBoard) {
+        const BlockBoard* board = &field->board;
+        int row = index / board->cols;
+        int col = index - row * board->cols;
+        return (Rectangle){board->originX + col * board->pitchX, board->originY + row * board->pitchY,
+                           board->blockWidth, board->blockHeight};
+    }
+    return field->blocks[index].rect;
+}
+
+#endif
@@ -2,19 +2,60 @@
 
 chmod +x "$0"
 
+SOURCES="game_manager.c block_crusher.c block_field.c ball_store.c entity_pool.c collision.c glow_batch.c input_recording.c work_pool.c level.c presentation.c profiler.c block_crusher_thread.c save_state.c state_buffer.c particles.c fast_forward.c quality.c game_module.c latency.c"
+LIBS="-lraylib -lm -lpthread -ldl"
+
+# --low-latency polls input late in the frame through GLFW, which raylib's
+# desktop platform links into libraylib. Other raylib builds don't export
+# it; latency.c then paces frames without the late polls.
+CFLAGS=""
+if echo 'void glfwPollEvents(void); int main(void) { glfwPollEvents(); return 0; }' |
+        gcc -x c -o /dev/null - $LIBS 2>/dev/null; then
+    CFLAGS="-DLATENCY_GLFW"
+fi
+
+# Snake and Tetris are game modules, loaded from modules/ when picked. They
+# don't link raylib themselves: a copy of their own would have no window, GL
+# context or input, and a static libraylib.a usually isn't built with -fPIC.
+# The game is linked with -rdynamic instead, so modules use its raylib.
+MODULE_SOURCES="presentation.c state_buffer.c"
+buildModules() {
+    mkdir -p modules
+    gcc -shared -fPIC -o modules/snake.so snake_module.c snake.c $MODULE_SOURCES -lm || return 1
+    gcc -shared -fPIC -o modules/tetris.so tetris_module.c tetris.c $MODULE_SOURCES -lm || return 1
+}
+
+if [ "$1" = "bench" ]; then
+    echo "Building retro_games_bench..."
+    gcc -O2 $CFLAGS -o retro_games_bench bench.c $SOURCES snake.c tetris.c $LIBS || exit 1
+    echo "Build successful! Run ./retro_games_bench --help for options."
+    exit 0
+fi
+
+# Rebuilds just the modules; a running game picks the new build up.
+if [ "$1" = "modules" ]; then
+    echo "Building game modules..."
+    buildModules || exit 1
+    echo "Build successful!"
+    exit 0
+fi
+
 echo "Building Retro Games Collection..."
 
-gcc -o retro_games main.c game_manager.c block_crusher.c -lraylib -lm -lpthread -ldl
+gcc $CFLAGS -rdynamic -o retro_games main.c $SOURCES $LIBS && buildModules
 
 if [ $? -eq 0 ]; then
     echo "Build successful! Starting game..."
     echo ""
     echo "CONTROLS:"
-    echo "  Main Menu: Press 1 for Block Crusher, 4 to Exit"
+    echo "  Main Menu: Press 1 for Block Crusher, 2 for Snake, 3 for Tetris, 4 to Exit"
     echo "  In Game: Arrow Keys = Move, P = Pause, R = Restart, M = Return to Menu"
+    echo "  Tetris: Up/X = Rotate, Z = Rotate Back, Down = Soft Drop, Space = Hard Drop"
+    echo "  Save States: F5 = Save, F9 = Load, F6 = Next Slot, Hold Backspace = Rewind"
+    echo "  Overlays: F3 = Frame Profiler, F7 = Quality Governor"
     echo ""
     ./retro_games
 else
     echo "Build failed! Check your code for errors."
     exit 1
-fi
\ No newline at end of file
+fi
@@ -0,0 +1,105 @@
+#include "collision.h"
+#include <math.h>
+
+static float clampf(float value, float low, float high) {
+    if (value < low) return low;
+    if (value > high) return high;
+    return value;
+}
+
+static bool startOverlap(Vector2 p, Vector2 d, float radius, Rectangle rect, SweepHit* hit) {
+    float dx = p.x - clampf(p.x, rect.x, rect.x + rect.width);
+    float dy = p.y - clampf(p.y, rect.y, rect.y + rect.height);
+    float distSq = dx * dx + dy * dy;
+    if (distSq >= radius * radius) return false;
+
+    Vector2 normal;
+    if (distSq > 0.0f) {
+        float dist = sqrtf(distSq);
+        normal = (Vector2){dx / dist, dy / dist};
+    } else {
+        float left = p.x - rect.x;
+        float right = rect.x + rect.width - p.x;
+        float top = p.y - rect.y;
+        float bottom = rect.y + rect.height - p.y;
+        float best = left;
+        normal = (Vector2){-1.0f, 0.0f};
+        if (right < best) { best = right; normal = (Vector2){1.0f, 0.0f}; }
+        if (top < best) { best = top; normal = (Vector2){0.0f, -1.0f}; }
+        if (bottom < best) { normal = (Vector2){0.0f, 1.0f}; }
+    }
+
+    if (d.x * normal.x + d.y * normal.y >= 0.0f) return false;
+    hit->time = 0.0f;
+    hit->normal = normal;
+    return true;
+}
+
+bool SweepCircleRect(Vector2 p, Vector2 d, float radius, Rectangle rect, SweepHit* hit) {
+    if (startOverlap(p, d, radius, rect, hit)) return true;
+
+    // Slab test against the rectangle grown by the radius.
+    float minB[2] = {rect.x - radius, rect.y - radius};
+    float maxB[2] = {rect.x + rect.width + radius, rect.y + rect.height + radius};
+    float origin[2] = {p.x, p.y};
+    float dir[2] = {d.x, d.y};
+    float tEnter = -INFINITY;
+    float tExit = INFINITY;
+    int enterAxis = 0;
+
+    for (int axis = 0; axis < 2; axis++) {
+        if (fabsf(dir[axis]) < 1e-12f) {
+            if (origin[axis] < minB[axis] || origin[axis] > maxB[axis]) return false;
+            continue;
+        }
+        float t1 = (minB[axis] - origin[axis]) / dir[axis];
+        float t2 = (maxB[axis] - origin[axis]) / dir[axis];
+        if (t1 > t2) { float tmp = t1; t1 = t2; t2 = tmp; }
+        if (t1 > tEnter) { tEnter = t1; enterAxis = axis; }
+        if (t2 < tExit) tExit = t2;
+    }
+    if (tEnter > tExit || tEnter > 1.0f || tExit <= 0.0f) return false;
+
+    // Starting inside the grown box but not overlapping the circle means we
+    // are in one of its corner cells.
+    bool startedInside = tEnter < 0.0f;
+    if (startedInside) tEnter = 0.0f;
+
+    Vector2 q = {p.x + d.x * tEnter, p.y + d.y * tEnter};
+    bool outsideX = q.x < rect.x || q.x > rect.x + rect.width;
+    bool outsideY = q.y < rect.y || q.y > rect.y + rect.height;
+
+    if (outsideX && outsideY) {
+        // Entered through a corner cell: the real shape there is a quarter circle.
+        Vector2 c = {q.x < rect.x ? rect.x : rect.x + rect.width,
+                     q.y < rect.y ? rect.y : rect.y + rect.height};
+        Vector2 m = {p.x - c.x, p.y - c.y};
+        float a = d.x * d.x + d.y * d.y;
+        float b = m.x * d.x + m.y * d.y;
+        float cc = m.x * m.x + m.y * m.y - radius * radius;
+        float disc = b * b - a * cc;
+        if (a <= 0.0f || disc < 0.0f) return false;
+
+        float t = (-b - sqrtf(disc)) / a;
+        if (t < 0.0f || t > 1.0f) return false;
+
+        Vector2 contact = {p.x + d.x * t - c.x, p.y + d.y * t - c.y};
+        float len = sqrtf(contact.x * contact.x + contact.y * contact.y);
+        if (len <= 0.0f) return false;
+
+        hit->time = t;
+        hit->normal = (Vector2){contact.x / len, contact.y / len};
+    } else {
+        if (startedInside) return false;
+        hit->time = tEnter;
+        hit->normal = (enterAxis == 0) ? (Vector2){dir[0] > 0 ? -1.0f : 1.0f, 0.0f}
+                                       : (Vector2){0.0f, dir[1] > 0 ? -1.0f : 1.0f};
+    }
+
+    return d.x * hit->normal.x + d.y * hit->normal.y < 0.0f;
+}
+
+Vector2 ReflectVector(Vector2 v, Vector2 normal) {
+    float dot = v.x * normal.x + v.y * normal.y;
+    return (Vector2){v.x - 2.0f * dot * normal.x, v.y - 2.0f * dot * normal.y};
+}
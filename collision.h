@@ -0,0 +1,19 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "raylib.h"
+#include <stdbool.h>
+
+typedef struct {
+    float time;
+    Vector2 normal;
+} SweepHit;
+
+// Swept circle vs axis-aligned rectangle. The circle starts at `start` and
+// moves by `delta`; on a hit, `time` is the fraction of `delta` travelled
+// before first contact and `normal` points out of the rectangle. Contacts
+// the circle is already moving away from are ignored.
+bool SweepCircleRect(Vector2 start, Vector2 delta, float radius, Rectangle rect, SweepHit* hit);
+Vector2 ReflectVector(Vector2 v, Vector2 normal);
+
+#endif
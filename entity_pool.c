@@ -0,0 +1,120 @@
+#include "entity_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_ENTITY_CAPACITY 16
+#define GENERATION_MASK ((1u << (32 - ENTITY_INDEX_BITS)) - 1)
+
+// freeSlot holds slot + 1 so that zero means an empty free list.
+#define NO_FREE_SLOT 0
+
+void InitEntityPool(EntityPool* pool, size_t itemSize) {
+    memset(pool, 0, sizeof(*pool));
+    pool->itemSize = itemSize;
+}
+
+// Slots are only appended when the free list is empty, i.e. when every slot
+// is live, so slotCount never exceeds capacity and one capacity covers both
+// the dense and the per-slot arrays.
+void ReserveEntities(EntityPool* pool, int capacity) {
+    if (capacity <= pool->capacity) return;
+    if (capacity > ENTITY_MAX_COUNT) abort();
+
+    int newCapacity = (pool->capacity > 0) ? pool->capacity : MIN_ENTITY_CAPACITY;
+    while (newCapacity < capacity) newCapacity *= 2;
+    if (newCapacity > ENTITY_MAX_COUNT) newCapacity = ENTITY_MAX_COUNT;
+
+    if (pool->itemSize > 0) pool->items = realloc(pool->items, newCapacity * pool->itemSize);
+    pool->slotOf = realloc(pool->slotOf, newCapacity * sizeof(uint32_t));
+    pool->indexOf = realloc(pool->indexOf, newCapacity * sizeof(uint32_t));
+    pool->generation = realloc(pool->generation, newCapacity * sizeof(uint16_t));
+    pool->capacity = newCapacity;
+}
+
+static void retireSlot(EntityPool* pool, uint32_t slot) {
+    uint16_t generation = (pool->generation[slot] + 1) & GENERATION_MASK;
+    pool->generation[slot] = generation ? generation : 1;
+    pool->indexOf[slot] = pool->freeSlot;
+    pool->freeSlot = slot + 1;
+}
+
+// The new entity is always at dense index count - 1; its item, if the pool
+// stores them, is left for the caller to fill in.
+EntityHandle SpawnEntity(EntityPool* pool) {
+    ReserveEntities(pool, pool->count + 1);
+
+    uint32_t slot;
+    if (pool->freeSlot != NO_FREE_SLOT) {
+        slot = pool->freeSlot - 1;
+        pool->freeSlot = pool->indexOf[slot];
+    } else {
+        slot = pool->slotCount++;
+        pool->generation[slot] = 1;
+    }
+
+    int index = pool->count++;
+    pool->slotOf[index] = slot;
+    pool->indexOf[slot] = index;
+    return EntityHandleAt(pool, index);
+}
+
+// Swap-removes the entity at index. Returns the dense index of the entity
+// that was moved into its place, which equals index when it was the last
+// one; owners of external storage copy that entry over index.
+int DespawnEntity(EntityPool* pool, int index) {
+    uint32_t slot = pool->slotOf[index];
+    int last = --pool->count;
+
+    if (index != last) {
+        uint32_t movedSlot = pool->slotOf[last];
+        pool->slotOf[index] = movedSlot;
+        pool->indexOf[movedSlot] = index;
+        if (pool->itemSize > 0) memcpy(EntityAt(pool, index), EntityAt(pool, last), pool->itemSize);
+    }
+    retireSlot(pool, slot);
+    return last;
+}
+
+// Dense index of a live entity, or -1 if the handle is stale or ENTITY_NONE.
+int FindEntity(const EntityPool* pool, EntityHandle handle) {
+    uint32_t slot = handle & (ENTITY_MAX_COUNT - 1);
+    uint32_t generation = handle >> ENTITY_INDEX_BITS;
+    if (generation == 0 || slot >= (uint32_t)pool->slotCount) return -1;
+    if (pool->generation[slot] != generation) return -1;
+    return (int)pool->indexOf[slot];
+}
+
+// Retires every live slot, invalidating all outstanding handles; costs
+// O(count), not O(capacity).
+void ClearEntities(EntityPool* pool) {
+    for (int i = pool->count - 1; i >= 0; i--) {
+        retireSlot(pool, pool->slotOf[i]);
+    }
+    pool->count = 0;
+}
+
+// Copies entities, handles and free list, so handles taken from src resolve
+// the same way in dst.
+void CopyEntityPool(EntityPool* dst, const EntityPool* src) {
+    if (dst->itemSize != src->itemSize) {
+        FreeEntityPool(dst);
+        InitEntityPool(dst, src->itemSize);
+    }
+    ReserveEntities(dst, src->slotCount);
+
+    if (src->itemSize > 0) memcpy(dst->items, src->items, src->count * src->itemSize);
+    memcpy(dst->slotOf, src->slotOf, src->count * sizeof(uint32_t));
+    memcpy(dst->indexOf, src->indexOf, src->slotCount * sizeof(uint32_t));
+    memcpy(dst->generation, src->generation, src->slotCount * sizeof(uint16_t));
+    dst->freeSlot = src->freeSlot;
+    dst->slotCount = src->slotCount;
+    dst->count = src->count;
+}
+
+void FreeEntityPool(EntityPool* pool) {
+    free(pool->items);
+    free(pool->slotOf);
+    free(pool->indexOf);
+    free(pool->generation);
+    InitEntityPool(pool, pool->itemSize);
+}
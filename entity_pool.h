@@ -0,0 +1,55 @@
+#ifndef ENTITY_POOL_H
+#define ENTITY_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ENTITY_INDEX_BITS 22
+#define ENTITY_MAX_COUNT (1 << ENTITY_INDEX_BITS)
+#define ENTITY_NONE 0
+
+// Low ENTITY_INDEX_BITS are the slot, the rest its generation. Generations
+// start at 1, so ENTITY_NONE never names a live entity.
+typedef uint32_t EntityHandle;
+
+// Slot map: live entities are dense in [0, count) so updates only ever walk
+// live ones, while handles go through a per-slot indirection that survives
+// the swap-removes. Freed slots are chained through indexOf and reused
+// newest-first; bumping a slot's generation on despawn makes stale handles
+// miss instead of aliasing whatever moved in.
+//
+// With itemSize > 0 the pool stores the entities itself in items. With
+// itemSize 0 it only tracks handles and the owner keeps its own (e.g.
+// structure-of-arrays) storage in the same dense order, mirroring the moves
+// DespawnEntity reports. A zeroed pool is an empty one with itemSize 0.
+typedef struct {
+    void* items;
+    size_t itemSize;
+    uint32_t* slotOf;
+    uint32_t* indexOf;
+    uint16_t* generation;
+    uint32_t freeSlot;
+    int slotCount;
+    int count;
+    int capacity;
+} EntityPool;
+
+void InitEntityPool(EntityPool* pool, size_t itemSize);
+void ReserveEntities(EntityPool* pool, int capacity);
+EntityHandle SpawnEntity(EntityPool* pool);
+int DespawnEntity(EntityPool* pool, int index);
+int FindEntity(const EntityPool* pool, EntityHandle handle);
+void ClearEntities(EntityPool* pool);
+void CopyEntityPool(EntityPool* dst, const EntityPool* src);
+void FreeEntityPool(EntityPool* pool);
+
+static inline void* EntityAt(const EntityPool* pool, int index) {
+    return (char*)pool->items + (size_t)index * pool->itemSize;
+}
+
+static inline EntityHandle EntityHandleAt(const EntityPool* pool, int index) {
+    uint32_t slot = pool->slotOf[index];
+    return ((uint32_t)pool->generation[slot] << ENTITY_INDEX_BITS) | slot;
+}
+
+#endif
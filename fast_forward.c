@@ -0,0 +1,406 @@
+#include "fast_forward.h"
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_EVENT UINT64_MAX
+
+// How far ahead events are looked for. An entity with nothing before then
+// gets a recheck at the horizon instead, which is just an early event.
+#define SCHEDULE_HORIZON (1ull << 20)
+
+// Runs of up to this many ticks are cheaper to add up one by one.
+#define SHORT_RUN 16
+
+// Kernels move a coordinate by x = x + s once per tick, in float. While x and
+// the exact sum stay inside one binade, every such step rounds s to the same
+// multiple of that binade's ulp, so the next run of ticks adds a constant
+// and can be taken in one go. Returns how many ticks the run covers (with the
+// per-tick change in *step), LLONG_MAX if x never changes again, or 0 if the
+// next tick leaves the binade or lands exactly halfway between two floats and
+// has to be stepped on its own.
+static long long exactRun(float x, float s, double* step) {
+    double ax = fabs((double)x);
+    double as = x < 0.0f ? -(double)s : (double)s;
+    if (ax < FLT_MIN || isinf(ax)) return 0;
+
+    int exponent;
+    frexp(ax, &exponent);
+    double lo = ldexp(1.0, exponent - 1);
+    double hi = lo * 2.0;
+    double ulp = ldexp(1.0, exponent - FLT_MANT_DIG);
+
+    double units = as / ulp;
+    double whole = floor(units);
+    if (units - whole == 0.5) return 0;
+    double d = nearbyint(units) * ulp;
+
+    // x + s lies in [lo, hi) exactly when x + floor(s / ulp) * ulp does,
+    // since x sits on the ulp grid.
+    double first = ax + whole * ulp;
+    if (first < lo || first >= hi) return 0;
+
+    *step = x < 0.0f ? -d : d;
+    if (d == 0.0) return LLONG_MAX;
+
+    long long per = (long long)(fabs(d) / ulp);
+    long long left = (long long)((d > 0.0 ? hi - first : first - lo) / ulp);
+    return d > 0.0 ? (left + per - 1) / per : left / per + 1;
+}
+
+static float advanceCoordinate(float x, float s, uint64_t ticks) {
+    if (ticks <= SHORT_RUN) {
+        for (uint64_t i = 0; i < ticks; i++) x += s;
+        return x;
+    }
+    while (ticks > 0) {
+        double step;
+        long long run = exactRun(x, s, &step);
+        if (run == 0) {
+            x += s;
+            ticks--;
+            continue;
+        }
+        if ((uint64_t)run > ticks) run = (long long)ticks;
+        x = (float)(x + (double)run * step);
+        ticks -= run;
+    }
+    return x;
+}
+
+static bool crossed(double x, int direction, double bound, bool strict) {
+    if (direction > 0) return strict ? x > bound : x >= bound;
+    return strict ? x < bound : x <= bound;
+}
+
+// First tick k in [1, limit] after which the coordinate is at or past bound
+// in direction (strictly past with strict), or limit + 1. The coordinate
+// must not be moving against direction.
+static uint64_t firstCrossing(float x, float s, int direction, double bound, bool strict, uint64_t limit) {
+    if (limit <= SHORT_RUN) {
+        for (uint64_t k = 1; k <= limit; k++) {
+            x += s;
+            if (crossed(x, direction, bound, strict)) return k;
+        }
+        return limit + 1;
+    }
+    uint64_t k = 0;
+    while (k < limit) {
+        double step;
+        long long run = exactRun(x, s, &step);
+        if (run == 0) {
+            x += s;
+            k++;
+            if (crossed(x, direction, bound, strict)) return k;
+            continue;
+        }
+        if (step == 0.0) return crossed(x, direction, bound, strict) ? k + 1 : limit + 1;
+
+        uint64_t n = (uint64_t)run < limit - k ? (uint64_t)run : limit - k;
+        if (!crossed(x + (double)n * step, direction, bound, strict)) {
+            x = (float)(x + (double)n * step);
+            k += n;
+            continue;
+        }
+
+        double guess = ceil((bound - x) / step);
+        uint64_t i = guess < 1.0 ? 1 : guess > (double)n ? n : (uint64_t)guess;
+        while (i > 1 && crossed(x + (double)(i - 1) * step, direction, bound, strict)) i--;
+        while (!crossed(x + (double)i * step, direction, bound, strict)) i++;
+        return k + i;
+    }
+    return limit + 1;
+}
+
+// Ticks [in, out) are the ones after which the coordinate is inside [lo, hi].
+static void coordinateWindow(float x, float s, double lo, double hi, uint64_t limit, uint64_t* in, uint64_t* out) {
+    if (s >= 0.0f) {
+        *in = firstCrossing(x, s, 1, lo, false, limit);
+        *out = firstCrossing(x, s, 1, hi, true, limit);
+    } else {
+        *in = firstCrossing(x, s, -1, hi, false, limit);
+        *out = firstCrossing(x, s, -1, lo, true, limit);
+    }
+}
+
+static uint64_t minTick(uint64_t a, uint64_t b) {
+    return a < b ? a : b;
+}
+
+// A ball's tick can only differ from the integration kernel's straight move
+// if it bounces, falls out, or its swept box could touch the paddle or a
+// block. The paddle counts as its whole row band, since it moves with the
+// input, and blocks as the bounds of the layout; both are widened by a
+// tick's travel plus a pixel, so an event may come early but never late.
+static uint64_t ballEvent(const FastForward* engine, const BlockCrusherGame* game, int index, uint64_t limit) {
+    const BallStore* balls = &game->balls;
+    if (!balls->active[index]) return 1;
+
+    float dt = game->tickScale;
+    float r = balls->radius[index];
+    float x = balls->x[index];
+    float y = balls->y[index];
+    float sx = balls->vx[index] * dt;
+    float sy = balls->vy[index] * dt;
+    float right = BLOCK_CRUSHER_WIDTH - r;
+    float bottom = BLOCK_CRUSHER_HEIGHT + r;
+
+    float x1 = x + sx;
+    float y1 = y + sy;
+    if (x1 >= right || x1 <= r || y1 <= r || y1 >= bottom) return 1;
+
+    double marginX = r + fabsf(sx) + 1.0;
+    double marginY = r + fabsf(sy) + 1.0;
+    const Rectangle* paddle = &game->paddle.rect;
+    const Rectangle* bounds = &engine->blockBounds;
+    double paddleTop = paddle->y - marginY;
+    double paddleBottom = paddle->y + paddle->height + marginY;
+    double blocksLeft = bounds->x - marginX;
+    double blocksRight = bounds->x + bounds->width + marginX;
+    double blocksTop = bounds->y - marginY;
+    double blocksBottom = bounds->y + bounds->height + marginY;
+
+    if (y1 >= paddleTop && y1 <= paddleBottom) return 1;
+    if (engine->hasBlockBounds && x1 >= blocksLeft && x1 <= blocksRight && y1 >= blocksTop && y1 <= blocksBottom) {
+        return 1;
+    }
+
+    // Past the first tick only the side it moves towards can be reached.
+    uint64_t event = sx >= 0.0f ? firstCrossing(x, sx, 1, right, false, limit)
+                                : firstCrossing(x, sx, -1, r, false, limit);
+    event = minTick(event, sy < 0.0f ? firstCrossing(y, sy, -1, r, false, limit)
+                                     : firstCrossing(y, sy, 1, bottom, false, limit));
+
+    uint64_t in, out;
+    coordinateWindow(y, sy, paddleTop, paddleBottom, limit, &in, &out);
+    if (in < out) event = minTick(event, in);
+
+    if (engine->hasBlockBounds) {
+        uint64_t inY, outY;
+        coordinateWindow(x, sx, blocksLeft, blocksRight, limit, &in, &out);
+        coordinateWindow(y, sy, blocksTop, blocksBottom, limit, &inY, &outY);
+        if (inY > in) in = inY;
+        if (in < out && in < outY) event = minTick(event, in);
+    }
+    return event;
+}
+
+// Powerups only fall; they matter again once they could touch the paddle.
+static uint64_t powerupEvent(const BlockCrusherGame* game, int index, uint64_t limit) {
+    const PowerUp* powerup = EntityAt(&game->powerups, index);
+    float sy = powerup->speed.y * game->tickScale;
+    double top = game->paddle.rect.y - powerup->radius - 1.0;
+
+    if (powerup->position.y + sy >= top) return 1;
+    if (sy <= 0.0f) return limit + 1;
+    return firstCrossing(powerup->position.y, sy, 1, top, false, limit);
+}
+
+static uint64_t entityEvent(const FastForward* engine, const BlockCrusherGame* game, int entity, uint64_t limit) {
+    if (entity >= 0) return ballEvent(engine, game, entity, limit);
+    return powerupEvent(game, -1 - entity, limit);
+}
+
+static void pushEvent(FastForward* engine, ScheduledEvent event) {
+    if (engine->eventCount == engine->eventCapacity) {
+        engine->eventCapacity = engine->eventCapacity > 0 ? engine->eventCapacity * 2 : 64;
+        engine->events = realloc(engine->events, engine->eventCapacity * sizeof(ScheduledEvent));
+    }
+
+    ScheduledEvent* events = engine->events;
+    int i = engine->eventCount++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (events[parent].tick <= event.tick) break;
+        events[i] = events[parent];
+        i = parent;
+    }
+    events[i] = event;
+}
+
+static ScheduledEvent popEvent(FastForward* engine) {
+    ScheduledEvent* events = engine->events;
+    ScheduledEvent top = events[0];
+    ScheduledEvent last = events[--engine->eventCount];
+    int count = engine->eventCount;
+
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= count) break;
+        if (child + 1 < count && events[child + 1].tick < events[child].tick) child++;
+        if (last.tick <= events[child].tick) break;
+        events[i] = events[child];
+        i = child;
+    }
+    if (count > 0) events[i] = last;
+    return top;
+}
+
+// Blocks only ever disappear within a level, so bounds taken over the live
+// ones stay a superset until the level changes or blocks come back (a
+// restart). They are retaken on those, and whenever a quarter of the blocks
+// they cover are gone, to keep the rescans amortised.
+static void updateBlockBounds(FastForward* engine, const BlockCrusherGame* game) {
+    const BlockField* field = &game->field;
+    Rectangle first = field->count > 0 ? GetBlockRect(field, 0) : (Rectangle){0};
+    Rectangle last = field->count > 0 ? GetBlockRect(field, field->count - 1) : (Rectangle){0};
+    if (engine->boundsCount == field->count && engine->boundsLevels == game->levels &&
+        engine->boundsLevel == game->levelIndex && memcmp(&engine->boundsFirst, &first, sizeof(first)) == 0 &&
+        memcmp(&engine->boundsLast, &last, sizeof(last)) == 0 && field->alive <= engine->boundsAlive &&
+        field->alive >= engine->boundsAlive - engine->boundsAlive / 4) {
+        return;
+    }
+    engine->boundsLevels = game->levels;
+    engine->boundsLevel = game->levelIndex;
+    engine->boundsCount = field->count;
+    engine->boundsAlive = field->alive;
+    engine->boundsFirst = first;
+    engine->boundsLast = last;
+    engine->hasBlockBounds = false;
+
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    for (int i = 0; i < field->count; i++) {
+        if (!IsBlockActive(field, i)) continue;
+        Rectangle rect = GetBlockRect(field, i);
+        minX = fminf(minX, rect.x);
+        minY = fminf(minY, rect.y);
+        maxX = fmaxf(maxX, rect.x + rect.width);
+        maxY = fmaxf(maxY, rect.y + rect.height);
+        engine->hasBlockBounds = true;
+    }
+    engine->blockBounds = (Rectangle){minX, minY, maxX - minX, maxY - minY};
+}
+
+static void scheduleAll(FastForward* engine, const BlockCrusherGame* game) {
+    updateBlockBounds(engine, game);
+    engine->eventCount = 0;
+
+    for (int i = 0; i < game->balls.count; i++) {
+        pushEvent(engine, (ScheduledEvent){game->tick + ballEvent(engine, game, i, SCHEDULE_HORIZON), i});
+    }
+    for (int i = 0; i < game->powerups.count; i++) {
+        pushEvent(engine, (ScheduledEvent){game->tick + powerupEvent(game, i, SCHEDULE_HORIZON), -1 - i});
+    }
+    engine->scheduled = true;
+}
+
+static float paddleAfter(const BlockCrusherGame* game, BlockCrusherInput input, uint64_t ticks) {
+    float x = game->paddle.rect.x;
+    float step = game->paddle.speed.x * game->tickScale;
+
+    // The paddle moves until the tick that takes it to (or past) the edge.
+    if (input.left) {
+        if (x <= 0.0f) return x;
+        return advanceCoordinate(x, -step, minTick(ticks, firstCrossing(x, -step, -1, 0.0, false, ticks)));
+    }
+    if (input.right) {
+        float edge = BLOCK_CRUSHER_WIDTH - game->paddle.rect.width;
+        if (x >= edge) return x;
+        return advanceCoordinate(x, step, minTick(ticks, firstCrossing(x, step, 1, edge, false, ticks)));
+    }
+    return x;
+}
+
+// Moves everything over ticks quiet ticks, leaving prev* where the last of
+// them would have.
+static void jumpTicks(FastForward* engine, BlockCrusherGame* game, BlockCrusherInput input, uint64_t ticks) {
+    float dt = game->tickScale;
+    BallStore* balls = &game->balls;
+
+    for (int i = 0; i < balls->count; i++) {
+        float sx = balls->vx[i] * dt;
+        float sy = balls->vy[i] * dt;
+        balls->prevX[i] = advanceCoordinate(balls->x[i], sx, ticks - 1);
+        balls->prevY[i] = advanceCoordinate(balls->y[i], sy, ticks - 1);
+        balls->x[i] = balls->prevX[i] + sx;
+        balls->y[i] = balls->prevY[i] + sy;
+        balls->trails[i].count = 0;
+    }
+
+    for (int i = 0; i < game->powerups.count; i++) {
+        PowerUp* powerup = EntityAt(&game->powerups, i);
+        float sy = powerup->speed.y * dt;
+        powerup->prevPosition.x = powerup->position.x;
+        powerup->prevPosition.y = advanceCoordinate(powerup->position.y, sy, ticks - 1);
+        powerup->position.y = powerup->prevPosition.y + sy;
+    }
+
+    float prevX = paddleAfter(game, input, ticks - 1);
+    game->paddle.rect.x = paddleAfter(game, input, ticks);
+    game->paddle.prevX = prevX;
+
+    // Trails only feed the renderer, so their clock needn't be bit exact.
+    double clock = game->trailClock + (double)ticks * dt;
+    double wraps = floor(clock);
+    game->trailClock = (float)(clock - wraps);
+    game->trailTick += (uint32_t)wraps;
+
+    game->tick += ticks;
+    engine->skippedTicks += ticks;
+}
+
+void AdvanceBlockCrusher(FastForward* engine, BlockCrusherGame* game, BlockCrusherInput input, uint64_t targetTick) {
+    bool tickByTick = input.pause || input.restart || (input.left && input.right) || game->recording;
+    if (engine->scheduledGame != game || engine->scheduledTick != game->tick) engine->scheduled = false;
+
+    while (game->tick < targetTick) {
+        if (tickByTick) {
+            StepBlockCrusher(game, input);
+            engine->steppedTicks++;
+            engine->scheduled = false;
+            continue;
+        }
+        if (game->gameOver || game->paused) {
+            game->tick = targetTick;
+            engine->scheduled = false;
+            break;
+        }
+
+        if (!engine->scheduled) scheduleAll(engine, game);
+        uint64_t next = engine->eventCount > 0 ? engine->events[0].tick : NO_EVENT;
+        if (next > game->tick + 1) {
+            uint64_t stop = next - 1 < targetTick ? next - 1 : targetTick;
+            jumpTicks(engine, game, input, stop - game->tick);
+            continue;
+        }
+
+        int ballCount = game->balls.count;
+        int powerupCount = game->powerups.count;
+        int score = game->score;
+        int lives = game->lives;
+        int levelIndex = game->levelIndex;
+
+        StepBlockCrusher(game, input);
+        engine->steppedTicks++;
+
+        // Anything beyond the due entities' own bounces renumbers or
+        // redirects the others, so everything gets rescheduled.
+        if (game->balls.count != ballCount || game->powerups.count != powerupCount || game->score != score ||
+            game->lives != lives || game->levelIndex != levelIndex || game->gameOver) {
+            engine->scheduled = false;
+            continue;
+        }
+
+        while (engine->eventCount > 0 && engine->events[0].tick <= game->tick) {
+            ScheduledEvent event = popEvent(engine);
+            event.tick = game->tick + entityEvent(engine, game, event.entity, SCHEDULE_HORIZON);
+            pushEvent(engine, event);
+        }
+    }
+
+    engine->scheduledGame = game;
+    engine->scheduledTick = game->tick;
+}
+
+void FreeFastForward(FastForward* engine) {
+    free(engine->events);
+    engine->events = NULL;
+    engine->eventCount = 0;
+    engine->eventCapacity = 0;
+    engine->scheduled = false;
+    engine->hasBlockBounds = false;
+    engine->boundsCount = -1;
+}
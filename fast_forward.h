@@ -0,0 +1,59 @@
+#ifndef FAST_FORWARD_H
+#define FAST_FORWARD_H
+
+#include "block_crusher.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// The tick a ball or powerup next needs a real StepBlockCrusher for. entity
+// is a ball index, or -1 - i for powerup i.
+typedef struct {
+    uint64_t tick;
+    int entity;
+} ScheduledEvent;
+
+// Event-driven stepping for bots, replays and sweeps. Between events every
+// ball and powerup moves in a straight line, so the engine predicts, per
+// entity, the first tick that could do anything but move it (a wall or the
+// ceiling, falling out, reaching the paddle's rows or the block area) and
+// keeps those ticks in a min-heap. Ticks before the earliest one are jumped
+// over in closed form; the event tick itself runs through StepBlockCrusher,
+// after which only the entities it touched are rescheduled.
+//
+// Jumps reproduce tick stepping bit for bit: positions are advanced the way
+// the kernels round them (see advanceCoordinate), so the state hash matches.
+// Only trails restart after a jump, as they do after loading a save state.
+typedef struct {
+    ScheduledEvent* events;
+    int eventCount;
+    int eventCapacity;
+
+    // The schedule carries over to the next call if the game is still at
+    // the tick the last one stopped on.
+    const BlockCrusherGame* scheduledGame;
+    uint64_t scheduledTick;
+    bool scheduled;
+
+    // Bounds of the live blocks, and what they were taken from.
+    Rectangle blockBounds;
+    bool hasBlockBounds;
+    const struct LevelSet* boundsLevels;
+    int boundsLevel;
+    int boundsCount;
+    int boundsAlive;
+    Rectangle boundsFirst;
+    Rectangle boundsLast;
+
+    uint64_t steppedTicks;
+    uint64_t skippedTicks;
+} FastForward;
+
+// Steps game until game->tick reaches targetTick with input held on every
+// tick. Held pause/restart, a game that is recording or both directions at
+// once fall back to plain tick stepping. After changing the game any other
+// way than stepping it (loading a save state, say), call FreeFastForward
+// first; the engine stays usable.
+void AdvanceBlockCrusher(FastForward* engine, BlockCrusherGame* game, BlockCrusherInput input, uint64_t targetTick);
+void FreeFastForward(FastForward* engine);
+
+#endif
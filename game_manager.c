@@ -1,8 +1,474 @@
 #include "game_manager.h"
 #include "block_crusher.h"
+#include "fast_forward.h"
+#include "work_pool.h"
+#include "profiler.h"
+#include "game_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
 #define BASE_WIDTH 800
 #define BASE_HEIGHT 600
+#define DEFAULT_HEADLESS_FRAMES 1000000
+#define DEFAULT_BATCH_FRAMES 10000
+#define MODULE_DIRECTORY "modules"
+#define DEFAULT_TICK_RATE 120
+#define DEFAULT_TARGET_FPS 60
+#define BALL_STORM_MAX_BALLS 100000
+#define DEFAULT_PROFILE_PATH "profile.csv"
+#define REWIND_SECONDS 10
+#define REWIND_BUDGET (16u << 20)
+
+void ParseGameManagerArgs(GameManager* manager, int argc, char** argv) {
+    manager->tickRate = DEFAULT_TICK_RATE;
+    manager->targetFPS = DEFAULT_TARGET_FPS;
+    manager->pinnedQuality = -1;
+    manager->lowLatency = false;
+    manager->reportLatency = false;
+    manager->blockRows = 0;
+    manager->blockCols = 0;
+    manager->startBalls = 0;
+    manager->maxBalls = 0;
+    manager->snakeWidth = 0;
+    manager->snakeHeight = 0;
+    manager->snakeLength = 0;
+    manager->headless = false;
+    manager->headlessGame = GAME_BLOCK_CRUSHER;
+    manager->headlessFrames = 0;
+    manager->idle = false;
+    manager->fastForward = false;
+    manager->batchGames = 0;
+    manager->threads = 0;
+    manager->threaded = false;
+    manager->seed = 0;
+    manager->fixedSeed = false;
+    manager->recordPath = NULL;
+    manager->replayPath = NULL;
+    manager->isRecording = false;
+    memset(&manager->blockCrusher, 0, sizeof(manager->blockCrusher));
+    memset(manager->modules, 0, sizeof(manager->modules));
+    manager->modulePath = NULL;
+    memset(&manager->recording, 0, sizeof(manager->recording));
+    memset(&manager->rewind, 0, sizeof(manager->rewind));
+    memset(manager->saveSlots, 0, sizeof(manager->saveSlots));
+    manager->saveSlot = 0;
+    memset(&manager->levels, 0, sizeof(manager->levels));
+    manager->exportLevelPath = NULL;
+    manager->profilePath = NULL;
+    manager->frameTime = 0.0f;
+    manager->waitingForEvents = false;
+    manager->waitHistory = 0;
+    manager->menuCache = (RenderTexture2D){0};
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            manager->headless = true;
+        }
+        else if (strcmp(argv[i], "--game") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "block-crusher") == 0) manager->headlessGame = GAME_BLOCK_CRUSHER;
+            else if (strcmp(argv[i], "snake") == 0) manager->headlessGame = GAME_SNAKE;
+            else if (strcmp(argv[i], "tetris") == 0) manager->headlessGame = GAME_TETRIS;
+            else {
+                fprintf(stderr, "Unknown game: %s (block-crusher, snake or tetris)\n", argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            manager->headlessFrames = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--idle") == 0) {
+            manager->idle = true;
+        }
+        else if (strcmp(argv[i], "--fast-forward") == 0) {
+            manager->fastForward = true;
+        }
+        else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            manager->batchGames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            manager->threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threaded") == 0) {
+            manager->threaded = true;
+        }
+        else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+            manager->tickRate = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            manager->targetFPS = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc) {
+            manager->pinnedQuality = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--low-latency") == 0) {
+            manager->lowLatency = true;
+        }
+        else if (strcmp(argv[i], "--input-latency") == 0) {
+            manager->reportLatency = true;
+        }
+        else if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc) {
+            manager->blockRows = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cols") == 0 && i + 1 < argc) {
+            manager->blockCols = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--balls") == 0 && i + 1 < argc) {
+            manager->startBalls = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-balls") == 0 && i + 1 < argc) {
+            manager->maxBalls = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--ball-storm") == 0) {
+            manager->maxBalls = BALL_STORM_MAX_BALLS;
+        }
+        else if (strcmp(argv[i], "--snake-board") == 0 && i + 1 < argc) {
+            i++;
+            if (sscanf(argv[i], "%dx%d", &manager->snakeWidth, &manager->snakeHeight) != 2) {
+                manager->snakeHeight = manager->snakeWidth;
+            }
+        }
+        else if (strcmp(argv[i], "--snake-length") == 0 && i + 1 < argc) {
+            manager->snakeLength = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            FreeLevelSet(&manager->levels);
+            manager->levels.paths = malloc(sizeof(char*));
+            manager->levels.paths[0] = strdup(argv[++i]);
+            manager->levels.count = 1;
+        }
+        else if (strcmp(argv[i], "--levels") == 0 && i + 1 < argc) {
+            FreeLevelSet(&manager->levels);
+            if (!ListLevels(&manager->levels, argv[++i]) || manager->levels.count == 0) {
+                fprintf(stderr, "No %s files in %s\n", LEVEL_EXTENSION, argv[i]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "--export-level") == 0 && i + 1 < argc) {
+            manager->exportLevelPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            manager->seed = strtoull(argv[++i], NULL, 0);
+            manager->fixedSeed = true;
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            manager->recordPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            manager->replayPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) {
+            manager->profilePath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--modules") == 0 && i + 1 < argc) {
+            manager->modulePath = argv[++i];
+        }
+        else {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            fprintf(stderr, "Usage: %s [--headless] [--game block-crusher|snake|tetris]\n"
+                            "       [--frames N] [--idle] [--fast-forward] [--batch GAMES] [--threads N]\n"
+                            "       [--threaded] [--tick-rate HZ] [--fps N] [--quality LEVEL]\n"
+                            "       [--low-latency] [--input-latency]\n"
+                            "       [--rows N] [--cols N] [--balls N] [--max-balls N] [--ball-storm]\n"
+                            "       [--snake-board N|WxH] [--snake-length N]\n"
+                            "       [--level FILE] [--levels DIR] [--export-level FILE]\n"
+                            "       [--seed N] [--record FILE] [--replay FILE]\n"
+                            "       [--profile-csv FILE] [--modules DIR]\n", argv[0]);
+            exit(1);
+        }
+    }
+}
+
+static uint64_t SessionSeed(const GameManager* manager) {
+    if (manager->fixedSeed) return manager->seed;
+    return (uint64_t)time(NULL) ^ (uint64_t)(MonotonicSeconds() * 1e9);
+}
+
+// Seeds and starts a Block Crusher session and, with --record, starts
+// capturing its per-tick input.
+static void StartBlockCrusher(GameManager* manager) {
+    uint64_t seed = SessionSeed(manager);
+    
+    SetBlockCrusherSeed(&manager->blockCrusher, seed);
+    InitBlockCrusher(&manager->blockCrusher);
+    
+    if (manager->recordPath) {
+        InputRecording* recording = &manager->recording;
+        FreeInputRecording(recording);
+        recording->seed = seed;
+        recording->tickRate = manager->tickRate;
+        recording->screenWidth = BLOCK_CRUSHER_WIDTH;
+        recording->screenHeight = BLOCK_CRUSHER_HEIGHT;
+        recording->blockRows = manager->blockRows;
+        recording->blockCols = manager->blockCols;
+        recording->startBalls = manager->startBalls;
+        recording->maxBalls = manager->maxBalls;
+        SetBlockCrusherRecording(&manager->blockCrusher, recording);
+        manager->isRecording = true;
+    }
+}
+
+static void FinishRecording(GameManager* manager) {
+    if (!manager->isRecording) return;
+    
+    InputRecording* recording = &manager->recording;
+    recording->finalScore = manager->blockCrusher.score;
+    recording->finalHash = HashBlockCrusherState(&manager->blockCrusher);
+    SetBlockCrusherRecording(&manager->blockCrusher, NULL);
+    manager->isRecording = false;
+    
+    if (SaveInputRecording(recording, manager->recordPath)) {
+        printf("recorded %llu ticks (%d input runs) to %s\n",
+               (unsigned long long)recording->tickCount, recording->runCount, manager->recordPath);
+    } else {
+        fprintf(stderr, "Failed to write recording %s\n", manager->recordPath);
+    }
+    FreeInputRecording(recording);
+}
+
+static const char* const moduleNames[GAME_STATE_COUNT] = {
+    [GAME_SNAKE] = "snake",
+    [GAME_TETRIS] = "tetris",
+};
+
+// Loads a game's module on first use, from --modules DIR or else the
+// modules directory next to the executable.
+static bool loadModule(GameManager* manager, GameState game) {
+    LoadedGameModule* module = &manager->modules[game];
+    if (module->api) return true;
+    const char* directory = manager->modulePath ? manager->modulePath
+                                                : TextFormat("%s%s", GetApplicationDirectory(), MODULE_DIRECTORY);
+    return LoadGameModule(module, directory, moduleNames[game]);
+}
+
+static void startModule(GameManager* manager, GameState game) {
+    GameModuleConfig config = {
+        .seed = SessionSeed(manager),
+        .snakeWidth = manager->snakeWidth,
+        .snakeHeight = manager->snakeHeight,
+        .snakeLength = manager->snakeLength,
+    };
+    StartGameModule(&manager->modules[game], &config);
+}
+
+// --headless --game snake|tetris: the module runs its own autopilot.
+static void RunHeadlessModule(GameManager* manager, GameState game) {
+    LoadedGameModule* module = &manager->modules[game];
+    long frames = manager->headlessFrames > 0 ? manager->headlessFrames : DEFAULT_HEADLESS_FRAMES;
+    if (!loadModule(manager, game)) exit(1);
+    
+    manager->currentGame = game;
+    startModule(manager, game);
+    module->api->runHeadless(module->state, frames);
+    UnloadGameModule(module);
+}
+
+void RunHeadless(GameManager* manager) {
+    BlockCrusherGame* game = &manager->blockCrusher;
+    long frames = manager->headlessFrames > 0 ? manager->headlessFrames : DEFAULT_HEADLESS_FRAMES;
+    
+    if (manager->headlessGame != GAME_BLOCK_CRUSHER) {
+        RunHeadlessModule(manager, manager->headlessGame);
+        return;
+    }
+    
+    manager->currentGame = GAME_BLOCK_CRUSHER;
+    
+    SetBlockCrusherTickRate(game, manager->tickRate);
+    SetBlockCrusherLayout(game, manager->blockRows, manager->blockCols);
+    SetBlockCrusherBalls(game, manager->startBalls, manager->maxBalls);
+    SetBlockCrusherLevels(game, &manager->levels);
+    StartBlockCrusher(manager);
+    
+    // --idle holds the paddle still instead of flying the autopilot;
+    // --fast-forward does too, so it has one held input to jump through.
+    FastForward engine = {0};
+    double start = MonotonicSeconds();
+    if (manager->fastForward) {
+        AdvanceBlockCrusher(&engine, game, (BlockCrusherInput){0}, game->tick + frames);
+    } else {
+        for (long frame = 0; frame < frames; frame++) {
+            StepBlockCrusher(game, manager->idle ? (BlockCrusherInput){0} : AutopilotBlockCrusher(game));
+        }
+    }
+    double elapsed = MonotonicSeconds() - start;
+    
+    printf("ticks: %ld\n", frames);
+    if (manager->fastForward) {
+        printf("stepped: %llu skipped: %llu\n", (unsigned long long)engine.steppedTicks,
+               (unsigned long long)engine.skippedTicks);
+    }
+    printf("seconds: %.3f\n", elapsed);
+    printf("ticks/sec: %.0f\n", elapsed > 0 ? frames / elapsed : 0.0);
+    printf("tick rate: %d Hz (%.1fx realtime)\n", manager->tickRate,
+           elapsed > 0 ? frames / (elapsed * manager->tickRate) : 0.0);
+    printf("score: %d lives: %d balls: %d\n", game->score, game->lives, game->balls.count);
+    printf("state hash: %016llx\n", (unsigned long long)HashBlockCrusherState(game));
+    printf("ball kernel: %s\n", BallKernelName());
+    
+    FinishRecording(manager);
+    FreeFastForward(&engine);
+    CloseBlockCrusher(game);
+}
+
+typedef struct {
+    const GameManager* manager;
+    uint64_t seed;
+    long frames;
+    BlockCrusherGame* games;
+    int* scores;
+} BatchRun;
+
+// Each worker reuses one context for all the games it runs, so the block
+// field and ball buffers are only allocated once per thread.
+static void RunBatchGame(void* context, int task, int worker) {
+    BatchRun* batch = context;
+    const GameManager* manager = batch->manager;
+    BlockCrusherGame* game = &batch->games[worker];
+    
+    SetBlockCrusherTickRate(game, manager->tickRate);
+    SetBlockCrusherLayout(game, manager->blockRows, manager->blockCols);
+    SetBlockCrusherBalls(game, manager->startBalls, manager->maxBalls);
+    SetBlockCrusherLevels(game, &manager->levels);
+    SetBlockCrusherSeed(game, batch->seed + task);
+    InitBlockCrusher(game);
+    
+    for (long frame = 0; frame < batch->frames; frame++) {
+        StepBlockCrusher(game, AutopilotBlockCrusher(game));
+    }
+    batch->scores[task] = game->score;
+}
+
+int ExportLevel(GameManager* manager) {
+    SetBlockCrusherLayout(&manager->blockCrusher, manager->blockRows, manager->blockCols);
+    if (!ExportBlockCrusherLevel(&manager->blockCrusher, manager->exportLevelPath)) {
+        fprintf(stderr, "Failed to write level %s\n", manager->exportLevelPath);
+        return 1;
+    }
+    printf("wrote %s\n", manager->exportLevelPath);
+    return 0;
+}
+
+// Runs --batch independent autopilot games (seeds seed, seed+1, ...) across
+// a work-stealing pool and reports throughput overall and per thread.
+void RunBatch(GameManager* manager) {
+    int games = manager->batchGames;
+    int threads = manager->threads > 0 ? manager->threads : WorkPoolDefaultThreads();
+    
+    BatchRun batch;
+    batch.manager = manager;
+    batch.seed = manager->fixedSeed ? manager->seed : (uint64_t)time(NULL);
+    batch.frames = manager->headlessFrames > 0 ? manager->headlessFrames : DEFAULT_BATCH_FRAMES;
+    batch.games = calloc(threads, sizeof(BlockCrusherGame));
+    batch.scores = calloc(games, sizeof(int));
+    WorkerStats* stats = calloc(threads, sizeof(WorkerStats));
+    
+    // Pick the ball kernel before any worker thread asks for it.
+    const char* kernel = BallKernelName();
+    
+    double start = MonotonicSeconds();
+    threads = RunWorkPool(games, threads, RunBatchGame, &batch, stats);
+    double elapsed = MonotonicSeconds() - start;
+    
+    double totalTicks = (double)games * batch.frames;
+    long long scoreSum = 0;
+    int minScore = games > 0 ? batch.scores[0] : 0;
+    int maxScore = minScore;
+    for (int i = 0; i < games; i++) {
+        scoreSum += batch.scores[i];
+        if (batch.scores[i] < minScore) minScore = batch.scores[i];
+        if (batch.scores[i] > maxScore) maxScore = batch.scores[i];
+    }
+    
+    printf("games: %d x %ld ticks (seeds %llu..%llu)\n", games, batch.frames,
+           (unsigned long long)batch.seed, (unsigned long long)(batch.seed + (games > 0 ? games - 1 : 0)));
+    printf("threads: %d\n", threads);
+    printf("seconds: %.3f\n", elapsed);
+    printf("ticks/sec: %.0f\n", elapsed > 0 ? totalTicks / elapsed : 0.0);
+    printf("ticks/sec per core: %.0f\n", elapsed > 0 ? totalTicks / (elapsed * threads) : 0.0);
+    for (int i = 0; i < threads; i++) {
+        printf("  worker %d: %d games, %d steals, %.1f%% busy\n", i, stats[i].tasks, stats[i].steals,
+               elapsed > 0 ? 100.0 * stats[i].busySeconds / elapsed : 0.0);
+    }
+    printf("score: mean %.1f min %d max %d\n", games > 0 ? (double)scoreSum / games : 0.0, minScore, maxScore);
+    printf("ball kernel: %s\n", kernel);
+    
+    for (int i = 0; i < threads; i++) {
+        CloseBlockCrusher(&batch.games[i]);
+    }
+    free(batch.games);
+    free(batch.scores);
+    free(stats);
+}
+
+// Re-runs a recording with no window and no frame pacing, then checks that
+// it ends with the same score and state hash as the recorded session.
+int RunReplay(GameManager* manager) {
+    InputRecording recording;
+    if (!LoadInputRecording(&recording, manager->replayPath)) {
+        fprintf(stderr, "Could not read recording %s\n", manager->replayPath);
+        return 1;
+    }
+    
+    manager->currentGame = GAME_BLOCK_CRUSHER;
+    if (recording.screenWidth != BLOCK_CRUSHER_WIDTH || recording.screenHeight != BLOCK_CRUSHER_HEIGHT) {
+        fprintf(stderr, "Recording was made at %dx%d; Block Crusher now always runs at %dx%d\n",
+                recording.screenWidth, recording.screenHeight, BLOCK_CRUSHER_WIDTH, BLOCK_CRUSHER_HEIGHT);
+        FreeInputRecording(&recording);
+        return 1;
+    }
+    
+    
+    SetBlockCrusherTickRate(&manager->blockCrusher, recording.tickRate);
+    SetBlockCrusherLayout(&manager->blockCrusher, recording.blockRows, recording.blockCols);
+    SetBlockCrusherBalls(&manager->blockCrusher, recording.startBalls, recording.maxBalls);
+    SetBlockCrusherLevels(&manager->blockCrusher, &manager->levels);
+    SetBlockCrusherSeed(&manager->blockCrusher, recording.seed);
+    InitBlockCrusher(&manager->blockCrusher);
+    
+    ReplayCursor cursor;
+    BlockCrusherInput input;
+    BeginReplay(&cursor, &recording);
+    FastForward engine = {0};
+    BlockCrusherGame* game = &manager->blockCrusher;
+    
+    double start = MonotonicSeconds();
+    if (manager->fastForward) {
+        for (int i = 0; i < recording.runCount; i++) {
+            const InputRun* run = &recording.runs[i];
+            AdvanceBlockCrusher(&engine, game, UnpackBlockCrusherInput(run->input), game->tick + run->length);
+        }
+    } else {
+        while (NextReplayInput(&cursor, &input)) {
+            StepBlockCrusher(game, input);
+        }
+    }
+    double elapsed = MonotonicSeconds() - start;
+    
+    int score = manager->blockCrusher.score;
+    uint64_t hash = HashBlockCrusherState(&manager->blockCrusher);
+    bool match = score == recording.finalScore && hash == recording.finalHash;
+    
+    printf("replay: %s\n", manager->replayPath);
+    printf("ticks: %llu (%d input runs)\n", (unsigned long long)recording.tickCount, recording.runCount);
+    printf("seconds: %.3f\n", elapsed);
+    printf("ticks/sec: %.0f\n", elapsed > 0 ? recording.tickCount / elapsed : 0.0);
+    printf("score: %d (recorded %d)\n", score, recording.finalScore);
+    printf("state hash: %016llx (recorded %016llx)\n",
+           (unsigned long long)hash, (unsigned long long)recording.finalHash);
+    if (manager->fastForward) {
+        printf("stepped: %llu skipped: %llu\n", (unsigned long long)engine.steppedTicks,
+               (unsigned long long)engine.skippedTicks);
+    }
+    printf("result: %s\n", match ? "match" : "MISMATCH");
+    
+    FreeFastForward(&engine);
+    CloseBlockCrusher(&manager->blockCrusher);
+    FreeInputRecording(&recording);
+    return match ? 0 : 1;
+}
 
 void InitGameManager(GameManager* manager) {
     manager->currentGame = GAME_MAIN_MENU;
@@ -13,39 +479,258 @@ void InitGameManager(GameManager* manager) {
     SetTraceLogLevel(LOG_NONE);
     SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_MSAA_4X_HINT);
     InitWindow(manager->screenWidth, manager->screenHeight, "Retro Games Collection");
-    SetTargetFPS(60);
+    // --low-latency paces frames itself, sleeping before input is read
+    // rather than after the frame is drawn.
+    SetTargetFPS(manager->lowLatency ? 0 : manager->targetFPS);
+    InitInputLatency(&manager->latency, manager->targetFPS, manager->lowLatency);
+    InitQualityGovernor(&manager->quality, manager->targetFPS);
+    PinQualityLevel(&manager->quality, manager->pinnedQuality);
+    SetBlockCrusherTickRate(&manager->blockCrusher, manager->tickRate);
+    SetBlockCrusherLayout(&manager->blockCrusher, manager->blockRows, manager->blockCols);
+    SetBlockCrusherBalls(&manager->blockCrusher, manager->startBalls, manager->maxBalls);
+    SetBlockCrusherLevels(&manager->blockCrusher, &manager->levels);
+    manager->blockCrusher.renderer.latePaddle = manager->lowLatency;
+}
+
+// --input-latency reports each Block Crusher session as it ends; with
+// --threaded that is the simulation thread's tick lateness instead.
+static void reportLatency(GameManager* manager) {
+    if (!manager->reportLatency) return;
+    if (manager->threaded) {
+        PrintBlockCrusherThreadStats(&manager->simulation);
+        return;
+    }
+    PrintLatencyHistogram(&manager->latency.histogram);
+    ResetInputLatency(&manager->latency);
+}
+
+// F4 saves on demand; with --profile-csv the history is also saved on exit.
+static void saveProfile(GameManager* manager) {
+    const char* path = manager->profilePath ? manager->profilePath : DEFAULT_PROFILE_PATH;
+    if (ExportProfilerCSV(path)) {
+        printf("Saved frame profile to %s\n", path);
+    } else {
+        fprintf(stderr, "Could not write frame profile %s\n", path);
+    }
+}
+
+// --threaded: the simulation thread ticks on its own, so a frame only passes
+// input over and draws the newest snapshot.
+static void runThreadedBlockCrusher(GameManager* manager) {
+    if (IsKeyPressed(KEY_M)) {
+        StopBlockCrusherThread(&manager->simulation);
+        FinishRecording(manager);
+        reportLatency(manager);
+        manager->currentGame = GAME_MAIN_MENU;
+        ClearBackground(BLACK);
+        return;
+    }
+    
+    PROFILE_BEGIN(PROFILE_UPDATE);
+    PROFILE_BEGIN(PROFILE_INPUT);
+    SendBlockCrusherInput(&manager->simulation, ReadBlockCrusherInput());
+    PROFILE_END(PROFILE_INPUT);
+    PROFILE_END(PROFILE_UPDATE);
+    
+    PROFILE_BEGIN(PROFILE_DRAW);
+    DrawBlockCrusherThread(&manager->simulation, manager->frameTime, manager->screenWidth, manager->screenHeight);
+    PROFILE_END(PROFILE_DRAW);
+}
+
+// Save states and rewind are for interactive, single-threaded play. They
+// stay off while recording, since a replay only has the per-tick input to
+// go on, and with --threaded, where the simulation thread owns the game.
+static void enableSaveStates(GameManager* manager) {
+    if (manager->threaded || manager->isRecording) {
+        SetBlockCrusherRewind(&manager->blockCrusher, NULL);
+        return;
+    }
+    if (!manager->rewind.deltas) InitRewind(&manager->rewind, manager->tickRate * REWIND_SECONDS, REWIND_BUDGET);
+    ClearRewind(&manager->rewind);
+    SetBlockCrusherRewind(&manager->blockCrusher, &manager->rewind);
+}
+
+// F5 saves to the current slot, F9 loads it and F6 moves to the next slot.
+// Holding Backspace rewinds at real-time speed instead of updating; returns
+// true for frames spent rewinding.
+static bool handleSaveStates(GameManager* manager) {
+    BlockCrusherGame* game = &manager->blockCrusher;
+    if (!game->rewind) return false;
+    
+    if (IsKeyPressed(KEY_F6)) {
+        manager->saveSlot = (manager->saveSlot + 1) % SAVE_SLOTS;
+        printf("save slot %d\n", manager->saveSlot + 1);
+    }
+    StateBuffer* slot = &manager->saveSlots[manager->saveSlot];
+    if (IsKeyPressed(KEY_F5)) {
+        SaveBlockCrusherState(game, slot);
+        printf("saved slot %d (%zu bytes)\n", manager->saveSlot + 1, slot->size);
+    }
+    if (IsKeyPressed(KEY_F9)) {
+        if (slot->size > 0 && LoadBlockCrusherState(game, slot)) {
+            printf("loaded slot %d\n", manager->saveSlot + 1);
+        } else {
+            printf("slot %d is empty\n", manager->saveSlot + 1);
+        }
+    }
+    
+    if (!IsKeyDown(KEY_BACKSPACE)) return false;
+    
+    int steps = (int)(manager->frameTime * game->tickRate + 0.5f);
+    if (steps < 1) steps = 1;
+    while (steps-- > 0 && PopRewind(&manager->rewind, game)) {
+    }
+    game->accumulator = 0.0f;
+    game->renderAlpha = 1.0f;
+    return true;
+}
+
+// The menu never changes, so it is drawn once into a texture the size of
+// the window and later frames only copy that.
+static void drawCachedMenu(GameManager* manager) {
+    RenderTexture2D* cache = &manager->menuCache;
+    int width = manager->screenWidth;
+    int height = manager->screenHeight;
+    if (width <= 0 || height <= 0) return;
+    
+    if (cache->id == 0 || cache->texture.width != width || cache->texture.height != height) {
+        if (cache->id != 0) UnloadRenderTexture(*cache);
+        *cache = LoadRenderTexture(width, height);
+        BeginTextureMode(*cache);
+        DrawMainMenu(manager);
+        EndTextureMode();
+    }
+    DrawTextureRec(cache->texture, (Rectangle){0, 0, width, -height}, (Vector2){0, 0}, WHITE);
+}
+
+// A still screen shows the same frame until input arrives, so instead of
+// drawing it again every frame EndDrawing blocks until an event comes in.
+// The woken frame runs straight away, and the first frame that isn't still
+// turns waiting off again, so play is paced as usual from the frame a key
+// press resumes it.
+static void waitForEvents(GameManager* manager, bool still) {
+    if (still == manager->waitingForEvents) return;
+    if (still) EnableEventWaiting();
+    else DisableEventWaiting();
+    manager->waitingForEvents = still;
 }
 
 void RunGameManager(GameManager* manager) {
     while (!WindowShouldClose() && manager->isRunning) {
+        // Games draw at a fixed logical size and are scaled on present, so
+        // a resize only has to update the window size.
         if (IsWindowResized()) {
             manager->screenWidth = GetScreenWidth();
             manager->screenHeight = GetScreenHeight();
-            
-            switch (manager->currentGame) {
-                case GAME_BLOCK_CRUSHER:
-                    InitBlockCrusher(manager->screenWidth, manager->screenHeight);
-                    break;
-                default:
-                    break;
-            }
         }
         
+        // A wait lands in the update time of the frame after it, which
+        // GetFrameTime reports the frame after that; that frame, and the
+        // quality governor's measurement of it, use the nominal frame time.
+        bool waitInFrameTime = manager->waitHistory & 2;
+        manager->frameTime = waitInFrameTime ? 1.0f / (manager->targetFPS > 0 ? manager->targetFPS : DEFAULT_TARGET_FPS)
+                                             : GetFrameTime();
+        bool still = false;
+        
+        BeginProfilerFrame();
+        // Only single-threaded Block Crusher draws the frame from the input
+        // it reads, so that is all the latency numbers cover.
+        WaitForInputLatch(&manager->latency, manager->currentGame == GAME_BLOCK_CRUSHER && !manager->threaded);
+        if (IsKeyPressed(KEY_F3)) ToggleProfilerOverlay();
+        if (IsKeyPressed(KEY_F4)) saveProfile(manager);
+        if (IsKeyPressed(KEY_F7)) ToggleQualityOverlay(&manager->quality);
+        
+        // Only Block Crusher has quality to trade; the other screens are
+        // cheap and would only skew the governor's measurements.
+        bool governed = manager->currentGame == GAME_BLOCK_CRUSHER;
+        bool timed = governed && !waitInFrameTime;
+        if (governed) {
+            if (timed) BeginQualityFrame(&manager->quality);
+            BlockCrusherRenderer* renderer = manager->threaded ? &manager->simulation.renderer
+                                                               : &manager->blockCrusher.renderer;
+            SetBlockCrusherQuality(renderer, GetQualityLevel(&manager->quality));
+        }
+        
+        BeginDrawing();
         switch (manager->currentGame) {
-            case GAME_BLOCK_CRUSHER:
-                UpdateBlockCrusher(manager->screenWidth, manager->screenHeight, manager);
-                DrawBlockCrusher(manager->screenWidth, manager->screenHeight);
+            case GAME_BLOCK_CRUSHER: {
+                if (manager->threaded) {
+                    runThreadedBlockCrusher(manager);
+                    break;
+                }
+                PROFILE_BEGIN(PROFILE_UPDATE);
+                if (!handleSaveStates(manager)) UpdateBlockCrusher(&manager->blockCrusher, manager);
+                PROFILE_END(PROFILE_UPDATE);
+                if (manager->currentGame != GAME_BLOCK_CRUSHER) {
+                    FinishRecording(manager);
+                    reportLatency(manager);
+                    ClearBackground(BLACK);
+                    break;
+                }
+                PROFILE_BEGIN(PROFILE_DRAW);
+                DrawBlockCrusher(&manager->blockCrusher, manager->frameTime, manager->screenWidth, manager->screenHeight);
+                // Rewinding runs at real-time speed, so it keeps frames coming.
+                still = manager->blockCrusher.renderer.stillFrame && !IsKeyDown(KEY_BACKSPACE);
+                // Input that arrived while the frame was simulated and drawn
+                // still makes it to the paddle.
+                if (manager->lowLatency) {
+                    LatchInput(&manager->latency);
+                    DrawLatePaddle(&manager->blockCrusher.renderer, &manager->blockCrusher, ReadBlockCrusherInput(),
+                                   manager->screenWidth, manager->screenHeight);
+                }
+                PROFILE_END(PROFILE_DRAW);
+                break;
+            }
+            case GAME_SNAKE:
+            case GAME_TETRIS: {
+                LoadedGameModule* module = &manager->modules[manager->currentGame];
+                PollGameModule(module);
+                PROFILE_BEGIN(PROFILE_UPDATE);
+                bool playing = module->api->update(module->state, manager->frameTime);
+                PROFILE_END(PROFILE_UPDATE);
+                if (!playing) {
+                    manager->currentGame = GAME_MAIN_MENU;
+                    ClearBackground(BLACK);
+                    break;
+                }
+                PROFILE_BEGIN(PROFILE_DRAW);
+                module->api->draw(module->state, manager->screenWidth, manager->screenHeight);
+                PROFILE_END(PROFILE_DRAW);
                 break;
-            default:
-                DrawMainMenu(manager);
+            }
+            default: {
+                PROFILE_BEGIN(PROFILE_DRAW);
+                drawCachedMenu(manager);
+                PROFILE_END(PROFILE_DRAW);
+                PROFILE_BEGIN(PROFILE_UPDATE);
                 HandleMainMenuInput(manager);
+                PROFILE_END(PROFILE_UPDATE);
+                still = manager->currentGame == GAME_MAIN_MENU;
                 break;
+            }
+        }
+        DrawProfilerOverlay(10, 40);
+        if (governed) {
+            DrawQualityOverlay(&manager->quality, 310, 40);
+            if (timed) EndQualityFrame(&manager->quality);
         }
+        
+        // The frame profiler's overlay only stays current while frames keep
+        // coming.
+        waitForEvents(manager, still && !IsProfilerOverlayVisible());
+        
+        SubmitFrame(&manager->latency);
+        PROFILE_BEGIN(PROFILE_PRESENT);
+        EndDrawing();
+        PROFILE_END(PROFILE_PRESENT);
+        EndInputLatencyFrame(&manager->latency, manager->waitingForEvents);
+        // A frame that waited would record the wait as its present time.
+        if (!manager->waitingForEvents) EndProfilerFrame();
+        manager->waitHistory = (manager->waitHistory << 1 | manager->waitingForEvents) & 3;
     }
 }
 
 void DrawMainMenu(GameManager* manager) {
-    BeginDrawing();
     ClearBackground(BLACK);
     
     int tt_s = 60;
@@ -56,8 +741,8 @@ void DrawMainMenu(GameManager* manager) {
     int optionSize = 30;
     const char* options[] = {
         "1. Block Crusher",
-        "2. Snake (Coming Soon)",
-        "3. Tetris (Coming Soon)",
+        "2. Snake",
+        "3. Tetris",
         "4. Exit"
     };
     
@@ -72,14 +757,20 @@ void DrawMainMenu(GameManager* manager) {
     int instructionWidth = MeasureText(instruction, inst_s);
     DrawText(instruction, manager->screenWidth/2 - instructionWidth/2,
             manager->screenHeight - 50, inst_s, GRAY);
-    
-    EndDrawing();
 }
 
 void HandleMainMenuInput(GameManager* manager) {
     if (IsKeyPressed(KEY_ONE)) {
         manager->currentGame = GAME_BLOCK_CRUSHER;
-        InitBlockCrusher(manager->screenWidth, manager->screenHeight);
+        StartBlockCrusher(manager);
+        enableSaveStates(manager);
+        if (manager->threaded) StartBlockCrusherThread(&manager->simulation, &manager->blockCrusher);
+    }
+    else if (IsKeyPressed(KEY_TWO) || IsKeyPressed(KEY_THREE)) {
+        GameState game = IsKeyPressed(KEY_TWO) ? GAME_SNAKE : GAME_TETRIS;
+        if (!loadModule(manager, game)) return;
+        manager->currentGame = game;
+        startModule(manager, game);
     }
     else if (IsKeyPressed(KEY_FOUR)) {
         manager->isRunning = false;
@@ -87,12 +778,21 @@ void HandleMainMenuInput(GameManager* manager) {
 }
 
 void CloseGameManager(GameManager* manager) {
-    switch (manager->currentGame) {
-        case GAME_BLOCK_CRUSHER:
-            CloseBlockCrusher();
-            break;
-        default:
-            break;
+    if (manager->currentGame == GAME_BLOCK_CRUSHER) {
+        if (manager->threaded) StopBlockCrusherThread(&manager->simulation);
+        FinishRecording(manager);
+        reportLatency(manager);
+        CloseBlockCrusher(&manager->blockCrusher);
+    }
+    for (int game = 0; game < GAME_STATE_COUNT; game++) {
+        UnloadGameModule(&manager->modules[game]);
+    }
+    if (manager->profilePath) saveProfile(manager);
+    FreeRewind(&manager->rewind);
+    for (int i = 0; i < SAVE_SLOTS; i++) {
+        FreeStateBuffer(&manager->saveSlots[i]);
     }
+    FreeLevelSet(&manager->levels);
+    if (manager->menuCache.id != 0) UnloadRenderTexture(manager->menuCache);
     CloseWindow();
 }
\ No newline at end of file
@@ -2,12 +2,25 @@
 #define GAME_MANAGER_H
 
 #include "raylib.h"
+#include "input_recording.h"
+#include "block_crusher_thread.h"
+#include "game_module.h"
+#include "latency.h"
+#include "level.h"
+#include "quality.h"
+#include "save_state.h"
 #include <stdbool.h>
+#include <stdint.h>
+
+#define SAVE_SLOTS 4
 
 typedef enum {
     GAME_MAIN_MENU = 0,
     GAME_BLOCK_CRUSHER,
+    GAME_SNAKE,
+    GAME_TETRIS,
     //ill add more games here
+    GAME_STATE_COUNT
 } GameState;
 
 typedef struct GameManager {
@@ -15,9 +28,63 @@ typedef struct GameManager {
     bool isRunning;
     int screenWidth;
     int screenHeight;
+    int tickRate;
+    int targetFPS;
+    int pinnedQuality;
+    bool lowLatency;
+    bool reportLatency;
+    int blockRows;
+    int blockCols;
+    int startBalls;
+    int maxBalls;
+    int snakeWidth;
+    int snakeHeight;
+    int snakeLength;
+    bool headless;
+    GameState headlessGame;
+    long headlessFrames;
+    bool idle;
+    bool fastForward;
+    int batchGames;
+    int threads;
+    bool threaded;
+    uint64_t seed;
+    bool fixedSeed;
+    const char* recordPath;
+    const char* replayPath;
+    BlockCrusherGame blockCrusher;
+    BlockCrusherThread simulation;
+    // Every game but Block Crusher is a module, loaded the first time it
+    // is picked from the menu. Block Crusher stays built in: recording,
+    // replays, rewind, --threaded and fast-forward all work on its state.
+    LoadedGameModule modules[GAME_STATE_COUNT];
+    const char* modulePath;
+    InputRecording recording;
+    RewindBuffer rewind;
+    StateBuffer saveSlots[SAVE_SLOTS];
+    int saveSlot;
+    LevelSet levels;
+    const char* exportLevelPath;
+    const char* profilePath;
+    QualityGovernor quality;
+    InputLatency latency;
+    // Screens that only change on input block in EndDrawing until an event
+    // arrives (raylib's event waiting). frameTime is what games advance by:
+    // GetFrameTime, except where that includes a wait. waitHistory has a
+    // bit per recent frame that waited, the newest lowest.
+    float frameTime;
+    bool waitingForEvents;
+    unsigned waitHistory;
+    RenderTexture2D menuCache;
+    bool isRecording;
 } GameManager;
 
+void ParseGameManagerArgs(GameManager* manager, int argc, char** argv);
 void InitGameManager(GameManager* manager);
+void RunHeadless(GameManager* manager);
+int RunReplay(GameManager* manager);
+void RunBatch(GameManager* manager);
+int ExportLevel(GameManager* manager);
 void RunGameManager(GameManager* manager);
 void DrawMainMenu(GameManager* manager);
 void HandleMainMenuInput(GameManager* manager);
@@ -0,0 +1,161 @@
+#include "game_module.h"
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MODULE_POLL_FRAMES 30
+#define COPY_CHUNK_BYTES 65536
+
+static bool readStamp(const char* path, ModuleStamp* stamp) {
+    struct stat info;
+    if (stat(path, &info) != 0) return false;
+    *stamp = (ModuleStamp){info.st_mtim, info.st_size, info.st_ino};
+    return true;
+}
+
+static bool sameStamp(const ModuleStamp* a, const ModuleStamp* b) {
+    return a->modified.tv_sec == b->modified.tv_sec && a->modified.tv_nsec == b->modified.tv_nsec &&
+           a->size == b->size && a->inode == b->inode;
+}
+
+// dlopen hands back the object it already has for a path it has seen, and
+// a build rewriting a mapped file can take the process down with it, so
+// every load maps a fresh copy made next to the original (where the build
+// could write, so it isn't on a noexec mount) and unlinks it right away.
+static void* openCopy(const char* path) {
+    int in = open(path, O_RDONLY);
+    if (in < 0) return NULL;
+
+    size_t length = strlen(path) + 8;
+    char* copy = malloc(length);
+    snprintf(copy, length, "%s.XXXXXX", path);
+    int out = mkstemp(copy);
+    if (out < 0) {
+        close(in);
+        free(copy);
+        return NULL;
+    }
+
+    char buffer[COPY_CHUNK_BYTES];
+    bool copied = true;
+    ssize_t count;
+    while ((count = read(in, buffer, sizeof(buffer))) > 0) {
+        if (write(out, buffer, count) != count) {
+            copied = false;
+            break;
+        }
+    }
+    if (count < 0) copied = false;
+    close(in);
+    close(out);
+
+    void* handle = copied ? dlopen(copy, RTLD_NOW | RTLD_LOCAL) : NULL;
+    unlink(copy);
+    free(copy);
+    return handle;
+}
+
+static const GameModule* openModule(const char* path, void** handle) {
+    *handle = openCopy(path);
+    if (!*handle) {
+        const char* error = dlerror();
+        fprintf(stderr, "Could not load game module %s%s%s\n", path, error ? ": " : "", error ? error : "");
+        return NULL;
+    }
+
+    GameModuleEntry entry = (GameModuleEntry)dlsym(*handle, GAME_MODULE_ENTRY);
+    const GameModule* api = entry ? entry() : NULL;
+    if (!api || api->abi != GAME_MODULE_ABI) {
+        fprintf(stderr, "%s is not a game module of version %d\n", path, GAME_MODULE_ABI);
+        dlclose(*handle);
+        *handle = NULL;
+        return NULL;
+    }
+    return api;
+}
+
+bool LoadGameModule(LoadedGameModule* module, const char* directory, const char* name) {
+    memset(module, 0, sizeof(*module));
+    size_t length = strlen(directory) + strlen(name) + 5;
+    module->path = malloc(length);
+    snprintf(module->path, length, "%s/%s.so", directory, name);
+    module->name = name;
+
+    if (!readStamp(module->path, &module->stamp)) {
+        fprintf(stderr, "Game module %s not found (./build.sh modules builds it)\n", module->path);
+    } else {
+        module->api = openModule(module->path, &module->handle);
+    }
+    if (!module->api) {
+        free(module->path);
+        module->path = NULL;
+        return false;
+    }
+
+    module->state = calloc(1, module->api->stateSize);
+    module->framesToPoll = MODULE_POLL_FRAMES;
+    return true;
+}
+
+void StartGameModule(LoadedGameModule* module, const GameModuleConfig* config) {
+    module->config = *config;
+    module->api->start(module->state, config);
+    module->started = true;
+}
+
+bool PollGameModule(LoadedGameModule* module) {
+    if (--module->framesToPoll > 0) return false;
+    module->framesToPoll = MODULE_POLL_FRAMES;
+
+    ModuleStamp stamp;
+    if (!readStamp(module->path, &stamp) || sameStamp(&stamp, &module->stamp)) {
+        module->hasPending = false;
+        return false;
+    }
+    // A build still writing the file changes it again by the next poll.
+    if (!module->hasPending || !sameStamp(&stamp, &module->pending)) {
+        module->pending = stamp;
+        module->hasPending = true;
+        return false;
+    }
+    module->hasPending = false;
+
+    // A build that fails to load is skipped until the file changes again.
+    module->stamp = stamp;
+    void* handle;
+    const GameModule* api = openModule(module->path, &handle);
+    if (!api) return false;
+
+    StateBuffer snapshot = {0};
+    if (module->started) {
+        module->api->save(module->state, &snapshot);
+        module->api->close(module->state);
+    }
+    dlclose(module->handle);
+    module->handle = handle;
+    module->api = api;
+    module->generation++;
+    module->state = realloc(module->state, api->stateSize);
+    memset(module->state, 0, api->stateSize);
+
+    if (module->started && !api->restore(module->state, &snapshot)) {
+        fprintf(stderr, "%s: the new build can't restore the running game, starting over\n", api->name);
+        api->start(module->state, &module->config);
+    }
+    FreeStateBuffer(&snapshot);
+    printf("reloaded %s (%d)\n", api->name, module->generation);
+    return true;
+}
+
+void UnloadGameModule(LoadedGameModule* module) {
+    if (!module->api) return;
+    if (module->started) module->api->close(module->state);
+    free(module->state);
+    dlclose(module->handle);
+    free(module->path);
+    memset(module, 0, sizeof(*module));
+}
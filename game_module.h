@@ -0,0 +1,86 @@
+#ifndef GAME_MODULE_H
+#define GAME_MODULE_H
+
+#include "state_buffer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+// Bumped whenever GameModule or GameModuleConfig change; the host refuses
+// modules built against another version.
+#define GAME_MODULE_ABI 2
+
+// Every module exports a GameModuleEntry under this name.
+#define GAME_MODULE_ENTRY "GetGameModule"
+
+// What a game gets from the command line when it starts.
+typedef struct {
+    uint64_t seed;
+    int snakeWidth;
+    int snakeHeight;
+    int snakeLength;
+} GameModuleConfig;
+
+// A game built as a shared object. The host owns the game's state, stateSize
+// zeroed bytes, and passes it to every call. start may be called again on a
+// started state (a new session from the menu) and should reuse what it can;
+// update advances the game by frameTime seconds (the host's, not raylib's
+// GetFrameTime, which counts time spent waiting on an idle screen) and
+// returns false to go back to the menu; close frees everything the
+// state holds, GPU resources included. save and restore carry a running game
+// across a reload, so restore must reject snapshots it can't read, including
+// ones from an older build of the module. runHeadless is --headless: it plays
+// frames autopilot steps in a started state and prints a report.
+typedef struct {
+    int abi;
+    const char* name;
+    size_t stateSize;
+    void (*start)(void* state, const GameModuleConfig* config);
+    bool (*update)(void* state, float frameTime);
+    void (*draw)(void* state, int windowWidth, int windowHeight);
+    void (*close)(void* state);
+    void (*save)(const void* state, StateBuffer* out);
+    bool (*restore)(void* state, const StateBuffer* snapshot);
+    void (*runHeadless)(void* state, long frames);
+} GameModule;
+
+typedef const GameModule* (*GameModuleEntry)(void);
+
+// Identifies one build of a module file.
+typedef struct {
+    struct timespec modified;
+    off_t size;
+    ino_t inode;
+} ModuleStamp;
+
+// A module as the host holds it. The shared object is opened from a private
+// copy, so the build can replace the file at any time; once a new build has
+// sat unchanged for one poll, the next poll reloads it, carrying a started
+// game over with save/restore (or starting it over with the same config if
+// the new build can't restore it).
+typedef struct {
+    const char* name;
+    char* path;
+    void* handle;
+    const GameModule* api;
+    void* state;
+    bool started;
+    GameModuleConfig config;
+    ModuleStamp stamp;
+    ModuleStamp pending;
+    bool hasPending;
+    int framesToPoll;
+    int generation;
+} LoadedGameModule;
+
+// Loads directory/name.so; false (with a message on stderr) if it is
+// missing or not a module of this version.
+bool LoadGameModule(LoadedGameModule* module, const char* directory, const char* name);
+void StartGameModule(LoadedGameModule* module, const GameModuleConfig* config);
+// Called once per frame while the module's game runs; true after a reload.
+bool PollGameModule(LoadedGameModule* module);
+void UnloadGameModule(LoadedGameModule* module);
+
+#endif
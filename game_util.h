@@ -0,0 +1,38 @@
+#ifndef GAME_UTIL_H
+#define GAME_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+// Helpers shared by the game and the game modules. Modules only link
+// presentation.c and state_buffer.c, so these live in the header.
+
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325ULL
+
+// splitmix64: any seed, including 0, gives a full-period stream, and the
+// whole generator is one word of state that replays can reproduce.
+static inline uint64_t SplitMix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// One FNV-1a step per byte; start from FNV_OFFSET_BASIS.
+static inline uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static inline double MonotonicSeconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#endif
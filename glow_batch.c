@@ -0,0 +1,89 @@
+#include "glow_batch.h"
+#include "rlgl.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define GLOW_TEXTURE_SIZE 64
+#define GLOW_CHUNK 1024
+
+void BeginGlowBatch(GlowBatch* batch) {
+    batch->count = 0;
+}
+
+void ReserveGlowSprites(GlowBatch* batch, int extra) {
+    int needed = batch->count + extra;
+    if (needed <= batch->capacity) return;
+
+    int capacity = batch->capacity ? batch->capacity : 256;
+    while (capacity < needed) capacity *= 2;
+    batch->sprites = realloc(batch->sprites, capacity * sizeof(GlowSprite));
+    batch->capacity = capacity;
+}
+
+static Texture2D loadDiscTexture(void) {
+    Image image = GenImageColor(GLOW_TEXTURE_SIZE, GLOW_TEXTURE_SIZE, BLANK);
+    Color* pixels = (Color*)image.data;
+    float center = GLOW_TEXTURE_SIZE / 2.0f;
+
+    for (int y = 0; y < GLOW_TEXTURE_SIZE; y++) {
+        for (int x = 0; x < GLOW_TEXTURE_SIZE; x++) {
+            float dx = x + 0.5f - center;
+            float dy = y + 0.5f - center;
+            float coverage = center - sqrtf(dx * dx + dy * dy);
+            if (coverage > 1.0f) coverage = 1.0f;
+            if (coverage < 0.0f) coverage = 0.0f;
+            pixels[y * GLOW_TEXTURE_SIZE + x] = (Color){255, 255, 255, (unsigned char)(coverage * 255)};
+        }
+    }
+
+    Texture2D texture = LoadTextureFromImage(image);
+    SetTextureFilter(texture, TEXTURE_FILTER_BILINEAR);
+    UnloadImage(image);
+    return texture;
+}
+
+void DrawGlowBatch(GlowBatch* batch) {
+    if (batch->count == 0) return;
+    if (batch->texture.id == 0) batch->texture = loadDiscTexture();
+
+    for (int start = 0; start < batch->count; start += GLOW_CHUNK) {
+        int end = start + GLOW_CHUNK;
+        if (end > batch->count) end = batch->count;
+
+        // Consecutive chunks with the same texture merge into one draw call
+        // unless rlgl's vertex buffer fills up and has to be flushed.
+        rlCheckRenderBatchLimit((end - start) * 4);
+        rlSetTexture(batch->texture.id);
+        rlBegin(RL_QUADS);
+
+        for (int i = start; i < end; i++) {
+            const GlowSprite* s = &batch->sprites[i];
+            float x0 = s->position.x - s->radius;
+            float y0 = s->position.y - s->radius;
+            float x1 = s->position.x + s->radius;
+            float y1 = s->position.y + s->radius;
+
+            rlColor4ub(s->color.r, s->color.g, s->color.b, s->color.a);
+            rlTexCoord2f(0.0f, 0.0f);
+            rlVertex2f(x0, y0);
+            rlTexCoord2f(0.0f, 1.0f);
+            rlVertex2f(x0, y1);
+            rlTexCoord2f(1.0f, 1.0f);
+            rlVertex2f(x1, y1);
+            rlTexCoord2f(1.0f, 0.0f);
+            rlVertex2f(x1, y0);
+        }
+
+        rlEnd();
+        rlSetTexture(0);
+    }
+}
+
+void UnloadGlowBatch(GlowBatch* batch) {
+    if (batch->texture.id != 0) UnloadTexture(batch->texture);
+    free(batch->sprites);
+    batch->sprites = NULL;
+    batch->count = 0;
+    batch->capacity = 0;
+    batch->texture = (Texture2D){0};
+}
@@ -0,0 +1,34 @@
+#ifndef GLOW_BATCH_H
+#define GLOW_BATCH_H
+
+#include "raylib.h"
+
+typedef struct {
+    Vector2 position;
+    float radius;
+    Color color;
+} GlowSprite;
+
+// Soft-edged discs collected during a frame and drawn as textured quads in a
+// single rlgl batch, instead of one tessellated DrawCircleV per disc.
+typedef struct {
+    GlowSprite* sprites;
+    int count;
+    int capacity;
+    Texture2D texture;
+} GlowBatch;
+
+void BeginGlowBatch(GlowBatch* batch);
+void ReserveGlowSprites(GlowBatch* batch, int extra);
+void DrawGlowBatch(GlowBatch* batch);
+void UnloadGlowBatch(GlowBatch* batch);
+
+static inline void AddGlowSprite(GlowBatch* batch, Vector2 position, float radius, Color color) {
+    if (batch->count == batch->capacity) ReserveGlowSprites(batch, 1);
+    GlowSprite* sprite = &batch->sprites[batch->count++];
+    sprite->position = position;
+    sprite->radius = radius;
+    sprite->color = color;
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include "input_recording.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RECORDING_MAGIC "BCRP"
+#define RECORDING_VERSION 2
+#define MIN_RUN_BYTES 2         // u8 input and a one-byte varint
+#define TRAILER_BYTES 12        // finalScore and finalHash
+
+// File layout, all integers little-endian:
+//   "BCRP" u16 version u16 reserved
+//   u64 seed, u32 tickRate, u32 screenWidth, u32 screenHeight,
+//   u32 blockRows, u32 blockCols, u32 startBalls, u32 maxBalls
+//   u64 tickCount, u32 runCount, runCount x (u8 input, varint length)
+//   i32 finalScore, u64 finalHash
+
+uint8_t PackBlockCrusherInput(BlockCrusherInput input) {
+    uint8_t bits = 0;
+    if (input.left) bits |= INPUT_LEFT;
+    if (input.right) bits |= INPUT_RIGHT;
+    if (input.pause) bits |= INPUT_PAUSE;
+    if (input.restart) bits |= INPUT_RESTART;
+    return bits;
+}
+
+BlockCrusherInput UnpackBlockCrusherInput(uint8_t bits) {
+    BlockCrusherInput input;
+    input.left = (bits & INPUT_LEFT) != 0;
+    input.right = (bits & INPUT_RIGHT) != 0;
+    input.pause = (bits & INPUT_PAUSE) != 0;
+    input.restart = (bits & INPUT_RESTART) != 0;
+    return input;
+}
+
+void RecordInput(InputRecording* recording, BlockCrusherInput input) {
+    uint8_t bits = PackBlockCrusherInput(input);
+    recording->tickCount++;
+
+    if (recording->runCount > 0) {
+        InputRun* last = &recording->runs[recording->runCount - 1];
+        if (last->input == bits && last->length < UINT32_MAX) {
+            last->length++;
+            return;
+        }
+    }
+
+    if (recording->runCount == recording->runCapacity) {
+        recording->runCapacity = recording->runCapacity ? recording->runCapacity * 2 : 256;
+        recording->runs = realloc(recording->runs, recording->runCapacity * sizeof(InputRun));
+    }
+    recording->runs[recording->runCount++] = (InputRun){bits, 1};
+}
+
+static void putUint(FILE* file, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        fputc((int)(value & 0xFF), file);
+        value >>= 8;
+    }
+}
+
+static bool getUint(FILE* file, uint64_t* value, int bytes) {
+    uint64_t result = 0;
+    for (int i = 0; i < bytes; i++) {
+        int c = fgetc(file);
+        if (c == EOF) return false;
+        result |= (uint64_t)c << (8 * i);
+    }
+    *value = result;
+    return true;
+}
+
+static void putVarint(FILE* file, uint32_t value) {
+    while (value >= 0x80) {
+        fputc((int)(value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    fputc((int)value, file);
+}
+
+static bool getVarint(FILE* file, uint32_t* value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int c = fgetc(file);
+        if (c == EOF) return false;
+        result |= (uint32_t)(c & 0x7F) << shift;
+        if (!(c & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SaveInputRecording(const InputRecording* recording, const char* path) {
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+
+    fwrite(RECORDING_MAGIC, 1, 4, file);
+    putUint(file, RECORDING_VERSION, 2);
+    putUint(file, 0, 2);
+    putUint(file, recording->seed, 8);
+    putUint(file, (uint32_t)recording->tickRate, 4);
+    putUint(file, (uint32_t)recording->screenWidth, 4);
+    putUint(file, (uint32_t)recording->screenHeight, 4);
+    putUint(file, (uint32_t)recording->blockRows, 4);
+    putUint(file, (uint32_t)recording->blockCols, 4);
+    putUint(file, (uint32_t)recording->startBalls, 4);
+    putUint(file, (uint32_t)recording->maxBalls, 4);
+    putUint(file, recording->tickCount, 8);
+    putUint(file, (uint32_t)recording->runCount, 4);
+
+    for (int i = 0; i < recording->runCount; i++) {
+        fputc(recording->runs[i].input, file);
+        putVarint(file, recording->runs[i].length);
+    }
+
+    putUint(file, (uint32_t)recording->finalScore, 4);
+    putUint(file, recording->finalHash, 8);
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+// Bytes from the current position to the end of the file, 0 if unknown.
+static uint64_t bytesLeft(FILE* file) {
+    long here = ftell(file);
+    if (here < 0 || fseek(file, 0, SEEK_END) != 0) return 0;
+    long end = ftell(file);
+    if (fseek(file, here, SEEK_SET) != 0 || end < here) return 0;
+    return (uint64_t)(end - here);
+}
+
+// runCount sizes the run array before any run is read, so besides matching
+// tickCount it has to fit in the rest of the file.
+bool LoadInputRecording(InputRecording* recording, const char* path) {
+    memset(recording, 0, sizeof(*recording));
+
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    char magic[4];
+    uint64_t version, reserved, tickRate, screenWidth, screenHeight;
+    uint64_t blockRows, blockCols, startBalls, maxBalls, runCount, finalScore;
+    bool ok = fread(magic, 1, 4, file) == 4 && memcmp(magic, RECORDING_MAGIC, 4) == 0
+           && getUint(file, &version, 2) && version == RECORDING_VERSION
+           && getUint(file, &reserved, 2)
+           && getUint(file, &recording->seed, 8)
+           && getUint(file, &tickRate, 4)
+           && getUint(file, &screenWidth, 4)
+           && getUint(file, &screenHeight, 4)
+           && getUint(file, &blockRows, 4)
+           && getUint(file, &blockCols, 4)
+           && getUint(file, &startBalls, 4)
+           && getUint(file, &maxBalls, 4)
+           && getUint(file, &recording->tickCount, 8)
+           && getUint(file, &runCount, 4)
+           && runCount <= recording->tickCount
+           && runCount <= INT_MAX
+           && runCount * MIN_RUN_BYTES + TRAILER_BYTES <= bytesLeft(file);
+
+    if (ok) {
+        recording->tickRate = (int)tickRate;
+        recording->screenWidth = (int)screenWidth;
+        recording->screenHeight = (int)screenHeight;
+        recording->blockRows = (int)blockRows;
+        recording->blockCols = (int)blockCols;
+        recording->startBalls = (int)startBalls;
+        recording->maxBalls = (int)maxBalls;
+
+        recording->runs = malloc((runCount ? runCount : 1) * sizeof(InputRun));
+        ok = recording->runs != NULL;
+        if (ok) recording->runCapacity = (int)runCount;
+    }
+
+    uint64_t ticks = 0;
+    for (uint64_t i = 0; ok && i < runCount; i++) {
+        int c = fgetc(file);
+        uint32_t length;
+        ok = c != EOF && getVarint(file, &length) && length > 0;
+        if (ok) {
+            recording->runs[recording->runCount++] = (InputRun){(uint8_t)c, length};
+            ticks += length;
+        }
+    }
+
+    ok = ok && ticks == recording->tickCount
+            && getUint(file, &finalScore, 4)
+            && getUint(file, &recording->finalHash, 8);
+    if (ok) recording->finalScore = (int)(uint32_t)finalScore;
+
+    fclose(file);
+    if (!ok) FreeInputRecording(recording);
+    return ok;
+}
+
+void FreeInputRecording(InputRecording* recording) {
+    free(recording->runs);
+    memset(recording, 0, sizeof(*recording));
+}
+
+void BeginReplay(ReplayCursor* cursor, const InputRecording* recording) {
+    cursor->recording = recording;
+    cursor->run = 0;
+    cursor->offset = 0;
+}
+
+bool NextReplayInput(ReplayCursor* cursor, BlockCrusherInput* input) {
+    const InputRecording* recording = cursor->recording;
+    if (cursor->run >= recording->runCount) return false;
+
+    const InputRun* run = &recording->runs[cursor->run];
+    *input = UnpackBlockCrusherInput(run->input);
+    if (++cursor->offset >= run->length) {
+        cursor->run++;
+        cursor->offset = 0;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#ifndef INPUT_RECORDING_H
+#define INPUT_RECORDING_H
+
+#include "block_crusher.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define INPUT_LEFT    0x01
+#define INPUT_RIGHT   0x02
+#define INPUT_PAUSE   0x04
+#define INPUT_RESTART 0x08
+
+typedef struct {
+    uint8_t input;
+    uint32_t length;
+} InputRun;
+
+// One Block Crusher session: everything needed to re-run it tick for tick
+// (seed, tick rate, screen and layout settings) plus the per-tick input as
+// runs of identical input bits. The final score and state hash let a replay
+// check that it ended up exactly where the original session did.
+typedef struct InputRecording {
+    uint64_t seed;
+    int tickRate;
+    int screenWidth;
+    int screenHeight;
+    int blockRows;
+    int blockCols;
+    int startBalls;
+    int maxBalls;
+    uint64_t tickCount;
+    InputRun* runs;
+    int runCount;
+    int runCapacity;
+    int finalScore;
+    uint64_t finalHash;
+} InputRecording;
+
+typedef struct {
+    const InputRecording* recording;
+    int run;
+    uint32_t offset;
+} ReplayCursor;
+
+uint8_t PackBlockCrusherInput(BlockCrusherInput input);
+BlockCrusherInput UnpackBlockCrusherInput(uint8_t bits);
+
+void RecordInput(InputRecording* recording, BlockCrusherInput input);
+bool SaveInputRecording(const InputRecording* recording, const char* path);
+bool LoadInputRecording(InputRecording* recording, const char* path);
+void FreeInputRecording(InputRecording* recording);
+
+void BeginReplay(ReplayCursor* cursor, const InputRecording* recording);
+bool NextReplayInput(ReplayCursor* cursor, BlockCrusherInput* input);
+
+#endif
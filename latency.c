@@ -0,0 +1,202 @@
+#include "latency.h"
+#include "raylib.h"
+#include <stdio.h>
+#include <string.h>
+
+#define WORK_SMOOTHING 0.1f
+#define SPREAD_MARGIN 3.0f
+#define SAFETY_MARGIN 0.001f    // seconds
+#define MIN_WAIT 0.0005f
+#define HISTOGRAM_BAR 40
+
+#define MAX_HELD_BACK_KEYS 64
+
+// build.sh defines LATENCY_GLFW when libraylib exports GLFW, as raylib's
+// desktop platform does. Polling GLFW directly runs raylib's input
+// callbacks, which update the current key states, but skips PollInputEvents'
+// step of rolling those into the previous states, so IsKeyPressed still
+// reports every press since the frame began. raylib's API has no poll like
+// that, so without GLFW input is only read by EndDrawing's poll: frames are
+// still paced, but the late latches just sample the keys raylib already has.
+#ifdef LATENCY_GLFW
+typedef struct GLFWwindow GLFWwindow;
+typedef void (*GLFWkeyfun)(GLFWwindow* window, int key, int scancode, int action, int mods);
+void glfwPollEvents(void);
+GLFWwindow* glfwGetCurrentContext(void);
+GLFWkeyfun glfwSetKeyCallback(GLFWwindow* window, GLFWkeyfun callback);
+
+typedef struct {
+    int key;
+    int scancode;
+    int action;
+    int mods;
+} HeldBackKey;
+
+static GLFWwindow* keyWindow;
+static GLFWkeyfun raylibKeyCallback;
+static HeldBackKey heldBack[MAX_HELD_BACK_KEYS];
+static int heldBackCount;
+
+// A press seen after the frame has read its input would be rolled into the
+// previous states by EndDrawing's poll without IsKeyPressed ever reporting
+// it, so from the late latch until EndDrawing returns only the paddle keys
+// reach raylib; the rest are replayed, in order, after that poll.
+static void holdBackKey(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (key == KEY_LEFT || key == KEY_RIGHT || heldBackCount == MAX_HELD_BACK_KEYS) {
+        raylibKeyCallback(window, key, scancode, action, mods);
+        return;
+    }
+    heldBack[heldBackCount++] = (HeldBackKey){key, scancode, action, mods};
+}
+
+static void holdBackKeys(void) {
+    if (raylibKeyCallback) return;
+    keyWindow = glfwGetCurrentContext();
+    raylibKeyCallback = glfwSetKeyCallback(keyWindow, holdBackKey);
+}
+
+static void releaseHeldBackKeys(void) {
+    if (!raylibKeyCallback) return;
+    glfwSetKeyCallback(keyWindow, raylibKeyCallback);
+    for (int i = 0; i < heldBackCount; i++) {
+        raylibKeyCallback(keyWindow, heldBack[i].key, heldBack[i].scancode, heldBack[i].action, heldBack[i].mods);
+    }
+    heldBackCount = 0;
+    raylibKeyCallback = NULL;
+}
+
+static void pollLate(void) {
+    glfwPollEvents();
+}
+#else
+static void holdBackKeys(void) {}
+static void releaseHeldBackKeys(void) {}
+static void pollLate(void) {}
+#endif
+
+void AddLatencySample(LatencyHistogram* histogram, float seconds) {
+    int bucket = (int)(seconds * 1000.0f / LATENCY_BUCKET_MS);
+    if (bucket < 0) bucket = 0;
+    if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+    histogram->counts[bucket]++;
+    histogram->samples++;
+    histogram->totalSeconds += seconds;
+    if (seconds > histogram->maxSeconds) histogram->maxSeconds = seconds;
+}
+
+// Milliseconds at the upper edge of the bucket holding the given fraction
+// of samples.
+float LatencyPercentile(const LatencyHistogram* histogram, float fraction) {
+    if (histogram->samples == 0) return 0.0f;
+    uint64_t rank = (uint64_t)(fraction * (histogram->samples - 1)) + 1;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++) {
+        seen += histogram->counts[bucket];
+        if (seen >= rank) return (bucket + 1) * LATENCY_BUCKET_MS;
+    }
+    return histogram->maxSeconds * 1000.0f;
+}
+
+void PrintLatencyHistogram(const LatencyHistogram* histogram) {
+    if (histogram->samples == 0) return;
+
+    printf("input-to-submit latency: %llu paddle input changes, mean %.2f ms, p50 %.1f ms, p90 %.1f ms, "
+           "p99 %.1f ms, max %.2f ms\n",
+           (unsigned long long)histogram->samples, histogram->totalSeconds * 1000.0 / histogram->samples,
+           LatencyPercentile(histogram, 0.5f), LatencyPercentile(histogram, 0.9f),
+           LatencyPercentile(histogram, 0.99f), histogram->maxSeconds * 1000.0f);
+
+    uint32_t most = 0;
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        if (histogram->counts[bucket] > most) most = histogram->counts[bucket];
+    }
+    char bar[HISTOGRAM_BAR + 1];
+    for (int bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+        uint32_t count = histogram->counts[bucket];
+        if (count == 0) continue;
+        int length = (int)((uint64_t)count * HISTOGRAM_BAR / most);
+        if (length == 0) length = 1;
+        memset(bar, '#', length);
+        bar[length] = '\0';
+        if (bucket == LATENCY_BUCKETS - 1) {
+            printf("  %5.1f+     ms %-*s %u\n", bucket * LATENCY_BUCKET_MS, HISTOGRAM_BAR, bar, count);
+        } else {
+            printf("  %5.1f-%5.1f ms %-*s %u\n", bucket * LATENCY_BUCKET_MS, (bucket + 1) * LATENCY_BUCKET_MS,
+                   HISTOGRAM_BAR, bar, count);
+        }
+    }
+}
+
+void InitInputLatency(InputLatency* latency, int targetFPS, bool lowLatency) {
+    memset(latency, 0, sizeof(*latency));
+    latency->budget = targetFPS > 0 ? 1.0f / targetFPS : 0.0f;
+    latency->lowLatency = lowLatency;
+}
+
+static void observeInput(InputLatency* latency, double pollTime) {
+    unsigned held = (IsKeyDown(KEY_LEFT) ? 1u : 0u) | (IsKeyDown(KEY_RIGHT) ? 2u : 0u);
+    if (latency->measuring && held != latency->heldKeys && latency->pendingEvent == 0.0 && latency->lastPoll > 0.0) {
+        latency->pendingEvent = (latency->lastPoll + pollTime) / 2;
+    }
+    latency->heldKeys = held;
+    latency->lastPoll = pollTime;
+}
+
+void WaitForInputLatch(InputLatency* latency, bool measuring) {
+    latency->measuring = measuring;
+    if (!latency->lowLatency) return;
+
+    if (latency->deadline > 0.0) {
+        float predicted = latency->workMean + latency->workSpread * SPREAD_MARGIN + SAFETY_MARGIN;
+        double wait = latency->deadline - predicted - GetTime();
+        if (wait > MIN_WAIT) WaitTime(wait);
+    }
+    pollLate();
+    observeInput(latency, GetTime());
+    latency->workStart = latency->lastPoll;
+}
+
+void LatchInput(InputLatency* latency) {
+    holdBackKeys();
+    pollLate();
+    observeInput(latency, GetTime());
+}
+
+// Call right before EndDrawing.
+void SubmitFrame(InputLatency* latency) {
+    if (latency->pendingEvent == 0.0) return;
+    if (latency->measuring) AddLatencySample(&latency->histogram, (float)(GetTime() - latency->pendingEvent));
+    latency->pendingEvent = 0.0;
+}
+
+// Call right after EndDrawing, which polls input once more on its way out.
+// waited says that poll blocked for events: its changes came in while
+// nothing was being drawn, and the next frame should start right away.
+void EndInputLatencyFrame(InputLatency* latency, bool waited) {
+    double now = GetTime();
+    if (waited) {
+        latency->measuring = false;
+        latency->deadline = now;
+    } else {
+        if (latency->lowLatency && latency->workStart > 0.0) {
+            float work = (float)(now - latency->workStart);
+            latency->workMean += (work - latency->workMean) * WORK_SMOOTHING;
+            float deviation = work > latency->workMean ? work - latency->workMean : latency->workMean - work;
+            latency->workSpread += (deviation - latency->workSpread) * WORK_SMOOTHING;
+        }
+        // Deadlines stay a budget apart, so early frames don't speed the
+        // game up; a late one starts the grid over rather than rushing to
+        // catch up.
+        if (latency->budget > 0.0f) {
+            latency->deadline += latency->budget;
+            if (latency->deadline < now) latency->deadline = now + latency->budget;
+        }
+    }
+    releaseHeldBackKeys();
+    observeInput(latency, now);
+}
+
+void ResetInputLatency(InputLatency* latency) {
+    memset(&latency->histogram, 0, sizeof(latency->histogram));
+    latency->pendingEvent = 0.0;
+}
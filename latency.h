@@ -0,0 +1,61 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Input-to-submit latency in buckets of LATENCY_BUCKET_MS; the last bucket
+// also takes everything slower.
+#define LATENCY_BUCKETS 100
+#define LATENCY_BUCKET_MS 0.5f
+
+typedef struct {
+    uint32_t counts[LATENCY_BUCKETS];
+    uint64_t samples;
+    double totalSeconds;
+    float maxSeconds;
+} LatencyHistogram;
+
+void AddLatencySample(LatencyHistogram* histogram, float seconds);
+float LatencyPercentile(const LatencyHistogram* histogram, float fraction);
+void PrintLatencyHistogram(const LatencyHistogram* histogram);
+
+// Frame pacing and latency tracking around the main loop's frames.
+//
+// Measurement: after every input poll the paddle keys are compared with the
+// last poll; a change is taken to have happened halfway between the two
+// polls (raylib doesn't timestamp events) and is recorded at the next
+// SubmitFrame, so the histogram covers waiting to be polled, simulating,
+// drawing and any sleep in between.
+//
+// Low-latency mode replaces raylib's frame limiter (the caller sets
+// SetTargetFPS(0)): WaitForInputLatch sleeps until the latest start that
+// still meets the frame deadline, predicted from recent work times, and only
+// then latches input, so the frame is simulated from input that is
+// milliseconds old instead of up to a frame old.
+typedef struct {
+    float budget;           // seconds per frame, 0 when uncapped
+    bool lowLatency;
+    bool measuring;
+    double deadline;        // when the frame being built is due, on a grid of budget
+    double workStart;
+    float workMean;
+    float workSpread;       // mean absolute deviation
+
+    double lastPoll;
+    unsigned heldKeys;
+    double pendingEvent;    // estimated time of the oldest unsubmitted change, 0 if none
+    LatencyHistogram histogram;
+} InputLatency;
+
+void InitInputLatency(InputLatency* latency, int targetFPS, bool lowLatency);
+// measuring turns recording on for this frame and the polls around it.
+void WaitForInputLatch(InputLatency* latency, bool measuring);
+// Polls again late in the frame, for the paddle; other keys pressed from
+// here on count from the next frame.
+void LatchInput(InputLatency* latency);
+void SubmitFrame(InputLatency* latency);
+void EndInputLatencyFrame(InputLatency* latency, bool waited);
+void ResetInputLatency(InputLatency* latency);
+
+#endif
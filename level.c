@@ -0,0 +1,238 @@
+#include "level.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Payload is consumed this many bytes at a time: the next chunk is
+// prefetched with MADV_WILLNEED and finished ones are dropped with
+// MADV_DONTNEED, so a huge level never has to be resident all at once.
+#define LEVEL_CHUNK_BYTES (1 << 20)
+
+// Positions and sizes beyond this are rejected, which keeps the block grid's
+// cell arithmetic in range.
+#define LEVEL_MAX_COORD 100000.0f
+
+_Static_assert(sizeof(LevelHeader) == 72, "LevelHeader layout changed");
+_Static_assert(sizeof(LevelBlock) == 20, "LevelBlock layout changed");
+
+static bool inRange(float value) {
+    return isfinite(value) && fabsf(value) <= LEVEL_MAX_COORD;
+}
+
+static bool validSize(float value) {
+    return inRange(value) && value > 0;
+}
+
+// Every float in the header is finite and in range; grid geometry must also
+// have positive block sizes. List blocks are checked as they are read.
+static bool validGeometry(const LevelHeader* h) {
+    bool finite = inRange(h->originX) && inRange(h->originY) && inRange(h->blockWidth) && inRange(h->blockHeight)
+               && inRange(h->spacingX) && inRange(h->spacingY) && inRange(h->ballSpeed) && inRange(h->ballRadius)
+               && inRange(h->paddleWidth) && inRange(h->paddleSpeed);
+    if (!finite || h->layout == LEVEL_LIST) return finite;
+    return validSize(h->blockWidth) && validSize(h->blockHeight) && h->spacingX >= 0 && h->spacingY >= 0;
+}
+
+static uint64_t payloadSize(const LevelHeader* header) {
+    if (header->layout == LEVEL_GRID) return 2ULL * header->rows * header->cols;
+    return (uint64_t)header->blockCount * sizeof(LevelBlock);
+}
+
+bool OpenLevel(LevelFile* level, const char* path) {
+    memset(level, 0, sizeof(*level));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(LevelHeader)) {
+        close(fd);
+        return false;
+    }
+
+    size_t size = (size_t)info.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const LevelHeader* header = map;
+    uint64_t blocks = header->layout == LEVEL_GRID ? (uint64_t)header->rows * header->cols : header->blockCount;
+    bool valid = memcmp(header->magic, LEVEL_MAGIC, 4) == 0
+              && header->version == LEVEL_VERSION
+              && (header->layout == LEVEL_GRID || header->layout == LEVEL_LIST)
+              && blocks <= 0x7FFFFFFF
+              && validGeometry(header)
+              && header->dataOffset >= sizeof(LevelHeader)
+              && header->dataOffset % 8 == 0
+              && header->dataOffset <= size
+              && payloadSize(header) <= size - header->dataOffset;
+    if (!valid) {
+        munmap(map, size);
+        return false;
+    }
+
+    madvise(map, size, MADV_SEQUENTIAL);
+    level->header = header;
+    level->data = (const uint8_t*)map + header->dataOffset;
+    level->map = map;
+    level->mapSize = size;
+    return true;
+}
+
+void CloseLevel(LevelFile* level) {
+    if (level->map) munmap(level->map, level->mapSize);
+    memset(level, 0, sizeof(*level));
+}
+
+static void adviseRange(const LevelFile* level, const void* start, size_t size, int advice) {
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t mapEnd = (uintptr_t)level->map + level->mapSize;
+    uintptr_t begin = (uintptr_t)start;
+    uintptr_t end = begin + size;
+    if (end > mapEnd) end = mapEnd;
+
+    if (advice == MADV_DONTNEED) {
+        // Only drop pages that lie entirely inside the finished range.
+        begin = (begin + page - 1) & ~(page - 1);
+        end &= ~(page - 1);
+    } else {
+        begin &= ~(page - 1);
+        end = (end + page - 1) & ~(page - 1);
+        if (end > mapEnd) end = mapEnd;
+    }
+    if (end > begin) madvise((void*)begin, end - begin, advice);
+}
+
+static void buildGridLevel(const LevelFile* level, BlockField* field) {
+    const LevelHeader* h = level->header;
+    int count = (int)(h->rows * h->cols);
+    const uint8_t* types = level->data;
+    const uint8_t* hp = level->data + count;
+
+    InitBlockBoard(field, (int)h->rows, (int)h->cols,
+                   (Rectangle){h->originX, h->originY, h->blockWidth, h->blockHeight}, h->spacingX, h->spacingY);
+    ReserveBlockAttributes(field);
+
+    for (int start = 0; start < count; start += LEVEL_CHUNK_BYTES) {
+        int n = count - start < LEVEL_CHUNK_BYTES ? count - start : LEVEL_CHUNK_BYTES;
+        adviseRange(level, types + start + n, LEVEL_CHUNK_BYTES, MADV_WILLNEED);
+        adviseRange(level, hp + start + n, LEVEL_CHUNK_BYTES, MADV_WILLNEED);
+
+        memcpy(field->types + start, types + start, n);
+        memcpy(field->hp + start, hp + start, n);
+        for (int i = start; i < start + n; i++) {
+            if (field->hp[i] == 0) RemoveBlock(field, i);
+        }
+
+        adviseRange(level, types + start, n, MADV_DONTNEED);
+        adviseRange(level, hp + start, n, MADV_DONTNEED);
+    }
+}
+
+static bool buildListLevel(const LevelFile* level, BlockField* field) {
+    int count = (int)level->header->blockCount;
+    const LevelBlock* source = (const LevelBlock*)level->data;
+    int chunk = LEVEL_CHUNK_BYTES / sizeof(LevelBlock);
+
+    Block* blocks = BeginBlockList(field, count);
+    ReserveBlockAttributes(field);
+
+    for (int start = 0; start < count; start += chunk) {
+        int end = count - start < chunk ? count : start + chunk;
+        adviseRange(level, source + end, LEVEL_CHUNK_BYTES, MADV_WILLNEED);
+
+        for (int i = start; i < end; i++) {
+            const LevelBlock* b = &source[i];
+            if (!inRange(b->x) || !inRange(b->y) || !validSize(b->width) || !validSize(b->height)) return false;
+            blocks[i].rect = (Rectangle){b->x, b->y, b->width, b->height};
+            blocks[i].active = b->hp > 0;
+            field->types[i] = b->type;
+            field->hp[i] = b->hp;
+        }
+
+        adviseRange(level, source + start, (end - start) * sizeof(LevelBlock), MADV_DONTNEED);
+    }
+
+    FinishBlockList(field);
+    return true;
+}
+
+// Fills field from an open level; false if a list block is out of range or
+// no block is live (the level could never be cleared), leaving the field
+// unusable until it is built again. Reuses the field's buffers, so switching
+// levels does not allocate unless the new level is bigger than any before it.
+bool BuildLevelField(const LevelFile* level, BlockField* field) {
+    if (level->header->layout == LEVEL_GRID) {
+        buildGridLevel(level, field);
+    } else if (!buildListLevel(level, field)) {
+        return false;
+    }
+    return field->alive > 0;
+}
+
+bool SaveLevel(const char* path, const LevelHeader* header, const void* data, size_t dataSize) {
+    LevelHeader out = *header;
+    memcpy(out.magic, LEVEL_MAGIC, 4);
+    out.version = LEVEL_VERSION;
+    out.dataOffset = sizeof(LevelHeader);
+    if (payloadSize(&out) != dataSize) return false;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+
+    bool ok = fwrite(&out, sizeof(out), 1, file) == 1
+           && (dataSize == 0 || fwrite(data, dataSize, 1, file) == 1);
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+static int comparePaths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// Lists *.lvl files by name only; nothing is opened or stat'ed, so listing a
+// campaign costs one directory scan however many levels it has.
+bool ListLevels(LevelSet* set, const char* directory) {
+    set->paths = NULL;
+    set->count = 0;
+
+    DIR* dir = opendir(directory);
+    if (!dir) return false;
+
+    int capacity = 0;
+    size_t extensionLength = strlen(LEVEL_EXTENSION);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length <= extensionLength) continue;
+        if (strcmp(entry->d_name + length - extensionLength, LEVEL_EXTENSION) != 0) continue;
+
+        if (set->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            set->paths = realloc(set->paths, capacity * sizeof(char*));
+        }
+        size_t size = strlen(directory) + length + 2;
+        char* path = malloc(size);
+        snprintf(path, size, "%s/%s", directory, entry->d_name);
+        set->paths[set->count++] = path;
+    }
+    closedir(dir);
+
+    qsort(set->paths, set->count, sizeof(char*), comparePaths);
+    return true;
+}
+
+void FreeLevelSet(LevelSet* set) {
+    for (int i = 0; i < set->count; i++) {
+        free(set->paths[i]);
+    }
+    free(set->paths);
+    set->paths = NULL;
+    set->count = 0;
+}
@@ -0,0 +1,82 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "block_field.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LEVEL_MAGIC "BCLV"
+#define LEVEL_VERSION 1
+#define LEVEL_EXTENSION ".lvl"
+
+typedef enum {
+    LEVEL_GRID = 0,
+    LEVEL_LIST = 1
+} LevelLayout;
+
+typedef enum {
+    BLOCK_NORMAL = 0,
+    BLOCK_HARD,
+    BLOCK_POWERUP,
+    BLOCK_TYPE_COUNT
+} BlockType;
+
+// On-disk header, little-endian, read in place from the mapping. Geometry and
+// speeds are in Block Crusher's logical 800x600 space, used as is; zero
+// speeds/sizes mean "use the game default".
+//
+// LEVEL_GRID payload: uint8 type[rows*cols], then uint8 hp[rows*cols]
+//                     (hp 0 = empty cell).
+// LEVEL_LIST payload: LevelBlock[blockCount].
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t layout;
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t blockCount;
+    float originX;
+    float originY;
+    float blockWidth;
+    float blockHeight;
+    float spacingX;
+    float spacingY;
+    float ballSpeed;
+    float ballRadius;
+    float paddleWidth;
+    float paddleSpeed;
+    uint32_t startBalls;
+    uint64_t dataOffset;
+} LevelHeader;
+
+typedef struct {
+    float x;
+    float y;
+    float width;
+    float height;
+    uint8_t type;
+    uint8_t hp;
+    uint16_t reserved;
+} LevelBlock;
+
+typedef struct {
+    const LevelHeader* header;
+    const uint8_t* data;
+    void* map;
+    size_t mapSize;
+} LevelFile;
+
+typedef struct LevelSet {
+    char** paths;
+    int count;
+} LevelSet;
+
+bool OpenLevel(LevelFile* level, const char* path);
+void CloseLevel(LevelFile* level);
+bool BuildLevelField(const LevelFile* level, BlockField* field);
+bool SaveLevel(const char* path, const LevelHeader* header, const void* data, size_t dataSize);
+bool ListLevels(LevelSet* set, const char* directory);
+void FreeLevelSet(LevelSet* set);
+
+#endif
@@ -1,7 +1,27 @@
 #include "game_manager.h"
 
-int main(void) {
+int main(int argc, char** argv) {
     GameManager gameManager;
+    ParseGameManagerArgs(&gameManager, argc, argv);
+    
+    if (gameManager.exportLevelPath) {
+        return ExportLevel(&gameManager);
+    }
+    
+    if (gameManager.replayPath) {
+        return RunReplay(&gameManager);
+    }
+    
+    if (gameManager.batchGames > 0) {
+        RunBatch(&gameManager);
+        return 0;
+    }
+    
+    if (gameManager.headless) {
+        RunHeadless(&gameManager);
+        return 0;
+    }
+    
     InitGameManager(&gameManager);
     RunGameManager(&gameManager);
     CloseGameManager(&gameManager);
@@ -0,0 +1,213 @@
+#include "particles.h"
+#include "ball_store.h"
+#include "game_util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PARTICLE_KERNELS_X86 1
+#endif
+
+#define PARTICLE_GRAVITY 360.0f
+#define PARTICLE_DRAG 2.0f
+#define PI 3.14159265f
+
+typedef struct {
+    int count;
+    float speed;        // pixels per second, randomised down to half
+    float lifetime;     // seconds, randomised by +-25%
+    float size;         // starting radius; particles shrink to half
+    float direction;    // centre of the spread, radians
+    float arc;          // width of the spread, radians
+} BurstStyle;
+
+static const BurstStyle burstStyles[BURST_KIND_COUNT] = {
+    [BURST_BLOCK_HIT] = {6, 140.0f, 0.35f, 2.0f, 0.0f, 2 * PI},
+    [BURST_BLOCK_DESTROYED] = {24, 220.0f, 0.7f, 3.0f, 0.0f, 2 * PI},
+    [BURST_PADDLE] = {10, 200.0f, 0.4f, 2.0f, -PI / 2, PI},
+    [BURST_POWERUP] = {40, 260.0f, 0.9f, 3.0f, 0.0f, 2 * PI},
+};
+
+void InitParticles(ParticleSystem* p, int capacity) {
+    memset(p, 0, sizeof(*p));
+    p->x = malloc(capacity * sizeof(float));
+    p->y = malloc(capacity * sizeof(float));
+    p->vx = malloc(capacity * sizeof(float));
+    p->vy = malloc(capacity * sizeof(float));
+    p->life = malloc(capacity * sizeof(float));
+    p->fade = malloc(capacity * sizeof(float));
+    p->size = malloc(capacity * sizeof(float));
+    p->color = malloc(capacity * sizeof(Color));
+    p->capacity = capacity;
+    p->rngState = 0x2545F4914F6CDD1DULL;
+}
+
+void FreeParticles(ParticleSystem* p) {
+    free(p->x);
+    free(p->y);
+    free(p->vx);
+    free(p->vy);
+    free(p->life);
+    free(p->fade);
+    free(p->size);
+    free(p->color);
+    memset(p, 0, sizeof(*p));
+}
+
+// On the pool's own state, so sparks never touch the game's stream.
+static float randomUnit(ParticleSystem* p) {
+    return (float)(SplitMix64(&p->rngState) >> 40) * (1.0f / (1 << 24));
+}
+
+void EmitParticleBurst(ParticleSystem* p, const ParticleBurst* burst) {
+    const BurstStyle* style = &burstStyles[burst->kind];
+    int count = style->count;
+    if (count > p->capacity - p->count) count = p->capacity - p->count;
+
+    for (int k = 0; k < count; k++) {
+        int i = p->count++;
+        float angle = style->direction + (randomUnit(p) - 0.5f) * style->arc;
+        float speed = style->speed * (0.5f + 0.5f * randomUnit(p));
+        float lifetime = style->lifetime * (0.75f + 0.5f * randomUnit(p));
+
+        p->x[i] = burst->position.x;
+        p->y[i] = burst->position.y;
+        p->vx[i] = cosf(angle) * speed;
+        p->vy[i] = sinf(angle) * speed;
+        p->life[i] = lifetime;
+        p->fade[i] = 1.0f / lifetime;
+        p->size[i] = style->size;
+        p->color[i] = burst->color;
+    }
+}
+
+static int integrateScalar(ParticleSystem* p, int start, float dt, float damp, float fall) {
+    int dead = 0;
+    for (int i = start; i < p->count; i++) {
+        p->x[i] += p->vx[i] * dt;
+        p->y[i] += p->vy[i] * dt;
+        p->vx[i] *= damp;
+        p->vy[i] = p->vy[i] * damp + fall;
+        p->life[i] -= dt;
+        dead += p->life[i] <= 0.0f;
+    }
+    return dead;
+}
+
+#ifdef PARTICLE_KERNELS_X86
+static int integrateSSE(ParticleSystem* p, float dt, float damp, float fall) {
+    __m128 vdt = _mm_set1_ps(dt);
+    __m128 vdamp = _mm_set1_ps(damp);
+    __m128 vfall = _mm_set1_ps(fall);
+    __m128 zero = _mm_setzero_ps();
+    int dead = 0;
+    int i = 0;
+
+    for (; i + 4 <= p->count; i += 4) {
+        __m128 vx = _mm_loadu_ps(p->vx + i);
+        __m128 vy = _mm_loadu_ps(p->vy + i);
+        __m128 life = _mm_sub_ps(_mm_loadu_ps(p->life + i), vdt);
+
+        _mm_storeu_ps(p->x + i, _mm_add_ps(_mm_loadu_ps(p->x + i), _mm_mul_ps(vx, vdt)));
+        _mm_storeu_ps(p->y + i, _mm_add_ps(_mm_loadu_ps(p->y + i), _mm_mul_ps(vy, vdt)));
+        _mm_storeu_ps(p->vx + i, _mm_mul_ps(vx, vdamp));
+        _mm_storeu_ps(p->vy + i, _mm_add_ps(_mm_mul_ps(vy, vdamp), vfall));
+        _mm_storeu_ps(p->life + i, life);
+
+        dead += __builtin_popcount(_mm_movemask_ps(_mm_cmple_ps(life, zero)));
+    }
+    return dead + integrateScalar(p, i, dt, damp, fall);
+}
+
+__attribute__((target("avx")))
+static int integrateAVX(ParticleSystem* p, float dt, float damp, float fall) {
+    __m256 vdt = _mm256_set1_ps(dt);
+    __m256 vdamp = _mm256_set1_ps(damp);
+    __m256 vfall = _mm256_set1_ps(fall);
+    __m256 zero = _mm256_setzero_ps();
+    int dead = 0;
+    int i = 0;
+
+    for (; i + 8 <= p->count; i += 8) {
+        __m256 vx = _mm256_loadu_ps(p->vx + i);
+        __m256 vy = _mm256_loadu_ps(p->vy + i);
+        __m256 life = _mm256_sub_ps(_mm256_loadu_ps(p->life + i), vdt);
+
+        _mm256_storeu_ps(p->x + i, _mm256_add_ps(_mm256_loadu_ps(p->x + i), _mm256_mul_ps(vx, vdt)));
+        _mm256_storeu_ps(p->y + i, _mm256_add_ps(_mm256_loadu_ps(p->y + i), _mm256_mul_ps(vy, vdt)));
+        _mm256_storeu_ps(p->vx + i, _mm256_mul_ps(vx, vdamp));
+        _mm256_storeu_ps(p->vy + i, _mm256_add_ps(_mm256_mul_ps(vy, vdamp), vfall));
+        _mm256_storeu_ps(p->life + i, life);
+
+        dead += __builtin_popcount(_mm256_movemask_ps(_mm256_cmp_ps(life, zero, _CMP_LE_OQ)));
+    }
+    // See integrateAVX in ball_store.c.
+    _mm256_zeroupper();
+    return dead + integrateScalar(p, i, dt, damp, fall);
+}
+#endif
+
+static void moveParticle(ParticleSystem* p, int to, int from) {
+    p->x[to] = p->x[from];
+    p->y[to] = p->y[from];
+    p->vx[to] = p->vx[from];
+    p->vy[to] = p->vy[from];
+    p->life[to] = p->life[from];
+    p->fade[to] = p->fade[from];
+    p->size[to] = p->size[from];
+    p->color[to] = p->color[from];
+}
+
+// The kernels count the particles that expired, so compaction runs only on
+// frames where some did and stops at the last one.
+void UpdateParticles(ParticleSystem* p, float dt) {
+    if (p->count == 0) return;
+
+    float damp = 1.0f - PARTICLE_DRAG * dt;
+    if (damp < 0.0f) damp = 0.0f;
+    float fall = PARTICLE_GRAVITY * dt;
+
+    int dead;
+    switch (SelectSimdKernel()) {
+#ifdef PARTICLE_KERNELS_X86
+        case SIMD_KERNEL_AVX:
+            dead = integrateAVX(p, dt, damp, fall);
+            break;
+        case SIMD_KERNEL_SSE:
+            dead = integrateSSE(p, dt, damp, fall);
+            break;
+#endif
+        default:
+            dead = integrateScalar(p, 0, dt, damp, fall);
+            break;
+    }
+
+    for (int i = 0; dead > 0 && i < p->count; ) {
+        if (p->life[i] > 0.0f) {
+            i++;
+            continue;
+        }
+        int last = --p->count;
+        if (i != last) moveParticle(p, i, last);
+        dead--;
+    }
+}
+
+// Writes one sprite per particle straight into the batch; they fade out and
+// shrink to half size over their lifetime.
+void AddParticleSprites(GlowBatch* batch, const ParticleSystem* p) {
+    ReserveGlowSprites(batch, p->count);
+    GlowSprite* sprites = batch->sprites + batch->count;
+
+    for (int i = 0; i < p->count; i++) {
+        float t = p->life[i] * p->fade[i];
+        Color color = p->color[i];
+        color.a = (unsigned char)(color.a * t);
+        sprites[i].position = (Vector2){p->x[i], p->y[i]};
+        sprites[i].radius = p->size[i] * (0.5f + 0.5f * t);
+        sprites[i].color = color;
+    }
+    batch->count += p->count;
+}
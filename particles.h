@@ -0,0 +1,51 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "raylib.h"
+#include "glow_batch.h"
+#include <stdint.h>
+
+#define MAX_PARTICLES (1 << 17)
+
+typedef enum {
+    BURST_BLOCK_HIT = 0,
+    BURST_BLOCK_DESTROYED,
+    BURST_PADDLE,
+    BURST_POWERUP,
+    BURST_KIND_COUNT
+} BurstKind;
+
+// A request for a burst of particles, queued by the simulation and turned
+// into particles by whoever draws it.
+typedef struct {
+    Vector2 position;
+    Color color;
+    uint8_t kind;
+} ParticleBurst;
+
+// Fixed-capacity structure-of-arrays pool of short-lived sparks, live ones
+// dense in [0, count). Emitting into a full pool drops the excess. Particles
+// are presentation only: they advance by frame time, draw through a
+// GlowBatch and take their randomness from their own generator, never the
+// game's.
+typedef struct {
+    float* x;
+    float* y;
+    float* vx;
+    float* vy;
+    float* life;    // seconds left
+    float* fade;    // 1 / lifetime, so life * fade runs from 1 to 0
+    float* size;
+    Color* color;
+    int count;
+    int capacity;
+    uint64_t rngState;
+} ParticleSystem;
+
+void InitParticles(ParticleSystem* particles, int capacity);
+void EmitParticleBurst(ParticleSystem* particles, const ParticleBurst* burst);
+void UpdateParticles(ParticleSystem* particles, float dt);
+void AddParticleSprites(GlowBatch* batch, const ParticleSystem* particles);
+void FreeParticles(ParticleSystem* particles);
+
+#endif
@@ -0,0 +1,51 @@
+#include "presentation.h"
+
+Rectangle LetterboxRect(int width, int height, int windowWidth, int windowHeight) {
+    float scaleX = windowWidth / (float)width;
+    float scaleY = windowHeight / (float)height;
+    float scale = scaleX < scaleY ? scaleX : scaleY;
+
+    float drawWidth = width * scale;
+    float drawHeight = height * scale;
+    return (Rectangle){(windowWidth - drawWidth) / 2, (windowHeight - drawHeight) / 2, drawWidth, drawHeight};
+}
+
+void BeginPresentation(Presentation* presentation, int width, int height) {
+    BeginScaledPresentation(presentation, width, height, 1.0f);
+}
+
+void BeginScaledPresentation(Presentation* presentation, int width, int height, float scale) {
+    RenderTexture2D* target = &presentation->target;
+    presentation->scaled = scale != 1.0f;
+    if (presentation->scaled) {
+        width = (int)(width * scale);
+        height = (int)(height * scale);
+    }
+    if (target->id == 0 || target->texture.width != width || target->texture.height != height) {
+        if (target->id != 0) UnloadRenderTexture(*target);
+        *target = LoadRenderTexture(width, height);
+        SetTextureFilter(target->texture, TEXTURE_FILTER_BILINEAR);
+    }
+    BeginTextureMode(*target);
+    if (presentation->scaled) BeginMode2D((Camera2D){.zoom = scale});
+}
+
+void EndPresentation(Presentation* presentation, int windowWidth, int windowHeight) {
+    if (presentation->scaled) EndMode2D();
+    EndTextureMode();
+    DrawPresentation(presentation, windowWidth, windowHeight);
+}
+
+void DrawPresentation(const Presentation* presentation, int windowWidth, int windowHeight) {
+    Texture2D texture = presentation->target.texture;
+    ClearBackground(BLACK);
+    DrawTexturePro(texture, (Rectangle){0, 0, texture.width, -texture.height},
+                   LetterboxRect(texture.width, texture.height, windowWidth, windowHeight),
+                   (Vector2){0, 0}, 0.0f, WHITE);
+}
+
+void UnloadPresentation(Presentation* presentation) {
+    if (presentation->target.id != 0) UnloadRenderTexture(presentation->target);
+    presentation->target = (RenderTexture2D){0};
+    presentation->scaled = false;
+}
@@ -0,0 +1,26 @@
+#ifndef PRESENTATION_H
+#define PRESENTATION_H
+
+#include "raylib.h"
+
+// A game draws into a fixed logical-size render target; presenting scales it
+// into the window with letterboxing. Resizing the window only changes that
+// final blit, never the game's coordinates. Both calls go inside the
+// caller's BeginDrawing/EndDrawing, which leaves room to draw window-space
+// overlays after the blit. A scaled presentation renders into a target of
+// scale times the logical size, still in logical coordinates, and stretches
+// that over the same letterbox. DrawPresentation blits the target again
+// without redrawing it, for a screen that hasn't changed.
+typedef struct {
+    RenderTexture2D target;
+    bool scaled;
+} Presentation;
+
+void BeginPresentation(Presentation* presentation, int width, int height);
+void BeginScaledPresentation(Presentation* presentation, int width, int height, float scale);
+void EndPresentation(Presentation* presentation, int windowWidth, int windowHeight);
+void DrawPresentation(const Presentation* presentation, int windowWidth, int windowHeight);
+void UnloadPresentation(Presentation* presentation);
+Rectangle LetterboxRect(int width, int height, int windowWidth, int windowHeight);
+
+#endif
@@ -0,0 +1,166 @@
+#include "profiler.h"
+#include "raylib.h"
+#include "game_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The overlay re-sorts the history this often rather than every frame.
+#define PROFILE_STATS_INTERVAL 30
+
+static const char* phaseNames[PROFILE_PHASE_COUNT] = {
+    "frame", "update", "input", "paddle", "balls", "collision", "powerups",
+    "draw", "block_layer", "particles", "sprites", "hud", "blit", "present"
+};
+
+const char* ProfilePhaseName(ProfilePhase phase) {
+    return phaseNames[phase];
+}
+
+#ifndef NO_PROFILER
+
+_Thread_local bool profilerActive = false;
+
+static const int phaseDepth[PROFILE_PHASE_COUNT] = {
+    0, 1, 2, 2, 2, 2, 2, 1, 2, 2, 2, 2, 2, 1
+};
+
+static struct {
+    double current[PROFILE_PHASE_COUNT];
+    float history[PROFILE_HISTORY][PROFILE_PHASE_COUNT];
+    long frameCount;
+    double frameStart;
+    PhaseStats stats[PROFILE_PHASE_COUNT];
+    long statsFrame;
+    bool overlay;
+} profiler;
+
+double ProfilerNow(void) {
+    return MonotonicSeconds();
+}
+
+// Phases that run once per tick accumulate, so a frame that catches up on
+// several ticks reports their total.
+void AddProfileSample(ProfilePhase phase, double seconds) {
+    profiler.current[phase] += seconds;
+}
+
+void BeginProfilerFrame(void) {
+    profilerActive = true;
+    memset(profiler.current, 0, sizeof(profiler.current));
+    profiler.frameStart = ProfilerNow();
+}
+
+void EndProfilerFrame(void) {
+    if (!profilerActive) return;
+    profiler.current[PROFILE_FRAME] = ProfilerNow() - profiler.frameStart;
+
+    float* row = profiler.history[profiler.frameCount % PROFILE_HISTORY];
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        row[p] = (float)(profiler.current[p] * 1000.0);
+    }
+    profiler.frameCount++;
+}
+
+static int compareFloats(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+static int historyCount(void) {
+    return profiler.frameCount < PROFILE_HISTORY ? (int)profiler.frameCount : PROFILE_HISTORY;
+}
+
+// Nearest-rank percentiles over the frames in the ring.
+bool GetProfilePhaseStats(ProfilePhase phase, PhaseStats* stats) {
+    int count = historyCount();
+    if (count == 0) return false;
+
+    float sorted[PROFILE_HISTORY];
+    for (int i = 0; i < count; i++) {
+        sorted[i] = profiler.history[i][phase];
+    }
+    qsort(sorted, count, sizeof(float), compareFloats);
+
+    stats->p50 = sorted[(count * 50 + 99) / 100 - 1];
+    stats->p99 = sorted[(count * 99 + 99) / 100 - 1];
+    stats->max = sorted[count - 1];
+    return true;
+}
+
+// One row per frame in the history, oldest first, times in milliseconds.
+bool ExportProfilerCSV(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    fprintf(file, "frame");
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        fprintf(file, ",%s_ms", phaseNames[p]);
+    }
+    fprintf(file, "\n");
+
+    int count = historyCount();
+    for (long frame = profiler.frameCount - count; frame < profiler.frameCount; frame++) {
+        const float* row = profiler.history[frame % PROFILE_HISTORY];
+        fprintf(file, "%ld", frame);
+        for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+            fprintf(file, ",%.4f", row[p]);
+        }
+        fprintf(file, "\n");
+    }
+    return fclose(file) == 0;
+}
+
+void ToggleProfilerOverlay(void) {
+    profiler.overlay = !profiler.overlay;
+    profiler.statsFrame = -PROFILE_STATS_INTERVAL;
+}
+
+bool IsProfilerOverlayVisible(void) {
+    return profiler.overlay;
+}
+
+void DrawProfilerOverlay(int x, int y) {
+    if (!profiler.overlay) return;
+
+    if (profiler.frameCount - profiler.statsFrame >= PROFILE_STATS_INTERVAL) {
+        for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+            if (!GetProfilePhaseStats(p, &profiler.stats[p])) profiler.stats[p] = (PhaseStats){0};
+        }
+        profiler.statsFrame = profiler.frameCount;
+    }
+
+    int fontSize = 10;
+    int lineHeight = 12;
+    DrawRectangle(x, y, 290, (PROFILE_PHASE_COUNT + 2) * lineHeight + 8, Fade(BLACK, 0.75f));
+
+    int row = y + 4;
+    DrawText(TextFormat("last %d frames, ms", historyCount()), x + 6, row, fontSize, GRAY);
+    row += lineHeight;
+    DrawText("p50", x + 136, row, fontSize, GRAY);
+    DrawText("p99", x + 186, row, fontSize, GRAY);
+    DrawText("max", x + 236, row, fontSize, GRAY);
+    row += lineHeight;
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        Color color = phaseDepth[p] == 0 ? YELLOW : phaseDepth[p] == 1 ? WHITE : LIGHTGRAY;
+        DrawText(phaseNames[p], x + 6 + phaseDepth[p] * 10, row, fontSize, color);
+        DrawText(TextFormat("%6.2f", profiler.stats[p].p50), x + 130, row, fontSize, color);
+        DrawText(TextFormat("%6.2f", profiler.stats[p].p99), x + 180, row, fontSize, color);
+        DrawText(TextFormat("%6.2f", profiler.stats[p].max), x + 230, row, fontSize, color);
+        row += lineHeight;
+    }
+}
+
+#else
+
+void BeginProfilerFrame(void) {}
+void EndProfilerFrame(void) {}
+bool GetProfilePhaseStats(ProfilePhase phase, PhaseStats* stats) { return false; }
+bool ExportProfilerCSV(const char* path) { return false; }
+void ToggleProfilerOverlay(void) {}
+bool IsProfilerOverlayVisible(void) { return false; }
+void DrawProfilerOverlay(int x, int y) {}
+
+#endif
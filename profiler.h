@@ -0,0 +1,65 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+// Frames kept for the overlay percentiles and the CSV export.
+#define PROFILE_HISTORY 600
+
+// Phases nest: UPDATE covers INPUT..POWERUPS and DRAW covers
+// BLOCK_LAYER..BLIT; FRAME covers everything including PRESENT.
+typedef enum {
+    PROFILE_FRAME = 0,
+    PROFILE_UPDATE,
+    PROFILE_INPUT,
+    PROFILE_PADDLE,
+    PROFILE_BALLS,
+    PROFILE_COLLISION,
+    PROFILE_POWERUPS,
+    PROFILE_DRAW,
+    PROFILE_BLOCK_LAYER,
+    PROFILE_PARTICLES,
+    PROFILE_SPRITES,
+    PROFILE_HUD,
+    PROFILE_BLIT,
+    PROFILE_PRESENT,
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+// Milliseconds over the frames currently in the history.
+typedef struct {
+    float p50;
+    float p99;
+    float max;
+} PhaseStats;
+
+// Timers only record between the first BeginProfilerFrame and process exit,
+// on the thread that drives the frames (the flag is thread-local, so a
+// --threaded simulation thread does not record); headless and batch runs
+// never start a frame, so their simulation steps pay one predictable branch
+// per timer.
+// Building with -DNO_PROFILER removes the timers altogether and turns the
+// functions below into no-ops.
+#ifndef NO_PROFILER
+extern _Thread_local bool profilerActive;
+double ProfilerNow(void);
+void AddProfileSample(ProfilePhase phase, double seconds);
+
+#define PROFILE_BEGIN(phase) double profileStart_##phase = profilerActive ? ProfilerNow() : 0.0
+#define PROFILE_END(phase) \
+    do { if (profilerActive) AddProfileSample(phase, ProfilerNow() - profileStart_##phase); } while (0)
+#else
+#define PROFILE_BEGIN(phase) ((void)0)
+#define PROFILE_END(phase) ((void)0)
+#endif
+
+void BeginProfilerFrame(void);
+void EndProfilerFrame(void);
+bool GetProfilePhaseStats(ProfilePhase phase, PhaseStats* stats);
+const char* ProfilePhaseName(ProfilePhase phase);
+bool ExportProfilerCSV(const char* path);
+void ToggleProfilerOverlay(void);
+bool IsProfilerOverlayVisible(void);
+void DrawProfilerOverlay(int x, int y);
+
+#endif
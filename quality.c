@@ -0,0 +1,143 @@
+#include "quality.h"
+#include "ball_store.h"
+#include "raylib.h"
+
+#define DEFAULT_BUDGET_FPS 60
+#define OVER_WORK 0.9f          // of the budget
+#define OVER_INTERVAL 1.25f
+#define HEADROOM_WORK 0.5f
+#define CALM_WINDOWS 4
+#define MAX_CALM_WINDOWS 64
+#define WORK_SMOOTHING 0.05f
+
+// MSAA only ever applied to the final blit, since every game draws into a
+// render target, so the last step shrinks that target instead.
+static const QualitySettings qualityLevels[QUALITY_LEVELS] = {
+    {BALL_TRAIL_LENGTH, true, true, 8, 1.0f},
+    {BALL_TRAIL_LENGTH / 2, false, true, 8, 1.0f},
+    {BALL_TRAIL_LENGTH / 4, false, false, 8, 1.0f},
+    {BALL_TRAIL_LENGTH / 4, false, false, 4, 1.0f},
+    {BALL_TRAIL_LENGTH / 4, false, false, 4, 0.5f},
+};
+
+static const char* stepNames[QUALITY_LEVELS] = {
+    "full",
+    "shorter trails",
+    "fewer glow layers",
+    "fewer corner segments",
+    "half resolution",
+};
+
+static int clampLevel(int level) {
+    return level < 0 ? 0 : level >= QUALITY_LEVELS ? QUALITY_LEVELS - 1 : level;
+}
+
+QualitySettings GetQualitySettings(int level) {
+    return qualityLevels[clampLevel(level)];
+}
+
+const char* QualityStepName(int level) {
+    return stepNames[clampLevel(level)];
+}
+
+void InitQualityGovernor(QualityGovernor* governor, int targetFPS) {
+    *governor = (QualityGovernor){0};
+    governor->budget = 1.0f / (targetFPS > 0 ? targetFPS : DEFAULT_BUDGET_FPS);
+    governor->raiseAfter = CALM_WINDOWS;
+    governor->windowsSinceRaise = MAX_CALM_WINDOWS;
+}
+
+// Holds level until the next pin; a negative level hands it back to the
+// governor.
+void PinQualityLevel(QualityGovernor* governor, int level) {
+    governor->pinned = level >= 0;
+    if (governor->pinned) governor->level = clampLevel(level);
+}
+
+void BeginQualityFrame(QualityGovernor* governor) {
+    governor->frameStart = GetTime();
+}
+
+void EndQualityFrame(QualityGovernor* governor) {
+    float work = (float)(GetTime() - governor->frameStart);
+    float interval = GetFrameTime();
+
+    float* mean = &governor->levelWork[governor->level];
+    *mean = *mean == 0.0f ? work : *mean + (work - *mean) * WORK_SMOOTHING;
+
+    if (work > governor->budget * OVER_WORK || interval > governor->budget * OVER_INTERVAL) governor->overFrames++;
+    if (work > governor->windowMaxWork) governor->windowMaxWork = work;
+    if (++governor->windowFrames < QUALITY_WINDOW) return;
+
+    bool over = governor->overFrames > QUALITY_WINDOW / 10;
+    bool calm = governor->overFrames == 0 && governor->windowMaxWork < governor->budget * HEADROOM_WORK;
+    governor->calmWindows = calm ? governor->calmWindows + 1 : 0;
+    if (governor->windowsSinceRaise < MAX_CALM_WINDOWS) governor->windowsSinceRaise++;
+
+    if (!governor->pinned) {
+        if (over && governor->level < QUALITY_LEVELS - 1) {
+            bool failedRaise = governor->windowsSinceRaise <= CALM_WINDOWS;
+            governor->raiseAfter = failedRaise ? governor->raiseAfter * 2 : CALM_WINDOWS;
+            if (governor->raiseAfter > MAX_CALM_WINDOWS) governor->raiseAfter = MAX_CALM_WINDOWS;
+            governor->level++;
+        } else if (governor->calmWindows >= governor->raiseAfter && governor->level > 0) {
+            governor->level--;
+            governor->calmWindows = 0;
+            governor->windowsSinceRaise = 0;
+        }
+    }
+
+    governor->windowFrames = 0;
+    governor->overFrames = 0;
+    governor->windowMaxWork = 0.0f;
+}
+
+int GetQualityLevel(const QualityGovernor* governor) {
+    return governor->level;
+}
+
+// What stepping down to level saved per frame, from the mean work measured
+// at it and at the level before; false until both have been seen.
+bool GetQualityStepSavings(const QualityGovernor* governor, int level, float* milliseconds) {
+    if (level <= 0 || level >= QUALITY_LEVELS) return false;
+    float before = governor->levelWork[level - 1];
+    float after = governor->levelWork[level];
+    if (before == 0.0f || after == 0.0f) return false;
+    *milliseconds = (before - after) * 1000.0f;
+    return true;
+}
+
+void ToggleQualityOverlay(QualityGovernor* governor) {
+    governor->overlay = !governor->overlay;
+}
+
+void DrawQualityOverlay(const QualityGovernor* governor, int x, int y) {
+    if (!governor->overlay) return;
+
+    int fontSize = 10;
+    int lineHeight = 12;
+    DrawRectangle(x, y, 230, (QUALITY_LEVELS + 2) * lineHeight + 8, Fade(BLACK, 0.75f));
+
+    int row = y + 4;
+    DrawText(TextFormat("quality %d/%d %s, budget %.2f ms", governor->level, QUALITY_LEVELS - 1,
+                        governor->pinned ? "pinned" : "auto", governor->budget * 1000.0f),
+             x + 6, row, fontSize, YELLOW);
+    row += lineHeight;
+    DrawText("step", x + 6, row, fontSize, GRAY);
+    DrawText("work", x + 130, row, fontSize, GRAY);
+    DrawText("saved", x + 180, row, fontSize, GRAY);
+    row += lineHeight;
+
+    for (int level = 0; level < QUALITY_LEVELS; level++) {
+        Color color = level == governor->level ? WHITE : LIGHTGRAY;
+        DrawText(TextFormat("%d %s", level, stepNames[level]), x + 6, row, fontSize, color);
+        if (governor->levelWork[level] > 0.0f) {
+            DrawText(TextFormat("%5.2f", governor->levelWork[level] * 1000.0f), x + 130, row, fontSize, color);
+        }
+        float saved;
+        if (GetQualityStepSavings(governor, level, &saved)) {
+            DrawText(TextFormat("%5.2f", saved), x + 180, row, fontSize, color);
+        }
+        row += lineHeight;
+    }
+}
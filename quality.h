@@ -0,0 +1,56 @@
+#ifndef QUALITY_H
+#define QUALITY_H
+
+#include <stdbool.h>
+
+// Level 0 is full quality; every further level keeps the cuts of the ones
+// before it.
+#define QUALITY_LEVELS 5
+
+// Frames per governor decision.
+#define QUALITY_WINDOW 30
+
+typedef struct {
+    int trailLength;        // newest trail samples drawn per ball
+    bool trailHalo;         // wider second disc per trail sample
+    bool glow;              // halo and highlight on ball heads and powerups
+    int cornerSegments;     // per rounded corner of blocks and the paddle
+    float renderScale;      // of the logical render target
+} QualitySettings;
+
+// Holds the frame budget by trading away rendering quality. Work is the time
+// from BeginQualityFrame to EndQualityFrame (update and draw, up to but not
+// including EndDrawing); the interval is the whole previous frame, which
+// catches a GPU that keeps EndDrawing waiting. A window of QUALITY_WINDOW
+// frames where more than a tenth ran over drops one level. A run of windows
+// with no frame over and work under half the budget raises one again; if
+// that raise runs over straight away, the run needed next time doubles.
+// The mean work seen at each level gives what every step saves.
+typedef struct {
+    float budget;           // seconds per frame
+    int level;
+    bool pinned;
+    double frameStart;
+    int windowFrames;
+    int overFrames;
+    float windowMaxWork;
+    int calmWindows;
+    int raiseAfter;         // calm windows needed to raise
+    int windowsSinceRaise;
+    float levelWork[QUALITY_LEVELS];    // mean work at each level, 0 until seen
+    bool overlay;
+} QualityGovernor;
+
+QualitySettings GetQualitySettings(int level);
+const char* QualityStepName(int level);
+
+void InitQualityGovernor(QualityGovernor* governor, int targetFPS);
+void PinQualityLevel(QualityGovernor* governor, int level);
+void BeginQualityFrame(QualityGovernor* governor);
+void EndQualityFrame(QualityGovernor* governor);
+int GetQualityLevel(const QualityGovernor* governor);
+bool GetQualityStepSavings(const QualityGovernor* governor, int level, float* milliseconds);
+void ToggleQualityOverlay(QualityGovernor* governor);
+void DrawQualityOverlay(const QualityGovernor* governor, int x, int y);
+
+#endif
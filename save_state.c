@@ -0,0 +1,386 @@
+#include "save_state.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STATE_MAGIC 0x53534342u    // "BCSS"
+#define STATE_VERSION 1
+#define MIN_COPY_RUN 4
+#define MAX_VARINT_BYTES 10
+
+// Everything of fixed size, first so that deltas line it up from one
+// snapshot to the next. The variable-length sections follow in this order:
+// block bits (8-byte words), hit points, ball arrays, ball handles,
+// powerups, powerup handles.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t levelIndex;
+    int32_t blockCount;
+    int32_t ballCount;
+    int32_t ballSlots;
+    uint32_t ballFreeSlot;
+    int32_t powerupCount;
+    int32_t powerupSlots;
+    uint32_t powerupFreeSlot;
+    int32_t score;
+    int32_t lives;
+    uint8_t gameOver;
+    uint8_t paused;
+    uint8_t hasAttributes;
+    uint8_t paddleActive;
+    uint32_t trailTick;
+    uint64_t rngState;
+    float trailClock;
+    float ballSpeed;
+    float ballRadius;
+    float paddleWidth;
+    float paddleSpeed;
+    int32_t levelStartBalls;
+    Rectangle paddleRect;
+    float paddlePrevX;
+    Vector2 paddleSpeedVector;
+} StateHeader;
+
+// Keeps the block bits that follow the header word-aligned.
+_Static_assert(sizeof(StateHeader) % sizeof(uint64_t) == 0, "StateHeader must be a whole number of words");
+
+static size_t handlesSize(int count, int slots) {
+    return (size_t)count * sizeof(uint32_t) + (size_t)slots * (sizeof(uint32_t) + sizeof(uint16_t));
+}
+
+static size_t stateSize(const StateHeader* header) {
+    size_t size = sizeof(StateHeader);
+    size += (size_t)(header->blockCount + 63) / 64 * sizeof(uint64_t);
+    if (header->hasAttributes) size += header->blockCount;
+    size += (size_t)header->ballCount * 7 * sizeof(float);
+    size += handlesSize(header->ballCount, header->ballSlots);
+    size += (size_t)header->powerupCount * sizeof(PowerUp);
+    size += handlesSize(header->powerupCount, header->powerupSlots);
+    return size;
+}
+
+static uint8_t* put(uint8_t* at, const void* data, size_t size) {
+    if (size > 0) memcpy(at, data, size);
+    return at + size;
+}
+
+static const uint8_t* take(const uint8_t* at, void* data, size_t size) {
+    if (size > 0) memcpy(data, at, size);
+    return at + size;
+}
+
+static uint8_t* putHandles(uint8_t* at, const EntityPool* pool) {
+    at = put(at, pool->slotOf, pool->count * sizeof(uint32_t));
+    at = put(at, pool->indexOf, pool->slotCount * sizeof(uint32_t));
+    return put(at, pool->generation, pool->slotCount * sizeof(uint16_t));
+}
+
+static const uint8_t* takeHandles(const uint8_t* at, EntityPool* pool, int count, int slots, uint32_t freeSlot) {
+    ReserveEntities(pool, slots);
+    at = take(at, pool->slotOf, count * sizeof(uint32_t));
+    at = take(at, pool->indexOf, slots * sizeof(uint32_t));
+    at = take(at, pool->generation, slots * sizeof(uint16_t));
+    pool->count = count;
+    pool->slotCount = slots;
+    pool->freeSlot = freeSlot;
+    return at;
+}
+
+void SaveBlockCrusherState(const BlockCrusherGame* game, StateBuffer* out) {
+    const BlockField* field = &game->field;
+    const BallStore* balls = &game->balls;
+
+    StateHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = STATE_MAGIC;
+    header.version = STATE_VERSION;
+    header.levelIndex = game->levelIndex;
+    header.blockCount = field->count;
+    header.ballCount = balls->count;
+    header.ballSlots = balls->pool.slotCount;
+    header.ballFreeSlot = balls->pool.freeSlot;
+    header.powerupCount = game->powerups.count;
+    header.powerupSlots = game->powerups.slotCount;
+    header.powerupFreeSlot = game->powerups.freeSlot;
+    header.score = game->score;
+    header.lives = game->lives;
+    header.gameOver = game->gameOver;
+    header.paused = game->paused;
+    header.hasAttributes = field->hasAttributes;
+    header.paddleActive = game->paddle.active;
+    header.trailTick = game->trailTick;
+    header.rngState = game->rngState;
+    header.trailClock = game->trailClock;
+    header.ballSpeed = game->ballSpeed;
+    header.ballRadius = game->ballRadius;
+    header.paddleWidth = game->paddleWidth;
+    header.paddleSpeed = game->paddleSpeed;
+    header.levelStartBalls = game->levelStartBalls;
+    header.paddleRect = game->paddle.rect;
+    header.paddlePrevX = game->paddle.prevX;
+    header.paddleSpeedVector = game->paddle.speed;
+
+    out->size = stateSize(&header);
+    ReserveStateBuffer(out, out->size);
+
+    uint8_t* at = put(out->data, &header, sizeof(header));
+    GetBlockBits(field, (uint64_t*)at);
+    at += (size_t)(field->count + 63) / 64 * sizeof(uint64_t);
+    if (field->hasAttributes) at = put(at, field->hp, field->count);
+
+    size_t floats = balls->count * sizeof(float);
+    at = put(at, balls->x, floats);
+    at = put(at, balls->y, floats);
+    at = put(at, balls->prevX, floats);
+    at = put(at, balls->prevY, floats);
+    at = put(at, balls->vx, floats);
+    at = put(at, balls->vy, floats);
+    at = put(at, balls->radius, floats);
+    at = putHandles(at, &balls->pool);
+
+    at = put(at, game->powerups.items, game->powerups.count * sizeof(PowerUp));
+    putHandles(at, &game->powerups);
+}
+
+static bool validHeader(const StateHeader* header) {
+    return header->magic == STATE_MAGIC && header->version == STATE_VERSION &&
+           header->blockCount >= 0 && header->ballCount >= 0 && header->powerupCount >= 0 &&
+           header->ballSlots >= header->ballCount && header->ballSlots <= ENTITY_MAX_COUNT &&
+           header->powerupSlots >= header->powerupCount && header->powerupSlots <= ENTITY_MAX_COUNT;
+}
+
+bool LoadBlockCrusherState(BlockCrusherGame* game, const StateBuffer* state) {
+    StateHeader header;
+    if (state->size < sizeof(header)) return false;
+    memcpy(&header, state->data, sizeof(header));
+    if (!validHeader(&header) || state->size != stateSize(&header)) return false;
+
+    BlockField* field = &game->field;
+    if (header.levelIndex != game->levelIndex) {
+        game->levelIndex = header.levelIndex;
+        LoadBlockCrusherLevel(game);
+    }
+    if (field->count != header.blockCount || field->hasAttributes != (bool)header.hasAttributes) return false;
+
+    const uint8_t* at = state->data + sizeof(header);
+    SetBlockBits(field, (const uint64_t*)at);
+    at += (size_t)(field->count + 63) / 64 * sizeof(uint64_t);
+    if (field->hasAttributes) at = take(at, field->hp, field->count);
+
+    BallStore* balls = &game->balls;
+    ReserveBalls(balls, header.ballCount);
+    size_t floats = header.ballCount * sizeof(float);
+    at = take(at, balls->x, floats);
+    at = take(at, balls->y, floats);
+    at = take(at, balls->prevX, floats);
+    at = take(at, balls->prevY, floats);
+    at = take(at, balls->vx, floats);
+    at = take(at, balls->vy, floats);
+    at = take(at, balls->radius, floats);
+    at = takeHandles(at, &balls->pool, header.ballCount, header.ballSlots, header.ballFreeSlot);
+    balls->count = header.ballCount;
+    if (header.ballCount > 0) memset(balls->active, 1, header.ballCount);
+    for (int i = 0; i < header.ballCount; i++) {
+        balls->trails[i].head = 0;
+        balls->trails[i].count = 0;
+    }
+
+    EntityPool* powerups = &game->powerups;
+    powerups->itemSize = sizeof(PowerUp);
+    ReserveEntities(powerups, header.powerupSlots);
+    at = take(at, powerups->items, header.powerupCount * sizeof(PowerUp));
+    takeHandles(at, powerups, header.powerupCount, header.powerupSlots, header.powerupFreeSlot);
+
+    game->score = header.score;
+    game->lives = header.lives;
+    game->gameOver = header.gameOver;
+    game->paused = header.paused;
+    game->trailTick = header.trailTick;
+    game->rngState = header.rngState;
+    game->trailClock = header.trailClock;
+    game->ballSpeed = header.ballSpeed;
+    game->ballRadius = header.ballRadius;
+    game->paddleWidth = header.paddleWidth;
+    game->paddleSpeed = header.paddleSpeed;
+    game->levelStartBalls = header.levelStartBalls;
+    game->paddle.rect = header.paddleRect;
+    game->paddle.prevX = header.paddlePrevX;
+    game->paddle.speed = header.paddleSpeedVector;
+    game->paddle.active = header.paddleActive;
+
+    game->renderer.blockLayerStale = true;
+    game->renderer.destroyedCount = 0;
+    return true;
+}
+
+static void putVarint(StateBuffer* buffer, uint64_t value) {
+    ReserveStateBuffer(buffer, buffer->size + MAX_VARINT_BYTES);
+    while (value >= 0x80) {
+        buffer->data[buffer->size++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer->data[buffer->size++] = (uint8_t)value;
+}
+
+static bool takeVarint(const uint8_t** at, const uint8_t* end, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64 && *at < end; shift += 7) {
+        uint8_t byte = *(*at)++;
+        *value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Length of the common prefix of a and b, up to limit bytes.
+static size_t matchLength(const uint8_t* a, const uint8_t* b, size_t limit) {
+    size_t n = 0;
+    while (n + sizeof(uint64_t) <= limit) {
+        uint64_t wordA, wordB;
+        memcpy(&wordA, a + n, sizeof(wordA));
+        memcpy(&wordB, b + n, sizeof(wordB));
+        if (wordA != wordB) break;
+        n += sizeof(uint64_t);
+    }
+    while (n < limit && a[n] == b[n]) n++;
+    return n;
+}
+
+// The delta is target's size followed by (copy, literal) pairs: copy bytes
+// come from the same offset in reference, then literal bytes follow inline.
+// Matches shorter than MIN_COPY_RUN stay in the literal, where they cost
+// less than a new pair.
+void EncodeStateDelta(const StateBuffer* reference, const StateBuffer* target, StateBuffer* delta) {
+    const uint8_t* t = target->data;
+    const uint8_t* r = reference->data;
+    size_t n = target->size;
+    size_t common = n < reference->size ? n : reference->size;
+
+    delta->size = 0;
+    putVarint(delta, n);
+
+    size_t i = 0;
+    while (i < n) {
+        size_t copy = (i < common) ? matchLength(t + i, r + i, common - i) : 0;
+        i += copy;
+
+        size_t literal = i;
+        while (i < n) {
+            size_t limit = (i < common) ? common - i : 0;
+            if (limit > MIN_COPY_RUN) limit = MIN_COPY_RUN;
+            size_t match = (limit > 0) ? matchLength(t + i, r + i, limit) : 0;
+            if (match == MIN_COPY_RUN || (match > 0 && i + match == n)) break;
+            i += match + 1;
+        }
+
+        putVarint(delta, copy);
+        putVarint(delta, i - literal);
+        ReserveStateBuffer(delta, delta->size + (i - literal));
+        memcpy(delta->data + delta->size, t + literal, i - literal);
+        delta->size += i - literal;
+    }
+}
+
+bool DecodeStateDelta(const StateBuffer* reference, const StateBuffer* delta, StateBuffer* target) {
+    const uint8_t* at = delta->data;
+    const uint8_t* end = delta->data + delta->size;
+    uint64_t size;
+    if (!takeVarint(&at, end, &size)) return false;
+
+    ReserveStateBuffer(target, size);
+    size_t pos = 0;
+    while (pos < size) {
+        uint64_t copy, literal;
+        if (!takeVarint(&at, end, &copy) || !takeVarint(&at, end, &literal)) return false;
+        if (copy + literal == 0 || copy > size - pos || pos + copy > reference->size) return false;
+        memcpy(target->data + pos, reference->data + pos, copy);
+        pos += copy;
+
+        if (literal > size - pos || literal > (size_t)(end - at)) return false;
+        memcpy(target->data + pos, at, literal);
+        at += literal;
+        pos += literal;
+    }
+    target->size = size;
+    return at == end;
+}
+
+void InitRewind(RewindBuffer* rewind, int maxSnapshots, size_t budget) {
+    memset(rewind, 0, sizeof(*rewind));
+    rewind->capacity = (maxSnapshots > 1) ? maxSnapshots - 1 : 1;
+    rewind->deltas = calloc(rewind->capacity, sizeof(StateBuffer));
+    rewind->budget = budget;
+}
+
+// Buffers dropped to make room in a full ring are about to be reused, so
+// only drops for the byte budget give their memory back.
+static void dropOldest(RewindBuffer* rewind, bool release) {
+    StateBuffer* delta = &rewind->deltas[rewind->first];
+    if (release) {
+        rewind->bytes -= delta->capacity;
+        FreeStateBuffer(delta);
+    }
+    rewind->first = (rewind->first + 1) % rewind->capacity;
+    rewind->count--;
+}
+
+static void swapBuffers(StateBuffer* a, StateBuffer* b) {
+    StateBuffer t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Meant to be called after every tick. Snapshots identical to the newest
+// one (paused, game over) are not stored again.
+void PushRewind(RewindBuffer* rewind, const BlockCrusherGame* game) {
+    SaveBlockCrusherState(game, &rewind->scratch);
+
+    if (rewind->hasNewest) {
+        if (rewind->scratch.size == rewind->newest.size &&
+            memcmp(rewind->scratch.data, rewind->newest.data, rewind->newest.size) == 0) {
+            return;
+        }
+        if (rewind->count == rewind->capacity) dropOldest(rewind, false);
+
+        StateBuffer* delta = &rewind->deltas[(rewind->first + rewind->count) % rewind->capacity];
+        rewind->bytes -= delta->capacity;
+        EncodeStateDelta(&rewind->scratch, &rewind->newest, delta);
+        rewind->bytes += delta->capacity;
+        rewind->count++;
+
+        while (rewind->bytes > rewind->budget && rewind->count > 1) dropOldest(rewind, true);
+    }
+    swapBuffers(&rewind->newest, &rewind->scratch);
+    rewind->hasNewest = true;
+}
+
+// Steps the game back to the snapshot before the newest one and makes that
+// the newest. Returns false once there is nothing older left.
+bool PopRewind(RewindBuffer* rewind, BlockCrusherGame* game) {
+    if (rewind->count == 0) return false;
+
+    StateBuffer* delta = &rewind->deltas[(rewind->first + rewind->count - 1) % rewind->capacity];
+    if (!DecodeStateDelta(&rewind->newest, delta, &rewind->scratch)) {
+        ClearRewind(rewind);
+        return false;
+    }
+    rewind->count--;
+    swapBuffers(&rewind->newest, &rewind->scratch);
+    return LoadBlockCrusherState(game, &rewind->newest);
+}
+
+void ClearRewind(RewindBuffer* rewind) {
+    rewind->first = 0;
+    rewind->count = 0;
+    rewind->hasNewest = false;
+}
+
+void FreeRewind(RewindBuffer* rewind) {
+    for (int i = 0; i < rewind->capacity; i++) {
+        FreeStateBuffer(&rewind->deltas[i]);
+    }
+    free(rewind->deltas);
+    FreeStateBuffer(&rewind->newest);
+    FreeStateBuffer(&rewind->scratch);
+    memset(rewind, 0, sizeof(*rewind));
+}
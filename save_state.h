@@ -0,0 +1,54 @@
+#ifndef SAVE_STATE_H
+#define SAVE_STATE_H
+
+#include "block_crusher.h"
+#include "state_buffer.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Snapshots hold the simulation state of one game in a single contiguous
+// buffer: scalars, paddle, RNG, the active blocks as a bitset (plus hit
+// points for levels that have them), the balls' arrays and both entity
+// pools including their handles. Trails, the block layer and other
+// presentation state are left out, and so is block geometry: a snapshot
+// names its level and is restored into a field rebuilt from that level
+// with the same settings (rows/cols/levels), so it only makes sense within
+// one session. The layout is native-endian and not meant for disk.
+//
+// Loading checks the snapshot's structure but trusts its contents. It fails
+// if the level it names does not rebuild to the same block count, in which
+// case the game has already been moved to that level.
+void SaveBlockCrusherState(const BlockCrusherGame* game, StateBuffer* out);
+bool LoadBlockCrusherState(BlockCrusherGame* game, const StateBuffer* state);
+
+// Deltas store target as runs copied from reference and literal bytes, so
+// consecutive snapshots, which mostly differ in a few ball positions,
+// shrink to tens of bytes.
+void EncodeStateDelta(const StateBuffer* reference, const StateBuffer* target, StateBuffer* delta);
+bool DecodeStateDelta(const StateBuffer* reference, const StateBuffer* delta, StateBuffer* target);
+
+// The last few seconds of snapshots for rewinding. Only the newest one is
+// kept whole; every older one is a delta against its successor, so
+// stepping back decodes one delta and dropping the oldest frees one.
+// Deltas are evicted oldest first to keep at most maxSnapshots snapshots
+// and budget bytes of delta buffers.
+typedef struct RewindBuffer {
+    StateBuffer newest;
+    StateBuffer scratch;
+    StateBuffer* deltas;    // deltas[(first + i) % capacity] rebuilds the i-th oldest
+    int first;
+    int count;
+    int capacity;
+    size_t bytes;
+    size_t budget;
+    bool hasNewest;
+} RewindBuffer;
+
+void InitRewind(RewindBuffer* rewind, int maxSnapshots, size_t budget);
+void PushRewind(RewindBuffer* rewind, const BlockCrusherGame* game);
+bool PopRewind(RewindBuffer* rewind, BlockCrusherGame* game);
+void ClearRewind(RewindBuffer* rewind);
+void FreeRewind(RewindBuffer* rewind);
+
+#endif
@@ -0,0 +1,528 @@
+#include "snake.h"
+#include "game_util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_BOARD_WIDTH 40
+#define DEFAULT_BOARD_HEIGHT 30
+#define DEFAULT_START_LENGTH 4
+#define DEFAULT_STEP_RATE 12
+#define SNAKE_GROWTH 1
+#define SNAKE_SUMMARY_WORDS 64
+#define MAX_FRAME_TIME 0.25f
+#define MAX_CELL_PATCHES 1024
+#define HUD_HEIGHT 40
+#define BOARD_MARGIN 10
+#define SNAKE_STATE_MAGIC 0x534B4E53u    // "SNKS"
+#define SNAKE_STATE_VERSION 1
+
+// Followed by the body's cells, tail first.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t boardWidth;
+    int32_t boardHeight;
+    int32_t startLength;
+    int32_t stepRate;
+    int32_t length;
+    int32_t direction;
+    int32_t food;
+    int32_t growth;
+    int32_t score;
+    int32_t pendingTurn;
+    uint8_t gameOver;
+    uint8_t won;
+    uint8_t paused;
+    uint8_t pendingPause;
+    uint8_t pendingRestart;
+    uint64_t rngState;
+    float accumulator;
+} SnakeStateHeader;
+
+static uint32_t nextRandom(SnakeGame* game) {
+    return (uint32_t)(SplitMix64(&game->rngState) >> 32);
+}
+
+static int randomInt(SnakeGame* game, int range) {
+    return (int)(((uint64_t)nextRandom(game) * (uint32_t)range) >> 32);
+}
+
+// Heights are rounded up to even so the autopilot's Hamiltonian cycle
+// exists.
+void SetSnakeBoard(SnakeGame* game, int width, int height) {
+    if (width > 0) game->boardWidth = width < SNAKE_MAX_BOARD ? width : SNAKE_MAX_BOARD;
+    if (height > 0) game->boardHeight = height < SNAKE_MAX_BOARD ? height : SNAKE_MAX_BOARD;
+}
+
+void SetSnakeStartLength(SnakeGame* game, int length) {
+    if (length > 0) game->startLength = length;
+}
+
+void SetSnakeSeed(SnakeGame* game, uint64_t seed) {
+    game->rngState = seed;
+}
+
+static void applyDefaults(SnakeGame* game) {
+    if (game->boardWidth <= 0) game->boardWidth = DEFAULT_BOARD_WIDTH;
+    if (game->boardHeight <= 0) game->boardHeight = DEFAULT_BOARD_HEIGHT;
+    if (game->boardWidth < 2) game->boardWidth = 2;
+    if (game->boardHeight < 2) game->boardHeight = 2;
+    game->boardHeight += game->boardHeight & 1;
+    if (game->startLength <= 0) game->startLength = DEFAULT_START_LENGTH;
+    if (game->stepRate <= 0) game->stepRate = DEFAULT_STEP_RATE;
+}
+
+// Queues a cell for re-upload; ignored while a full upload is pending.
+static void markCellChanged(SnakeRenderer* renderer, int cell) {
+    if (renderer->boardStale) return;
+    if (renderer->changedCount == renderer->changedCapacity) {
+        renderer->changedCapacity = renderer->changedCapacity ? renderer->changedCapacity * 2 : 64;
+        renderer->changedCells = realloc(renderer->changedCells, renderer->changedCapacity * sizeof(int));
+    }
+    renderer->changedCells[renderer->changedCount++] = cell;
+}
+
+static void setCell(SnakeGame* game, int cell) {
+    game->occupied[cell >> 6] |= 1ULL << (cell & 63);
+    game->freeCount[(cell >> 6) / SNAKE_SUMMARY_WORDS]--;
+    markCellChanged(&game->renderer, cell);
+}
+
+static void clearCell(SnakeGame* game, int cell) {
+    game->occupied[cell >> 6] &= ~(1ULL << (cell & 63));
+    game->freeCount[(cell >> 6) / SNAKE_SUMMARY_WORDS]++;
+    markCellChanged(&game->renderer, cell);
+}
+
+// The k-th free cell in index order: whole summaries are skipped by their
+// counts, then words by popcount, then bits within the word.
+static int selectFreeCell(const SnakeGame* game, int k) {
+    int summary = 0;
+    while (k >= game->freeCount[summary]) {
+        k -= game->freeCount[summary];
+        summary++;
+    }
+
+    int word = summary * SNAKE_SUMMARY_WORDS;
+    for (;; word++) {
+        int free = 64 - __builtin_popcountll(game->occupied[word]);
+        if (k < free) break;
+        k -= free;
+    }
+
+    uint64_t zeros = ~game->occupied[word];
+    while (k-- > 0) zeros &= zeros - 1;
+    return word * 64 + __builtin_ctzll(zeros);
+}
+
+static void placeFood(SnakeGame* game) {
+    int free = game->cellCount - game->length;
+    if (free == 0) {
+        game->food = -1;
+        game->won = true;
+        game->gameOver = true;
+        return;
+    }
+    game->food = selectFreeCell(game, randomInt(game, free));
+}
+
+// Direction of a Hamiltonian cycle through every cell (height is even):
+// row 0 runs right from column 0, the rows below snake back and forth over
+// columns 1..width-1, and column 0 leads back up to the start.
+static int cycleDirection(int x, int y, int width, int height) {
+    if (x == 0) return (y == 0) ? SNAKE_RIGHT : SNAKE_UP;
+    if ((y & 1) == 0) return (x < width - 1) ? SNAKE_RIGHT : SNAKE_DOWN;
+    if (x > 1) return SNAKE_LEFT;
+    return (y == height - 1) ? SNAKE_LEFT : SNAKE_DOWN;
+}
+
+static const int directionX[4] = {0, 1, 0, -1};
+static const int directionY[4] = {-1, 0, 1, 0};
+
+static void allocateBoard(SnakeGame* game) {
+    int cellCount = game->boardWidth * game->boardHeight;
+    if (cellCount == game->cellCount && game->occupied) return;
+
+    int words = (cellCount + 63) / 64;
+    int summaries = (words + SNAKE_SUMMARY_WORDS - 1) / SNAKE_SUMMARY_WORDS;
+    game->cellCount = cellCount;
+    game->occupied = realloc(game->occupied, (size_t)words * sizeof(uint64_t));
+    game->freeCount = realloc(game->freeCount, (size_t)summaries * sizeof(uint16_t));
+    game->body = realloc(game->body, (size_t)cellCount * sizeof(int));
+}
+
+static void clearBoard(SnakeGame* game) {
+    int words = (game->cellCount + 63) / 64;
+    int summaries = (words + SNAKE_SUMMARY_WORDS - 1) / SNAKE_SUMMARY_WORDS;
+
+    memset(game->occupied, 0, (size_t)words * sizeof(uint64_t));
+    if (game->cellCount % 64 != 0) game->occupied[words - 1] = ~((1ULL << (game->cellCount % 64)) - 1);
+    for (int s = 0; s < summaries; s++) {
+        int first = s * SNAKE_SUMMARY_WORDS * 64;
+        int last = first + SNAKE_SUMMARY_WORDS * 64;
+        if (last > game->cellCount) last = game->cellCount;
+        game->freeCount[s] = (uint16_t)(last - first);
+    }
+}
+
+// The snake starts laid along the autopilot's cycle from the top-left
+// corner, so any start length up to a full board is a legal position.
+void InitSnake(SnakeGame* game) {
+    applyDefaults(game);
+    allocateBoard(game);
+    clearBoard(game);
+    game->renderer.boardStale = true;
+    game->renderer.changedCount = 0;
+
+    int length = game->startLength;
+    if (length > game->cellCount - 1) length = game->cellCount - 1;
+
+    int x = 0;
+    int y = 0;
+    game->direction = SNAKE_RIGHT;
+    for (int i = 0; i < length; i++) {
+        int cell = y * game->boardWidth + x;
+        game->body[i] = cell;
+        setCell(game, cell);
+        if (i < length - 1) {
+            game->direction = cycleDirection(x, y, game->boardWidth, game->boardHeight);
+            x += directionX[game->direction];
+            y += directionY[game->direction];
+        }
+    }
+    game->tail = 0;
+    game->length = length;
+    game->growth = 0;
+    game->score = 0;
+    game->gameOver = false;
+    game->won = false;
+    game->paused = false;
+    game->accumulator = 0.0f;
+    game->pendingCommands = (SnakeInput){-1, false, false};
+    placeFood(game);
+}
+
+void StepSnake(SnakeGame* game, SnakeInput input) {
+    if (input.pause) game->paused = !game->paused;
+    if (input.restart) {
+        InitSnake(game);
+        return;
+    }
+    if (game->gameOver || game->paused) return;
+
+    if (input.turn >= 0 && input.turn != (game->direction + 2) % 4) game->direction = input.turn;
+
+    int head = SnakeHead(game);
+    int x = head % game->boardWidth + directionX[game->direction];
+    int y = head / game->boardWidth + directionY[game->direction];
+    if (x < 0 || x >= game->boardWidth || y < 0 || y >= game->boardHeight) {
+        game->gameOver = true;
+        return;
+    }
+
+    // Moving into the cell the tail is leaving is fine unless the snake is
+    // growing this step.
+    int next = y * game->boardWidth + x;
+    bool eat = next == game->food;
+    int growth = game->growth + (eat ? SNAKE_GROWTH : 0);
+    int tailCell = game->body[game->tail];
+    if (IsSnakeCellOccupied(game, next) && (growth > 0 || next != tailCell)) {
+        game->gameOver = true;
+        return;
+    }
+
+    if (growth > 0) {
+        growth--;
+    } else {
+        clearCell(game, tailCell);
+        if (++game->tail == game->cellCount) game->tail = 0;
+        game->length--;
+    }
+    game->growth = growth;
+
+    int headIndex = game->tail + game->length;
+    if (headIndex >= game->cellCount) headIndex -= game->cellCount;
+    game->body[headIndex] = next;
+    game->length++;
+    setCell(game, next);
+
+    if (eat) {
+        game->score++;
+        placeFood(game);
+    }
+}
+
+SnakeInput ReadSnakeInput(void) {
+    SnakeInput input = {-1, false, false};
+    if (IsKeyPressed(KEY_UP)) input.turn = SNAKE_UP;
+    if (IsKeyPressed(KEY_RIGHT)) input.turn = SNAKE_RIGHT;
+    if (IsKeyPressed(KEY_DOWN)) input.turn = SNAKE_DOWN;
+    if (IsKeyPressed(KEY_LEFT)) input.turn = SNAKE_LEFT;
+    input.pause = IsKeyPressed(KEY_P);
+    input.restart = IsKeyPressed(KEY_R);
+    return input;
+}
+
+// Follows the Hamiltonian cycle the snake starts on. The body always trails
+// the head along it, so this never collides and fills the whole board in
+// O(1) per step.
+SnakeInput AutopilotSnake(const SnakeGame* game) {
+    SnakeInput input = {-1, false, false};
+    if (game->gameOver) {
+        input.restart = true;
+        return input;
+    }
+    int head = SnakeHead(game);
+    input.turn = cycleDirection(head % game->boardWidth, head / game->boardWidth,
+                                game->boardWidth, game->boardHeight);
+    return input;
+}
+
+// FNV-1a over the simulation state, body in tail-to-head order.
+uint64_t HashSnakeState(const SnakeGame* game) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    int flags = (game->gameOver ? 1 : 0) | (game->paused ? 2 : 0) | (game->won ? 4 : 0);
+
+    hash = HashBytes(hash, &game->score, sizeof(game->score));
+    hash = HashBytes(hash, &flags, sizeof(flags));
+    hash = HashBytes(hash, &game->rngState, sizeof(game->rngState));
+    hash = HashBytes(hash, &game->direction, sizeof(game->direction));
+    hash = HashBytes(hash, &game->food, sizeof(game->food));
+    hash = HashBytes(hash, &game->growth, sizeof(game->growth));
+    hash = HashBytes(hash, &game->length, sizeof(game->length));
+
+    int first = game->cellCount - game->tail;
+    if (first > game->length) first = game->length;
+    hash = HashBytes(hash, game->body + game->tail, (size_t)first * sizeof(int));
+    hash = HashBytes(hash, game->body, (size_t)(game->length - first) * sizeof(int));
+    return hash;
+}
+
+// The board, body and everything stepping depends on, so a game can be
+// carried across a module reload; the occupancy bitmap and free counts are
+// rebuilt from the body on load.
+void SaveSnakeState(const SnakeGame* game, StateBuffer* out) {
+    SnakeStateHeader header = {
+        .magic = SNAKE_STATE_MAGIC,
+        .version = SNAKE_STATE_VERSION,
+        .boardWidth = game->boardWidth,
+        .boardHeight = game->boardHeight,
+        .startLength = game->startLength,
+        .stepRate = game->stepRate,
+        .length = game->length,
+        .direction = game->direction,
+        .food = game->food,
+        .growth = game->growth,
+        .score = game->score,
+        .pendingTurn = game->pendingCommands.turn,
+        .gameOver = game->gameOver,
+        .won = game->won,
+        .paused = game->paused,
+        .pendingPause = game->pendingCommands.pause,
+        .pendingRestart = game->pendingCommands.restart,
+        .rngState = game->rngState,
+        .accumulator = game->accumulator,
+    };
+
+    out->size = sizeof(header) + (size_t)game->length * sizeof(int32_t);
+    ReserveStateBuffer(out, out->size);
+    memcpy(out->data, &header, sizeof(header));
+
+    int32_t* cells = (int32_t*)(out->data + sizeof(header));
+    int index = game->tail;
+    for (int i = 0; i < game->length; i++) {
+        cells[i] = game->body[index];
+        if (++index == game->cellCount) index = 0;
+    }
+}
+
+// Fails, leaving game untouched, unless state holds a well-formed board
+// with every body cell on it exactly once.
+bool LoadSnakeState(SnakeGame* game, const StateBuffer* state) {
+    SnakeStateHeader header;
+    if (state->size < sizeof(header)) return false;
+    memcpy(&header, state->data, sizeof(header));
+    if (header.magic != SNAKE_STATE_MAGIC || header.version != SNAKE_STATE_VERSION) return false;
+    if (header.boardWidth < 2 || header.boardWidth > SNAKE_MAX_BOARD) return false;
+    if (header.boardHeight < 2 || header.boardHeight > SNAKE_MAX_BOARD) return false;
+    int cellCount = header.boardWidth * header.boardHeight;
+    if (header.length < 1 || header.length > cellCount) return false;
+    if (state->size != sizeof(header) + (size_t)header.length * sizeof(int32_t)) return false;
+    if (header.food < -1 || header.food >= cellCount || header.direction < 0 || header.direction > 3) return false;
+    if (header.stepRate <= 0 || (header.boardHeight & 1)) return false;
+
+    int words = (cellCount + 63) / 64;
+    uint64_t* seen = calloc(words, sizeof(uint64_t));
+    const int32_t* cells = (const int32_t*)(state->data + sizeof(header));
+    bool valid = true;
+    for (int i = 0; i < header.length && valid; i++) {
+        int cell = cells[i];
+        valid = cell >= 0 && cell < cellCount && !((seen[cell >> 6] >> (cell & 63)) & 1);
+        if (valid) seen[cell >> 6] |= 1ULL << (cell & 63);
+    }
+    free(seen);
+    if (!valid) return false;
+
+    game->boardWidth = header.boardWidth;
+    game->boardHeight = header.boardHeight;
+    game->startLength = header.startLength;
+    game->stepRate = header.stepRate;
+    allocateBoard(game);
+    clearBoard(game);
+    game->renderer.boardStale = true;
+    game->renderer.changedCount = 0;
+
+    for (int i = 0; i < header.length; i++) {
+        game->body[i] = cells[i];
+        setCell(game, cells[i]);
+    }
+    game->tail = 0;
+    game->length = header.length;
+    game->direction = header.direction;
+    game->food = header.food;
+    game->growth = header.growth;
+    game->score = header.score;
+    game->gameOver = header.gameOver;
+    game->won = header.won;
+    game->paused = header.paused;
+    game->rngState = header.rngState;
+    game->accumulator = header.accumulator;
+    game->pendingCommands = (SnakeInput){header.pendingTurn, header.pendingPause, header.pendingRestart};
+    return true;
+}
+
+// Returns false once M asks to go back to the menu.
+bool UpdateSnake(SnakeGame* game, float frameTime) {
+    if (IsKeyPressed(KEY_M)) return false;
+
+    // Like Block Crusher, commands wait for the next step; the last arrow
+    // pressed before a step wins.
+    SnakeInput input = ReadSnakeInput();
+    if (input.turn >= 0) game->pendingCommands.turn = input.turn;
+    game->pendingCommands.pause |= input.pause;
+    game->pendingCommands.restart |= input.restart;
+
+    float stepTime = 1.0f / game->stepRate;
+    if (frameTime > MAX_FRAME_TIME) frameTime = MAX_FRAME_TIME;
+
+    game->accumulator += frameTime;
+    while (game->accumulator >= stepTime) {
+        StepSnake(game, game->pendingCommands);
+        game->pendingCommands = (SnakeInput){-1, false, false};
+        game->accumulator -= stepTime;
+    }
+    return true;
+}
+
+// Brings the board texture up to date: a full upload on the first frame,
+// after a restart or when many cells changed, otherwise one texel per
+// changed cell.
+static void updateBoardTexture(SnakeRenderer* renderer, const SnakeGame* game) {
+    int width = game->boardWidth;
+    int height = game->boardHeight;
+
+    if (renderer->board.id != 0 && (renderer->board.width != width || renderer->board.height != height)) {
+        UnloadTexture(renderer->board);
+        renderer->board = (Texture2D){0};
+    }
+    if (renderer->board.id == 0) {
+        renderer->pixels = realloc(renderer->pixels, (size_t)width * height);
+        Image image = {renderer->pixels, width, height, 1, PIXELFORMAT_UNCOMPRESSED_GRAYSCALE};
+        renderer->board = LoadTextureFromImage(image);
+        SetTextureFilter(renderer->board, TEXTURE_FILTER_POINT);
+        renderer->boardStale = true;
+    }
+    if (renderer->changedCount > MAX_CELL_PATCHES) renderer->boardStale = true;
+
+    if (renderer->boardStale) {
+        for (int cell = 0; cell < game->cellCount; cell++) {
+            renderer->pixels[cell] = IsSnakeCellOccupied(game, cell) ? 255 : 0;
+        }
+        UpdateTexture(renderer->board, renderer->pixels);
+    } else {
+        for (int i = 0; i < renderer->changedCount; i++) {
+            int cell = renderer->changedCells[i];
+            renderer->pixels[cell] = IsSnakeCellOccupied(game, cell) ? 255 : 0;
+            Rectangle texel = {cell % width, cell / width, 1, 1};
+            UpdateTextureRec(renderer->board, texel, &renderer->pixels[cell]);
+        }
+    }
+    renderer->boardStale = false;
+    renderer->changedCount = 0;
+}
+
+// A cell in screen space, kept at least two pixels wide so the head and the
+// food stay visible on huge boards.
+static Rectangle cellRect(Rectangle area, const SnakeGame* game, int cell) {
+    float cellSize = area.width / game->boardWidth;
+    float size = cellSize > 2.0f ? cellSize : 2.0f;
+    return (Rectangle){area.x + (cell % game->boardWidth) * cellSize,
+                       area.y + (cell / game->boardWidth) * cellSize, size, size};
+}
+
+static void drawCentered(const char* text, int y, int fontSize, Color color) {
+    DrawText(text, SNAKE_SCREEN_WIDTH/2 - MeasureText(text, fontSize)/2, y, fontSize, color);
+}
+
+void DrawSnake(SnakeGame* game, int windowWidth, int windowHeight) {
+    SnakeRenderer* renderer = &game->renderer;
+    updateBoardTexture(renderer, game);
+
+    BeginPresentation(&renderer->presentation, SNAKE_SCREEN_WIDTH, SNAKE_SCREEN_HEIGHT);
+    ClearBackground(BLACK);
+
+    float availableWidth = SNAKE_SCREEN_WIDTH - BOARD_MARGIN * 2;
+    float availableHeight = SNAKE_SCREEN_HEIGHT - HUD_HEIGHT - BOARD_MARGIN * 2;
+    float cellSize = availableWidth / game->boardWidth;
+    if (availableHeight / game->boardHeight < cellSize) cellSize = availableHeight / game->boardHeight;
+    Rectangle area = {(SNAKE_SCREEN_WIDTH - cellSize * game->boardWidth) / 2,
+                      HUD_HEIGHT + BOARD_MARGIN + (availableHeight - cellSize * game->boardHeight) / 2,
+                      cellSize * game->boardWidth, cellSize * game->boardHeight};
+
+    DrawRectangleRec(area, (Color){20, 20, 20, 255});
+    DrawTexturePro(renderer->board, (Rectangle){0, 0, game->boardWidth, game->boardHeight},
+                   area, (Vector2){0, 0}, 0.0f, LIME);
+    if (game->food >= 0) DrawRectangleRec(cellRect(area, game, game->food), RED);
+    DrawRectangleRec(cellRect(area, game, SnakeHead(game)), YELLOW);
+    DrawRectangleLinesEx(area, 1.0f, DARKGRAY);
+
+    int fontSize = 20;
+    DrawText(TextFormat("SCORE: %d", game->score), BOARD_MARGIN, BOARD_MARGIN, fontSize, GREEN);
+    const char* lengthText = TextFormat("LENGTH: %d", game->length);
+    DrawText(lengthText, SNAKE_SCREEN_WIDTH - MeasureText(lengthText, fontSize) - BOARD_MARGIN,
+             BOARD_MARGIN, fontSize, GREEN);
+    drawCentered(TextFormat("%dx%d", game->boardWidth, game->boardHeight), BOARD_MARGIN, fontSize, GRAY);
+
+    if (game->paused || game->gameOver) {
+        DrawRectangle(0, 0, SNAKE_SCREEN_WIDTH, SNAKE_SCREEN_HEIGHT, Fade(BLACK, 0.7f));
+    }
+    if (game->paused) {
+        drawCentered("GAME PAUSED", SNAKE_SCREEN_HEIGHT/2 - 60, 40, YELLOW);
+        drawCentered("Press P to continue", SNAKE_SCREEN_HEIGHT/2 + 20, 20, WHITE);
+    } else if (game->gameOver) {
+        drawCentered(game->won ? "BOARD FILLED" : "GAME OVER", SNAKE_SCREEN_HEIGHT/2 - 80, 50,
+                     game->won ? GREEN : RED);
+        drawCentered(TextFormat("FINAL SCORE: %d", game->score), SNAKE_SCREEN_HEIGHT/2, 30, YELLOW);
+        drawCentered("Press R to restart", SNAKE_SCREEN_HEIGHT/2 + 60, 20, WHITE);
+    }
+
+    EndPresentation(&renderer->presentation, windowWidth, windowHeight);
+}
+
+void CloseSnake(SnakeGame* game) {
+    SnakeRenderer* renderer = &game->renderer;
+    if (renderer->board.id != 0) UnloadTexture(renderer->board);
+    UnloadPresentation(&renderer->presentation);
+    free(renderer->pixels);
+    free(renderer->changedCells);
+    memset(renderer, 0, sizeof(*renderer));
+    renderer->boardStale = true;
+
+    free(game->occupied);
+    free(game->freeCount);
+    free(game->body);
+    game->occupied = NULL;
+    game->freeCount = NULL;
+    game->body = NULL;
+    game->cellCount = 0;
+}
@@ -0,0 +1,99 @@
+#ifndef SNAKE_H
+#define SNAKE_H
+
+#include "raylib.h"
+#include "presentation.h"
+#include "state_buffer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Snake draws in this logical space, like Block Crusher.
+#define SNAKE_SCREEN_WIDTH 800
+#define SNAKE_SCREEN_HEIGHT 600
+#define SNAKE_MAX_BOARD 4096
+
+typedef enum {
+    SNAKE_UP = 0,
+    SNAKE_RIGHT,
+    SNAKE_DOWN,
+    SNAKE_LEFT
+} SnakeDirection;
+
+// turn is a SnakeDirection, or -1 to keep going.
+typedef struct {
+    int turn;
+    bool pause;
+    bool restart;
+} SnakeInput;
+
+// Draw-side resources. The board is one grayscale texel per cell, drawn as a
+// single scaled quad; pixels mirrors it on the CPU. Later frames only
+// re-upload the cells listed in changedCells, and boardStale forces a full
+// upload.
+typedef struct {
+    Texture2D board;
+    uint8_t* pixels;
+    bool boardStale;
+    int* changedCells;
+    int changedCount;
+    int changedCapacity;
+    Presentation presentation;
+} SnakeRenderer;
+
+// The body is a ring of cell indices from tail to head, so a move writes
+// the new head and advances the tail in O(1) at any length. occupied has
+// one bit per cell (padding bits past cellCount stay set) and freeCount
+// holds the free cells of every SNAKE_SUMMARY_WORDS words, so self-collision
+// is a bit test and food goes straight to a uniformly chosen free cell.
+typedef struct {
+    int boardWidth;
+    int boardHeight;
+    int startLength;
+    int stepRate;
+
+    int cellCount;
+    uint64_t* occupied;
+    uint16_t* freeCount;
+    int* body;
+    int tail;
+    int length;
+    int direction;
+    int food;
+    int growth;
+    int score;
+    bool gameOver;
+    bool won;
+    bool paused;
+    uint64_t rngState;
+
+    float accumulator;
+    SnakeInput pendingCommands;
+
+    SnakeRenderer renderer;
+} SnakeGame;
+
+void SetSnakeBoard(SnakeGame* game, int width, int height);
+void SetSnakeStartLength(SnakeGame* game, int length);
+void SetSnakeSeed(SnakeGame* game, uint64_t seed);
+void InitSnake(SnakeGame* game);
+void StepSnake(SnakeGame* game, SnakeInput input);
+SnakeInput ReadSnakeInput(void);
+SnakeInput AutopilotSnake(const SnakeGame* game);
+uint64_t HashSnakeState(const SnakeGame* game);
+void SaveSnakeState(const SnakeGame* game, StateBuffer* out);
+bool LoadSnakeState(SnakeGame* game, const StateBuffer* state);
+bool UpdateSnake(SnakeGame* game, float frameTime);
+void DrawSnake(SnakeGame* game, int windowWidth, int windowHeight);
+void CloseSnake(SnakeGame* game);
+
+static inline int SnakeHead(const SnakeGame* game) {
+    int index = game->tail + game->length - 1;
+    if (index >= game->cellCount) index -= game->cellCount;
+    return game->body[index];
+}
+
+static inline bool IsSnakeCellOccupied(const SnakeGame* game, int cell) {
+    return (game->occupied[cell >> 6] >> (cell & 63)) & 1;
+}
+
+#endif
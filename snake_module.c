@@ -0,0 +1,67 @@
+#include "game_module.h"
+#include "snake.h"
+#include "game_util.h"
+#include <stdio.h>
+
+static void start(void* state, const GameModuleConfig* config) {
+    SnakeGame* game = state;
+    SetSnakeBoard(game, config->snakeWidth, config->snakeHeight);
+    SetSnakeStartLength(game, config->snakeLength);
+    SetSnakeSeed(game, config->seed);
+    InitSnake(game);
+}
+
+static bool update(void* state, float frameTime) {
+    return UpdateSnake(state, frameTime);
+}
+
+static void draw(void* state, int windowWidth, int windowHeight) {
+    DrawSnake(state, windowWidth, windowHeight);
+}
+
+static void closeGame(void* state) {
+    CloseSnake(state);
+}
+
+static void save(const void* state, StateBuffer* out) {
+    SaveSnakeState(state, out);
+}
+
+static bool restore(void* state, const StateBuffer* snapshot) {
+    return LoadSnakeState(state, snapshot);
+}
+
+// Steps the autopilot, which restarts on its own whenever a board is filled.
+static void runHeadless(void* state, long frames) {
+    SnakeGame* game = state;
+
+    double start = MonotonicSeconds();
+    for (long frame = 0; frame < frames; frame++) {
+        StepSnake(game, AutopilotSnake(game));
+    }
+    double elapsed = MonotonicSeconds() - start;
+
+    printf("ticks: %ld\n", frames);
+    printf("seconds: %.3f\n", elapsed);
+    printf("ticks/sec: %.0f\n", elapsed > 0 ? frames / elapsed : 0.0);
+    printf("board: %dx%d\n", game->boardWidth, game->boardHeight);
+    printf("score: %d length: %d\n", game->score, game->length);
+    printf("state hash: %016llx\n", (unsigned long long)HashSnakeState(game));
+}
+
+static const GameModule snakeModule = {
+    .abi = GAME_MODULE_ABI,
+    .name = "snake",
+    .stateSize = sizeof(SnakeGame),
+    .start = start,
+    .update = update,
+    .draw = draw,
+    .close = closeGame,
+    .save = save,
+    .restore = restore,
+    .runHeadless = runHeadless,
+};
+
+const GameModule* GetGameModule(void) {
+    return &snakeModule;
+}
@@ -0,0 +1,19 @@
+#include "state_buffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_BUFFER_CAPACITY 64
+
+void ReserveStateBuffer(StateBuffer* buffer, size_t size) {
+    if (size <= buffer->capacity) return;
+
+    size_t capacity = (buffer->capacity > 0) ? buffer->capacity : MIN_BUFFER_CAPACITY;
+    while (capacity < size) capacity *= 2;
+    buffer->data = realloc(buffer->data, capacity);
+    buffer->capacity = capacity;
+}
+
+void FreeStateBuffer(StateBuffer* buffer) {
+    free(buffer->data);
+    memset(buffer, 0, sizeof(*buffer));
+}
@@ -0,0 +1,18 @@
+#ifndef STATE_BUFFER_H
+#define STATE_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A growable byte buffer; snapshots and deltas reuse theirs from call to call.
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} StateBuffer;
+
+// Grows capacity to at least size; contents and size are kept.
+void ReserveStateBuffer(StateBuffer* buffer, size_t size);
+void FreeStateBuffer(StateBuffer* buffer);
+
+#endif
@@ -0,0 +1,671 @@
+#include "tetris.h"
+#include "game_util.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TICK_RATE 60
+#define MAX_FRAME_TIME 0.25f
+#define SPAWN_X 3
+#define SPAWN_Y 0
+#define LOCK_DELAY 30
+#define SOFT_DROP_INTERVAL 2
+#define AUTO_SHIFT_DELAY 10
+#define AUTO_REPEAT_RATE 2
+#define MAX_LEVEL 29
+#define LINES_PER_LEVEL 10
+#define TETRIS_STATE_MAGIC 0x53525454u   // "TTRS"
+#define TETRIS_STATE_VERSION 1
+
+#define CELL_SIZE 26
+#define FIELD_X ((TETRIS_SCREEN_WIDTH - TETRIS_WIDTH * CELL_SIZE) / 2)
+#define FIELD_Y 40
+#define PREVIEW_X (FIELD_X + TETRIS_WIDTH * CELL_SIZE + 40)
+
+// Rotation states in SRS orientation: four row masks per rotation box, bit
+// c set for box column c. I and O use a 4x4 box, the others 3x3.
+static const uint8_t pieceRows[TETRIS_PIECE_COUNT][4][4] = {
+    [TETRIS_I] = {{0, 15, 0, 0}, {4, 4, 4, 4}, {0, 0, 15, 0}, {2, 2, 2, 2}},
+    [TETRIS_O] = {{6, 6, 0, 0}, {6, 6, 0, 0}, {6, 6, 0, 0}, {6, 6, 0, 0}},
+    [TETRIS_T] = {{2, 7, 0, 0}, {2, 6, 2, 0}, {0, 7, 2, 0}, {2, 3, 2, 0}},
+    [TETRIS_S] = {{6, 3, 0, 0}, {2, 6, 4, 0}, {0, 6, 3, 0}, {1, 3, 2, 0}},
+    [TETRIS_Z] = {{3, 6, 0, 0}, {4, 6, 2, 0}, {0, 3, 6, 0}, {2, 3, 1, 0}},
+    [TETRIS_J] = {{1, 7, 0, 0}, {6, 2, 2, 0}, {0, 7, 4, 0}, {2, 2, 3, 0}},
+    [TETRIS_L] = {{4, 7, 0, 0}, {2, 2, 6, 0}, {0, 7, 1, 0}, {3, 2, 2, 0}},
+};
+
+// Rotations 2 and 3 of I, S and Z cover the same cells as rotations 0 and 1
+// moved by (dx, dy), and every O rotation is the same; the move generator
+// reports each placement once, in the {rotation, dx, dy} form given here.
+static const int8_t rotationAliases[TETRIS_PIECE_COUNT][4][3] = {
+    [TETRIS_I] = {{0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {1, -1, 0}},
+    [TETRIS_O] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}},
+    [TETRIS_T] = {{0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {3, 0, 0}},
+    [TETRIS_S] = {{0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {1, -1, 0}},
+    [TETRIS_Z] = {{0, 0, 0}, {1, 0, 0}, {0, 0, 1}, {1, -1, 0}},
+    [TETRIS_J] = {{0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {3, 0, 0}},
+    [TETRIS_L] = {{0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {3, 0, 0}},
+};
+
+// SRS wall kicks, [from rotation][clockwise, counter-clockwise][test], as
+// (x, y) with y pointing down.
+static const int8_t kicksJLSTZ[4][2][5][2] = {
+    {{{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}, {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}},
+    {{{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}, {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}},
+    {{{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}, {{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}},
+    {{{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}, {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}},
+};
+
+static const int8_t kicksI[4][2][5][2] = {
+    {{{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}}, {{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}}},
+    {{{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}}, {{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}}},
+    {{{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}}, {{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}}},
+    {{{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}}, {{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}}},
+};
+
+// Ticks per row of gravity at 60 Hz, by level.
+static const uint8_t gravityTicks[MAX_LEVEL + 1] = {
+    48, 43, 38, 33, 28, 23, 18, 13, 8, 6, 5, 5, 5, 4, 4, 4, 3, 3, 3,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1
+};
+
+static const int lineScores[5] = {0, 100, 300, 500, 800};
+
+static const Color pieceColors[TETRIS_PIECE_COUNT] = {SKYBLUE, YELLOW, PURPLE, GREEN, RED, BLUE, ORANGE};
+
+// Bit count of a row word, as in block_field.c: without a popcount
+// instruction enabled __builtin_popcount is a library call.
+static int countBits(uint32_t x) {
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    x = (x + (x >> 4)) & 0x0F0F0F0Fu;
+    return (int)((x * 0x01010101u) >> 24);
+}
+
+void ClearTetrisBoard(TetrisBoard* board) {
+    for (int i = 0; i < TETRIS_BOARD_ROWS; i++) {
+        board->rows[i] = (i < TETRIS_PAD_ROWS + TETRIS_HEIGHT) ? TETRIS_EMPTY_ROW : TETRIS_FULL_ROW;
+    }
+}
+
+// x stays within the range where every box column maps to a bit of the row
+// word; the walls reject anything that is actually out of the field.
+bool TetrisPieceFits(const TetrisBoard* board, int piece, TetrisPlacement at) {
+    if (at.x < -TETRIS_WALL_BITS || at.x >= TETRIS_WIDTH) return false;
+    if (at.y < -TETRIS_PAD_ROWS || at.y > TETRIS_HEIGHT) return false;
+
+    const uint8_t* shape = pieceRows[piece][at.rotation];
+    const uint16_t* rows = board->rows + at.y + TETRIS_PAD_ROWS;
+    int shift = at.x + TETRIS_WALL_BITS;
+    return ((rows[0] & (shape[0] << shift)) | (rows[1] & (shape[1] << shift)) |
+            (rows[2] & (shape[2] << shift)) | (rows[3] & (shape[3] << shift))) == 0;
+}
+
+// Writes the piece into the board and returns the field rows it filled, bit
+// y for field row y, for ClearTetrisLines.
+uint32_t LockTetrisPiece(TetrisBoard* board, int piece, TetrisPlacement at) {
+    const uint8_t* shape = pieceRows[piece][at.rotation];
+    int shift = at.x + TETRIS_WALL_BITS;
+    uint32_t fullRows = 0;
+
+    for (int r = 0; r < 4; r++) {
+        if (shape[r] == 0) continue;
+        int y = at.y + r;
+        uint16_t* row = &board->rows[y + TETRIS_PAD_ROWS];
+        *row |= (uint16_t)(shape[r] << shift);
+        if (*row == TETRIS_FULL_ROW && y >= 0 && y < TETRIS_HEIGHT) fullRows |= 1u << y;
+    }
+    return fullRows;
+}
+
+// Drops every row above a cleared one by the number of cleared rows below it,
+// in one pass from the lowest cleared row up.
+void ClearTetrisLines(TetrisBoard* board, uint32_t fullRows) {
+    if (fullRows == 0) return;
+
+    int write = 31 - __builtin_clz(fullRows) + TETRIS_PAD_ROWS;
+    for (int read = write; read >= TETRIS_PAD_ROWS; read--) {
+        if ((fullRows >> (read - TETRIS_PAD_ROWS)) & 1) continue;
+        board->rows[write--] = board->rows[read];
+    }
+    while (write >= TETRIS_PAD_ROWS) board->rows[write--] = TETRIS_EMPTY_ROW;
+}
+
+// Landing row of a straight drop from at.
+int DropTetrisPiece(const TetrisBoard* board, int piece, TetrisPlacement at) {
+    TetrisPlacement below = at;
+    below.y++;
+    while (TetrisPieceFits(board, piece, below)) below.y++;
+    return below.y - 1;
+}
+
+// SRS rotation of the piece at from: the first kick test that fits wins.
+static bool rotateTetrisPiece(const TetrisBoard* board, int piece, TetrisPlacement from, int direction,
+                              TetrisPlacement* to) {
+    const int8_t (*kicks)[2] = (piece == TETRIS_I) ? kicksI[from.rotation][direction < 0]
+                                                   : kicksJLSTZ[from.rotation][direction < 0];
+
+    for (int k = 0; k < 5; k++) {
+        TetrisPlacement at = {(from.rotation + direction + 4) & 3, from.x + kicks[k][0], from.y + kicks[k][1]};
+        if (TetrisPieceFits(board, piece, at)) {
+            *to = at;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sets the bit for a position in a [rotation][board row] table of row-word
+// masks; false if it was already set.
+static bool markPosition(uint16_t (*marks)[TETRIS_BOARD_ROWS], TetrisPlacement at) {
+    uint16_t* row = &marks[at.rotation][at.y + TETRIS_PAD_ROWS];
+    uint16_t bit = (uint16_t)(1u << (at.x + TETRIS_WALL_BITS));
+    if (*row & bit) return false;
+    *row |= bit;
+    return true;
+}
+
+// Every placement the piece can lock in from spawn; returns the count. A
+// breadth-first search over (rotation, x, y) by shifts, kicked rotations and
+// one-row drops, so slides and spins under overhangs count as well as hard
+// drops. Any position the piece can't drop from is a placement. Aliased
+// rotations are searched separately, since a kick can reach one where the
+// other doesn't fit, and reported once.
+int GenerateTetrisPlacements(const TetrisBoard* board, int piece, TetrisPlacement* placements) {
+    uint16_t visited[4][TETRIS_BOARD_ROWS] = {{0}};
+    uint16_t placed[4][TETRIS_BOARD_ROWS] = {{0}};
+    TetrisPlacement queue[TETRIS_MAX_PLACEMENTS];
+    int head = 0;
+    int tail = 0;
+    int count = 0;
+
+    TetrisPlacement spawn = {0, SPAWN_X, SPAWN_Y};
+    if (!TetrisPieceFits(board, piece, spawn)) return 0;
+    markPosition(visited, spawn);
+    queue[tail++] = spawn;
+
+    while (head < tail) {
+        TetrisPlacement at = queue[head++];
+        TetrisPlacement next[5] = {at, at, at};
+        next[0].x--;
+        next[1].x++;
+        next[2].y++;
+        int moves = 3;
+        if (rotateTetrisPiece(board, piece, at, 1, &next[moves])) moves++;
+        if (rotateTetrisPiece(board, piece, at, -1, &next[moves])) moves++;
+
+        // Rotations have been tested already; shifts and the drop haven't.
+        bool grounded = true;
+        for (int m = 0; m < moves; m++) {
+            if (m < 3 && !TetrisPieceFits(board, piece, next[m])) continue;
+            if (m == 2) grounded = false;
+            if (markPosition(visited, next[m])) queue[tail++] = next[m];
+        }
+
+        if (grounded) {
+            const int8_t* alias = rotationAliases[piece][at.rotation];
+            TetrisPlacement canonical = {alias[0], at.x + alias[1], at.y + alias[2]};
+            if (markPosition(placed, canonical)) placements[count++] = canonical;
+        }
+    }
+    return count;
+}
+
+// Linear score over aggregate height, cleared lines, holes and bumpiness
+// (weights from Yiyuan Lee's tuned near-perfect bot). Holes are counted a
+// whole row at a time: empty cells with a filled cell anywhere above them.
+float EvaluateTetrisBoard(const TetrisBoard* board, int linesCleared) {
+    int tops[TETRIS_WIDTH];
+    uint16_t covered = 0;
+    int holes = 0;
+
+    for (int x = 0; x < TETRIS_WIDTH; x++) tops[x] = TETRIS_HEIGHT;
+    for (int y = 0; y < TETRIS_HEIGHT; y++) {
+        uint16_t row = board->rows[y + TETRIS_PAD_ROWS] & TETRIS_FIELD_MASK;
+        holes += countBits(covered & ~row);
+        uint16_t fresh = row & ~covered;
+        covered |= row;
+        while (fresh) {
+            tops[__builtin_ctz(fresh) - TETRIS_WALL_BITS] = y;
+            fresh &= fresh - 1;
+        }
+    }
+
+    int height = 0;
+    int bumpiness = 0;
+    for (int x = 0; x < TETRIS_WIDTH; x++) {
+        height += TETRIS_HEIGHT - tops[x];
+        if (x > 0) bumpiness += abs(tops[x] - tops[x - 1]);
+    }
+    return -0.510066f * height + 0.760666f * linesCleared - 0.35663f * holes - 0.184483f * bumpiness;
+}
+
+static uint32_t nextRandom(TetrisGame* game) {
+    return (uint32_t)(SplitMix64(&game->rngState) >> 32);
+}
+
+// 7-bag randomizer: every run of seven pieces holds each piece once.
+static int takeFromBag(TetrisGame* game) {
+    if (game->bagIndex == TETRIS_PIECE_COUNT) {
+        for (int i = 0; i < TETRIS_PIECE_COUNT; i++) game->bag[i] = (uint8_t)i;
+        for (int i = TETRIS_PIECE_COUNT - 1; i > 0; i--) {
+            int j = (int)(((uint64_t)nextRandom(game) * (uint32_t)(i + 1)) >> 32);
+            uint8_t swap = game->bag[i];
+            game->bag[i] = game->bag[j];
+            game->bag[j] = swap;
+        }
+        game->bagIndex = 0;
+    }
+    return game->bag[game->bagIndex++];
+}
+
+static void spawnPiece(TetrisGame* game) {
+    game->piece = game->next;
+    game->next = takeFromBag(game);
+    game->position = (TetrisPlacement){0, SPAWN_X, SPAWN_Y};
+    game->gravityTimer = 0;
+    game->lockTimer = 0;
+    if (!TetrisPieceFits(&game->board, game->piece, game->position)) game->gameOver = true;
+}
+
+void SetTetrisSeed(TetrisGame* game, uint64_t seed) {
+    game->rngState = seed;
+}
+
+void InitTetris(TetrisGame* game) {
+    ClearTetrisBoard(&game->board);
+    memset(game->cells, 0, sizeof(game->cells));
+    game->bagIndex = TETRIS_PIECE_COUNT;
+    game->score = 0;
+    game->lines = 0;
+    game->level = 0;
+    game->pieces = 0;
+    game->gameOver = false;
+    game->paused = false;
+    game->accumulator = 0.0f;
+    game->pendingCommands = (TetrisInput){0};
+    game->heldMove = 0;
+    game->heldTicks = 0;
+    game->next = takeFromBag(game);
+    spawnPiece(game);
+}
+
+// Locks the current piece, clears lines in both the board and the color
+// grid, scores them and spawns the next piece. A piece that locks above the
+// field ends the game.
+static void lockPiece(TetrisGame* game) {
+    TetrisPlacement at = game->position;
+    const uint8_t* shape = pieceRows[game->piece][at.rotation];
+    bool lockOut = false;
+
+    for (int r = 0; r < 4; r++) {
+        for (int c = 0; c < 4; c++) {
+            if (!((shape[r] >> c) & 1)) continue;
+            if (at.y + r < 0) lockOut = true;
+            else game->cells[at.y + r][at.x + c] = (uint8_t)(game->piece + 1);
+        }
+    }
+    uint32_t fullRows = LockTetrisPiece(&game->board, game->piece, at);
+    if (lockOut) {
+        game->gameOver = true;
+        return;
+    }
+
+    if (fullRows) {
+        int write = 31 - __builtin_clz(fullRows);
+        for (int read = write; read >= 0; read--) {
+            if ((fullRows >> read) & 1) continue;
+            memcpy(game->cells[write--], game->cells[read], TETRIS_WIDTH);
+        }
+        while (write >= 0) memset(game->cells[write--], 0, TETRIS_WIDTH);
+        ClearTetrisLines(&game->board, fullRows);
+    }
+
+    int cleared = countBits(fullRows);
+    game->score += (long long)lineScores[cleared] * (game->level + 1);
+    game->lines += cleared;
+    game->level = game->lines / LINES_PER_LEVEL;
+    if (game->level > MAX_LEVEL) game->level = MAX_LEVEL;
+    game->pieces++;
+    spawnPiece(game);
+}
+
+static bool rotatePiece(TetrisGame* game, int direction) {
+    return rotateTetrisPiece(&game->board, game->piece, game->position, direction, &game->position);
+}
+
+// One 60 Hz tick. Moving or rotating a grounded piece restarts its lock
+// delay.
+void StepTetris(TetrisGame* game, TetrisInput input) {
+    if (input.pause) game->paused = !game->paused;
+    if (input.restart) {
+        InitTetris(game);
+        return;
+    }
+    if (game->gameOver || game->paused) return;
+
+    if (input.rotate != 0 && rotatePiece(game, input.rotate)) game->lockTimer = 0;
+    if (input.move != 0) {
+        TetrisPlacement at = game->position;
+        at.x += input.move;
+        if (TetrisPieceFits(&game->board, game->piece, at)) {
+            game->position = at;
+            game->lockTimer = 0;
+        }
+    }
+
+    if (input.hardDrop) {
+        int y = DropTetrisPiece(&game->board, game->piece, game->position);
+        game->score += 2 * (y - game->position.y);
+        game->position.y = y;
+        lockPiece(game);
+        return;
+    }
+
+    TetrisPlacement below = game->position;
+    below.y++;
+    bool grounded = !TetrisPieceFits(&game->board, game->piece, below);
+
+    int interval = gravityTicks[game->level];
+    if (input.softDrop && interval > SOFT_DROP_INTERVAL) interval = SOFT_DROP_INTERVAL;
+    if (++game->gravityTimer >= interval) {
+        game->gravityTimer = 0;
+        if (!grounded) {
+            game->position = below;
+            if (input.softDrop) game->score++;
+            below.y++;
+            grounded = !TetrisPieceFits(&game->board, game->piece, below);
+        }
+    }
+
+    if (!grounded) {
+        game->lockTimer = 0;
+    } else if (++game->lockTimer >= LOCK_DELAY) {
+        lockPiece(game);
+    }
+}
+
+// Moves the current piece straight to a placement (from
+// GenerateTetrisPlacements) and locks it there.
+void PlaceTetrisPiece(TetrisGame* game, TetrisPlacement placement) {
+    if (game->gameOver) return;
+    game->position = placement;
+    lockPiece(game);
+}
+
+// One-ply greedy search: scores the board after every legal placement of
+// the current piece. Returns how many positions it evaluated.
+int AutopilotTetris(const TetrisGame* game, TetrisPlacement* best) {
+    TetrisPlacement placements[TETRIS_MAX_PLACEMENTS];
+    int count = GenerateTetrisPlacements(&game->board, game->piece, placements);
+    float bestScore = -INFINITY;
+
+    *best = game->position;
+    for (int i = 0; i < count; i++) {
+        TetrisBoard board = game->board;
+        uint32_t fullRows = LockTetrisPiece(&board, game->piece, placements[i]);
+        ClearTetrisLines(&board, fullRows);
+        float score = EvaluateTetrisBoard(&board, countBits(fullRows));
+        if (score > bestScore) {
+            bestScore = score;
+            *best = placements[i];
+        }
+    }
+    return count;
+}
+
+// FNV-1a over the simulation state.
+uint64_t HashTetrisState(const TetrisGame* game) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    int flags = (game->gameOver ? 1 : 0) | (game->paused ? 2 : 0);
+
+    hash = HashBytes(hash, game->board.rows, sizeof(game->board.rows));
+    hash = HashBytes(hash, &game->piece, sizeof(game->piece));
+    hash = HashBytes(hash, &game->position, sizeof(game->position));
+    hash = HashBytes(hash, &game->next, sizeof(game->next));
+    hash = HashBytes(hash, game->bag, sizeof(game->bag));
+    hash = HashBytes(hash, &game->bagIndex, sizeof(game->bagIndex));
+    hash = HashBytes(hash, &game->score, sizeof(game->score));
+    hash = HashBytes(hash, &game->lines, sizeof(game->lines));
+    hash = HashBytes(hash, &game->gravityTimer, sizeof(game->gravityTimer));
+    hash = HashBytes(hash, &game->lockTimer, sizeof(game->lockTimer));
+    hash = HashBytes(hash, &flags, sizeof(flags));
+    hash = HashBytes(hash, &game->rngState, sizeof(game->rngState));
+    return hash;
+}
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint16_t rows[TETRIS_BOARD_ROWS];
+    uint8_t cells[TETRIS_HEIGHT][TETRIS_WIDTH];
+    uint8_t bag[TETRIS_PIECE_COUNT];
+    int8_t rotation;
+    int8_t x;
+    int8_t y;
+    uint8_t gameOver;
+    uint8_t paused;
+    uint8_t softDrop;
+    uint8_t hardDrop;
+    uint8_t pause;
+    uint8_t restart;
+    int32_t piece;
+    int32_t next;
+    int32_t bagIndex;
+    int32_t lines;
+    int32_t level;
+    int32_t pieces;
+    int32_t gravityTimer;
+    int32_t lockTimer;
+    int32_t move;
+    int32_t rotate;
+    int32_t heldMove;
+    int32_t heldTicks;
+    int64_t score;
+    uint64_t rngState;
+    float accumulator;
+} TetrisState;
+
+// Everything but the presentation, so a game can be carried across a
+// module reload.
+void SaveTetrisState(const TetrisGame* game, StateBuffer* out) {
+    TetrisState state = {
+        .magic = TETRIS_STATE_MAGIC,
+        .version = TETRIS_STATE_VERSION,
+        .rotation = game->position.rotation,
+        .x = game->position.x,
+        .y = game->position.y,
+        .gameOver = game->gameOver,
+        .paused = game->paused,
+        .softDrop = game->pendingCommands.softDrop,
+        .hardDrop = game->pendingCommands.hardDrop,
+        .pause = game->pendingCommands.pause,
+        .restart = game->pendingCommands.restart,
+        .piece = game->piece,
+        .next = game->next,
+        .bagIndex = game->bagIndex,
+        .lines = game->lines,
+        .level = game->level,
+        .pieces = game->pieces,
+        .gravityTimer = game->gravityTimer,
+        .lockTimer = game->lockTimer,
+        .move = game->pendingCommands.move,
+        .rotate = game->pendingCommands.rotate,
+        .heldMove = game->heldMove,
+        .heldTicks = game->heldTicks,
+        .score = game->score,
+        .rngState = game->rngState,
+        .accumulator = game->accumulator,
+    };
+    memcpy(state.rows, game->board.rows, sizeof(state.rows));
+    memcpy(state.cells, game->cells, sizeof(state.cells));
+    memcpy(state.bag, game->bag, sizeof(state.bag));
+
+    out->size = sizeof(state);
+    ReserveStateBuffer(out, out->size);
+    memcpy(out->data, &state, sizeof(state));
+}
+
+// Fails, leaving game untouched, unless state is a snapshot of this version
+// with pieces and rotations in range.
+bool LoadTetrisState(TetrisGame* game, const StateBuffer* buffer) {
+    TetrisState state;
+    if (buffer->size != sizeof(state)) return false;
+    memcpy(&state, buffer->data, sizeof(state));
+    if (state.magic != TETRIS_STATE_MAGIC || state.version != TETRIS_STATE_VERSION) return false;
+    if (state.piece < 0 || state.piece >= TETRIS_PIECE_COUNT) return false;
+    if (state.next < 0 || state.next >= TETRIS_PIECE_COUNT) return false;
+    if (state.rotation < 0 || state.rotation > 3) return false;
+    if (state.bagIndex < 0 || state.bagIndex > TETRIS_PIECE_COUNT) return false;
+    if (state.level < 0 || state.level > MAX_LEVEL || state.lines < 0) return false;
+    for (int i = 0; i < TETRIS_PIECE_COUNT; i++) {
+        if (state.bag[i] >= TETRIS_PIECE_COUNT) return false;
+    }
+    for (int y = 0; y < TETRIS_HEIGHT; y++) {
+        for (int x = 0; x < TETRIS_WIDTH; x++) {
+            if (state.cells[y][x] > TETRIS_PIECE_COUNT) return false;
+        }
+    }
+
+    // The walls and floor are what keep a live piece inside cells[].
+    for (int i = 0; i < TETRIS_BOARD_ROWS; i++) {
+        uint16_t row = state.rows[i];
+        if ((row | TETRIS_FIELD_MASK) != TETRIS_FULL_ROW) return false;
+        if (i >= TETRIS_PAD_ROWS + TETRIS_HEIGHT && row != TETRIS_FULL_ROW) return false;
+    }
+    TetrisBoard board;
+    memcpy(board.rows, state.rows, sizeof(state.rows));
+    TetrisPlacement position = {state.rotation, state.x, state.y};
+    if (!state.gameOver && !TetrisPieceFits(&board, state.piece, position)) return false;
+
+    game->board = board;
+    memcpy(game->cells, state.cells, sizeof(state.cells));
+    memcpy(game->bag, state.bag, sizeof(state.bag));
+    game->piece = state.piece;
+    game->position = position;
+    game->next = state.next;
+    game->bagIndex = state.bagIndex;
+    game->score = state.score;
+    game->lines = state.lines;
+    game->level = state.level;
+    game->pieces = state.pieces;
+    game->gravityTimer = state.gravityTimer;
+    game->lockTimer = state.lockTimer;
+    game->gameOver = state.gameOver;
+    game->paused = state.paused;
+    game->rngState = state.rngState;
+    game->accumulator = state.accumulator;
+    game->pendingCommands = (TetrisInput){state.move, state.rotate, state.softDrop, state.hardDrop,
+                                          state.pause, state.restart};
+    game->heldMove = state.heldMove;
+    game->heldTicks = state.heldTicks;
+    return true;
+}
+
+// Returns false once M asks to go back to the menu.
+bool UpdateTetris(TetrisGame* game, float frameTime) {
+    if (IsKeyPressed(KEY_M)) return false;
+
+    // Presses wait for the next tick; held left/right auto-repeats there.
+    TetrisInput* pending = &game->pendingCommands;
+    if (IsKeyPressed(KEY_LEFT)) pending->move = -1;
+    if (IsKeyPressed(KEY_RIGHT)) pending->move = 1;
+    if (IsKeyPressed(KEY_UP) || IsKeyPressed(KEY_X)) pending->rotate = 1;
+    if (IsKeyPressed(KEY_Z)) pending->rotate = -1;
+    pending->hardDrop |= IsKeyPressed(KEY_SPACE);
+    pending->pause |= IsKeyPressed(KEY_P);
+    pending->restart |= IsKeyPressed(KEY_R);
+
+    float stepTime = 1.0f / TICK_RATE;
+    if (frameTime > MAX_FRAME_TIME) frameTime = MAX_FRAME_TIME;
+
+    game->accumulator += frameTime;
+    while (game->accumulator >= stepTime) {
+        TetrisInput input = *pending;
+        *pending = (TetrisInput){0};
+
+        int held = IsKeyDown(KEY_RIGHT) - IsKeyDown(KEY_LEFT);
+        if (held != game->heldMove) {
+            game->heldMove = held;
+            game->heldTicks = 0;
+        } else if (held != 0 && ++game->heldTicks >= AUTO_SHIFT_DELAY &&
+                   (game->heldTicks - AUTO_SHIFT_DELAY) % AUTO_REPEAT_RATE == 0) {
+            input.move = held;
+        }
+        input.softDrop = IsKeyDown(KEY_DOWN);
+
+        StepTetris(game, input);
+        game->accumulator -= stepTime;
+    }
+    return true;
+}
+
+static void drawCell(int x, int y, Color color) {
+    DrawRectangle(x + 1, y + 1, CELL_SIZE - 2, CELL_SIZE - 2, color);
+}
+
+static void drawPiece(int piece, TetrisPlacement at, int originX, int originY, Color color) {
+    const uint8_t* shape = pieceRows[piece][at.rotation];
+    for (int r = 0; r < 4; r++) {
+        int y = at.y + r - TETRIS_HIDDEN_ROWS;
+        for (int c = 0; c < 4; c++) {
+            if (((shape[r] >> c) & 1) && y >= 0) {
+                drawCell(originX + (at.x + c) * CELL_SIZE, originY + y * CELL_SIZE, color);
+            }
+        }
+    }
+}
+
+static void drawCentered(const char* text, int y, int fontSize, Color color) {
+    DrawText(text, TETRIS_SCREEN_WIDTH/2 - MeasureText(text, fontSize)/2, y, fontSize, color);
+}
+
+void DrawTetris(TetrisGame* game, int windowWidth, int windowHeight) {
+    BeginPresentation(&game->presentation, TETRIS_SCREEN_WIDTH, TETRIS_SCREEN_HEIGHT);
+    ClearBackground(BLACK);
+
+    int visibleRows = TETRIS_HEIGHT - TETRIS_HIDDEN_ROWS;
+    DrawRectangle(FIELD_X, FIELD_Y, TETRIS_WIDTH * CELL_SIZE, visibleRows * CELL_SIZE, (Color){20, 20, 20, 255});
+    for (int y = 0; y < visibleRows; y++) {
+        for (int x = 0; x < TETRIS_WIDTH; x++) {
+            int cell = game->cells[y + TETRIS_HIDDEN_ROWS][x];
+            if (cell) drawCell(FIELD_X + x * CELL_SIZE, FIELD_Y + y * CELL_SIZE, pieceColors[cell - 1]);
+        }
+    }
+
+    if (!game->gameOver) {
+        Color color = pieceColors[game->piece];
+        TetrisPlacement ghost = game->position;
+        ghost.y = DropTetrisPiece(&game->board, game->piece, ghost);
+        drawPiece(game->piece, ghost, FIELD_X, FIELD_Y, Fade(color, 0.25f));
+        drawPiece(game->piece, game->position, FIELD_X, FIELD_Y, color);
+    }
+    DrawRectangleLines(FIELD_X - 1, FIELD_Y - 1, TETRIS_WIDTH * CELL_SIZE + 2, visibleRows * CELL_SIZE + 2, DARKGRAY);
+
+    int fontSize = 20;
+    DrawText("NEXT", PREVIEW_X, FIELD_Y, fontSize, GRAY);
+    drawPiece(game->next, (TetrisPlacement){0, 0, TETRIS_HIDDEN_ROWS}, PREVIEW_X, FIELD_Y + 30, pieceColors[game->next]);
+
+    int hudX = 40;
+    DrawText(TextFormat("SCORE: %lld", game->score), hudX, FIELD_Y, fontSize, GREEN);
+    DrawText(TextFormat("LINES: %d", game->lines), hudX, FIELD_Y + 30, fontSize, GREEN);
+    DrawText(TextFormat("LEVEL: %d", game->level), hudX, FIELD_Y + 60, fontSize, GREEN);
+
+    if (game->paused || game->gameOver) {
+        DrawRectangle(0, 0, TETRIS_SCREEN_WIDTH, TETRIS_SCREEN_HEIGHT, Fade(BLACK, 0.7f));
+    }
+    if (game->paused) {
+        drawCentered("GAME PAUSED", TETRIS_SCREEN_HEIGHT/2 - 60, 40, YELLOW);
+        drawCentered("Press P to continue", TETRIS_SCREEN_HEIGHT/2 + 20, 20, WHITE);
+    } else if (game->gameOver) {
+        drawCentered("GAME OVER", TETRIS_SCREEN_HEIGHT/2 - 80, 50, RED);
+        drawCentered(TextFormat("FINAL SCORE: %lld", game->score), TETRIS_SCREEN_HEIGHT/2, 30, YELLOW);
+        drawCentered("Press R to restart", TETRIS_SCREEN_HEIGHT/2 + 60, 20, WHITE);
+    }
+
+    EndPresentation(&game->presentation, windowWidth, windowHeight);
+}
+
+void CloseTetris(TetrisGame* game) {
+    UnloadPresentation(&game->presentation);
+}
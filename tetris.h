@@ -0,0 +1,117 @@
+#ifndef TETRIS_H
+#define TETRIS_H
+
+#include "raylib.h"
+#include "presentation.h"
+#include "state_buffer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tetris draws in this logical space, like the other games.
+#define TETRIS_SCREEN_WIDTH 800
+#define TETRIS_SCREEN_HEIGHT 600
+
+// The field is 10 wide and 22 tall; the top two rows are hidden spawn rows.
+#define TETRIS_WIDTH 10
+#define TETRIS_HEIGHT 22
+#define TETRIS_HIDDEN_ROWS 2
+#define TETRIS_PAD_ROWS 4
+#define TETRIS_BOARD_ROWS (TETRIS_HEIGHT + 2 * TETRIS_PAD_ROWS)
+
+// Field column x is bit x + 3 of a row. The three bits on either side are
+// walls and stay set, so a row is full at 0xFFFF and a piece running into a
+// wall collides like it does with the stack.
+#define TETRIS_WALL_BITS 3
+#define TETRIS_EMPTY_ROW ((uint16_t)0xE007)
+#define TETRIS_FULL_ROW ((uint16_t)0xFFFF)
+#define TETRIS_FIELD_MASK ((uint16_t)0x1FF8)
+
+// One bit per row word for each rotation and board row bounds the positions
+// a piece can take, and so the placements GenerateTetrisPlacements returns.
+#define TETRIS_MAX_PLACEMENTS (4 * 16 * TETRIS_BOARD_ROWS)
+
+typedef enum {
+    TETRIS_I = 0,
+    TETRIS_O,
+    TETRIS_T,
+    TETRIS_S,
+    TETRIS_Z,
+    TETRIS_J,
+    TETRIS_L,
+    TETRIS_PIECE_COUNT
+} TetrisPiece;
+
+// One row word per field row, with TETRIS_PAD_ROWS open rows above the
+// field (for kicks) and as many solid rows below it (the floor). Field row
+// y is rows[y + TETRIS_PAD_ROWS]. Small enough to copy per search node.
+typedef struct {
+    uint16_t rows[TETRIS_BOARD_ROWS];
+} TetrisBoard;
+
+// A piece's position: its rotation (0 = spawn, clockwise) and the top-left
+// corner of its rotation box in field coordinates.
+typedef struct {
+    int8_t rotation;
+    int8_t x;
+    int8_t y;
+} TetrisPlacement;
+
+// move is -1/0/1 (left/right), rotate -1/0/1 (counter-clockwise/clockwise).
+typedef struct {
+    int move;
+    int rotate;
+    bool softDrop;
+    bool hardDrop;
+    bool pause;
+    bool restart;
+} TetrisInput;
+
+typedef struct {
+    TetrisBoard board;
+    uint8_t cells[TETRIS_HEIGHT][TETRIS_WIDTH];   // piece + 1 per cell, for colors only
+
+    int piece;
+    TetrisPlacement position;
+    int next;
+    uint8_t bag[TETRIS_PIECE_COUNT];
+    int bagIndex;
+
+    long long score;
+    int lines;
+    int level;
+    int pieces;
+    int gravityTimer;
+    int lockTimer;
+    bool gameOver;
+    bool paused;
+    uint64_t rngState;
+
+    float accumulator;
+    TetrisInput pendingCommands;
+    int heldMove;
+    int heldTicks;
+
+    Presentation presentation;
+} TetrisGame;
+
+void ClearTetrisBoard(TetrisBoard* board);
+bool TetrisPieceFits(const TetrisBoard* board, int piece, TetrisPlacement at);
+uint32_t LockTetrisPiece(TetrisBoard* board, int piece, TetrisPlacement at);
+void ClearTetrisLines(TetrisBoard* board, uint32_t fullRows);
+int DropTetrisPiece(const TetrisBoard* board, int piece, TetrisPlacement at);
+int GenerateTetrisPlacements(const TetrisBoard* board, int piece, TetrisPlacement* placements);
+float EvaluateTetrisBoard(const TetrisBoard* board, int linesCleared);
+
+void SetTetrisSeed(TetrisGame* game, uint64_t seed);
+void InitTetris(TetrisGame* game);
+void StepTetris(TetrisGame* game, TetrisInput input);
+void PlaceTetrisPiece(TetrisGame* game, TetrisPlacement placement);
+int AutopilotTetris(const TetrisGame* game, TetrisPlacement* best);
+uint64_t HashTetrisState(const TetrisGame* game);
+void SaveTetrisState(const TetrisGame* game, StateBuffer* out);
+bool LoadTetrisState(TetrisGame* game, const StateBuffer* state);
+bool UpdateTetris(TetrisGame* game, float frameTime);
+void DrawTetris(TetrisGame* game, int windowWidth, int windowHeight);
+void CloseTetris(TetrisGame* game);
+
+#endif
@@ -0,0 +1,74 @@
+#include "game_module.h"
+#include "tetris.h"
+#include "game_util.h"
+#include <stdio.h>
+
+static void start(void* state, const GameModuleConfig* config) {
+    TetrisGame* game = state;
+    SetTetrisSeed(game, config->seed);
+    InitTetris(game);
+}
+
+static bool update(void* state, float frameTime) {
+    return UpdateTetris(state, frameTime);
+}
+
+static void draw(void* state, int windowWidth, int windowHeight) {
+    DrawTetris(state, windowWidth, windowHeight);
+}
+
+static void closeGame(void* state) {
+    CloseTetris(state);
+}
+
+static void save(const void* state, StateBuffer* out) {
+    SaveTetrisState(state, out);
+}
+
+static bool restore(void* state, const StateBuffer* snapshot) {
+    return LoadTetrisState(state, snapshot);
+}
+
+// frames counts pieces, each placed by the greedy placement search, with a
+// new game whenever one tops out.
+static void runHeadless(void* state, long pieces) {
+    TetrisGame* game = state;
+    long long positions = 0;
+    int games = 1;
+
+    double start = MonotonicSeconds();
+    for (long piece = 0; piece < pieces; piece++) {
+        if (game->gameOver) {
+            InitTetris(game);
+            games++;
+        }
+        TetrisPlacement best;
+        positions += AutopilotTetris(game, &best);
+        PlaceTetrisPiece(game, best);
+    }
+    double elapsed = MonotonicSeconds() - start;
+
+    printf("pieces: %ld\n", pieces);
+    printf("seconds: %.3f\n", elapsed);
+    printf("pieces/sec: %.0f\n", elapsed > 0 ? pieces / elapsed : 0.0);
+    printf("positions: %lld (%.0f/sec)\n", positions, elapsed > 0 ? positions / elapsed : 0.0);
+    printf("games: %d score: %lld lines: %d\n", games, game->score, game->lines);
+    printf("state hash: %016llx\n", (unsigned long long)HashTetrisState(game));
+}
+
+static const GameModule tetrisModule = {
+    .abi = GAME_MODULE_ABI,
+    .name = "tetris",
+    .stateSize = sizeof(TetrisGame),
+    .start = start,
+    .update = update,
+    .draw = draw,
+    .close = closeGame,
+    .save = save,
+    .restore = restore,
+    .runHeadless = runHeadless,
+};
+
+const GameModule* GetGameModule(void) {
+    return &tetrisModule;
+}
@@ -0,0 +1,128 @@
+#include "work_pool.h"
+#include "game_util.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// A worker's queue is just the index range [begin, end): the owner pops
+// from the front and thieves cut off the back, each under the owner's lock.
+// No lock is ever held while taking another, so there is no lock ordering.
+typedef struct {
+    pthread_mutex_t lock;
+    int begin;
+    int end;
+    char pad[64];
+} WorkQueue;
+
+typedef struct WorkPool WorkPool;
+
+typedef struct {
+    WorkPool* pool;
+    int index;
+    pthread_t thread;
+    WorkerStats stats;
+} Worker;
+
+struct WorkPool {
+    WorkQueue* queues;
+    Worker* workers;
+    int threadCount;
+    WorkTask task;
+    void* context;
+};
+
+static bool popLocal(WorkQueue* queue, int* task) {
+    pthread_mutex_lock(&queue->lock);
+    bool found = queue->begin < queue->end;
+    if (found) *task = queue->begin++;
+    pthread_mutex_unlock(&queue->lock);
+    return found;
+}
+
+static bool steal(WorkPool* pool, int thief) {
+    for (int i = 1; i < pool->threadCount; i++) {
+        WorkQueue* victim = &pool->queues[(thief + i) % pool->threadCount];
+
+        pthread_mutex_lock(&victim->lock);
+        int remaining = victim->end - victim->begin;
+        int begin = victim->end - (remaining + 1) / 2;
+        int end = victim->end;
+        if (remaining > 0) victim->end = begin;
+        pthread_mutex_unlock(&victim->lock);
+
+        if (remaining > 0) {
+            WorkQueue* own = &pool->queues[thief];
+            pthread_mutex_lock(&own->lock);
+            own->begin = begin;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            return true;
+        }
+    }
+    // Tasks never spawn more tasks, so once every queue is empty the only
+    // work left is what other workers are already running.
+    return false;
+}
+
+static void* workerMain(void* arg) {
+    Worker* worker = arg;
+    WorkPool* pool = worker->pool;
+    WorkQueue* queue = &pool->queues[worker->index];
+
+    for (;;) {
+        int task;
+        if (popLocal(queue, &task)) {
+            double start = MonotonicSeconds();
+            pool->task(pool->context, task, worker->index);
+            worker->stats.busySeconds += MonotonicSeconds() - start;
+            worker->stats.tasks++;
+            continue;
+        }
+        if (!steal(pool, worker->index)) break;
+        worker->stats.steals++;
+    }
+    return NULL;
+}
+
+int RunWorkPool(int taskCount, int threadCount, WorkTask task, void* context, WorkerStats* stats) {
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > taskCount && taskCount > 0) threadCount = taskCount;
+
+    WorkPool pool;
+    pool.queues = calloc(threadCount, sizeof(WorkQueue));
+    pool.workers = calloc(threadCount, sizeof(Worker));
+    pool.threadCount = threadCount;
+    pool.task = task;
+    pool.context = context;
+
+    for (int i = 0; i < threadCount; i++) {
+        pthread_mutex_init(&pool.queues[i].lock, NULL);
+        pool.queues[i].begin = (int)((long long)taskCount * i / threadCount);
+        pool.queues[i].end = (int)((long long)taskCount * (i + 1) / threadCount);
+        pool.workers[i].pool = &pool;
+        pool.workers[i].index = i;
+    }
+
+    // Worker 0 runs on the calling thread.
+    for (int i = 1; i < threadCount; i++) {
+        pthread_create(&pool.workers[i].thread, NULL, workerMain, &pool.workers[i]);
+    }
+    workerMain(&pool.workers[0]);
+    for (int i = 1; i < threadCount; i++) {
+        pthread_join(pool.workers[i].thread, NULL);
+    }
+
+    for (int i = 0; i < threadCount; i++) {
+        if (stats) stats[i] = pool.workers[i].stats;
+        pthread_mutex_destroy(&pool.queues[i].lock);
+    }
+    free(pool.queues);
+    free(pool.workers);
+    return threadCount;
+}
+
+int WorkPoolDefaultThreads(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
@@ -0,0 +1,21 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+typedef void (*WorkTask)(void* context, int task, int worker);
+
+typedef struct {
+    int tasks;
+    int steals;
+    double busySeconds;
+} WorkerStats;
+
+// Runs task(context, i, worker) for every i in [0, taskCount) on threadCount
+// threads and returns when all of them are done. Each worker starts with a
+// contiguous slice of the indices and, once its own slice runs dry, steals
+// the back half of another worker's, so uneven tasks still keep every
+// thread busy. Returns the number of workers used (never more than
+// taskCount); stats, if given, receives one entry per worker.
+int RunWorkPool(int taskCount, int threadCount, WorkTask task, void* context, WorkerStats* stats);
+int WorkPoolDefaultThreads(void);
+
+#endif